@@ -27,9 +27,10 @@
 #include <models/WebXPosition.h>
 #include <algorithm>
 #include <thread>
+#include <poll.h>
 #include <spdlog/spdlog.h>
 
-const uint64_t WebXController::GLOBAL_CLIENT_INDEX_MASK = ~0x00; // Sets all bits
+const WebXClientIndexMask WebXController::GLOBAL_CLIENT_INDEX_MASK = WebXClientIndexMask::All(); // Sets all bits
 
 WebXController::WebXController(WebXGateway & gateway, const WebXSettings & settings, const std::string & keyboardLayout) :
     _gateway(gateway),
@@ -38,24 +39,37 @@ WebXController::WebXController(WebXGateway & gateway, const WebXSettings & setti
     _clientRegistry(settings, [&gateway](std::shared_ptr<WebXMessage> message) {
         gateway.publishMessage(message);
     }),
+    _overloadGovernor(settings.controller.overloadTickBudgetMs, settings.controller.overloadMaxQueueDepth, settings.controller.overloadRecoveryTimeMs),
     _displayDirty(true),
     _cursorDirty(true),
-    _threadSleepUs(1000000.0 / WebXController::THREAD_RATE),
     _state(WebXControllerState::Stopped) {
 
     // Set the instruction handler function in the gateway
     this->_gateway.setInstructionHandlerFunc([this](std::shared_ptr<WebXInstruction> instruction) {
-        const std::lock_guard<std::mutex> lock(this->_instructionsMutex);
-        this->_instructions.push_back(instruction);
+        {
+            const std::lock_guard<std::mutex> lock(this->_instructionsMutex);
+            this->_instructions.push_back(instruction);
+        }
+
+        // Wake the controller to handle the instruction immediately
+        this->_wakeupNotifier.notify();
     });
 
     // Set the client registry functions in the gateway
-    this->_gateway.setClientConnectFunc([this](const WebXVersion & clientVersion) { return this->_clientRegistry.addClient(clientVersion); });
-    this->_gateway.setClientDisconnectFunc([this](uint32_t clientId) { return this->_clientRegistry.removeClient(clientId); });
+    this->_gateway.setClientConnectFunc([this](const WebXVersion & clientVersion) {
+        auto result = this->_clientRegistry.addClient(clientVersion);
+        this->_wakeupNotifier.notify();
+        return result;
+    });
+    this->_gateway.setClientDisconnectFunc([this](uint32_t clientId) {
+        auto result = this->_clientRegistry.removeClient(clientId);
+        this->_wakeupNotifier.notify();
+        return result;
+    });
 
     // Listen to events from the display
     this->_manager.setDisplayEventHandler([this](WebXDisplayEventType eventType) { this->onDisplayEvent(eventType); });
-    this->_manager.setDamageEventHandler([this](const WebXWindowDamage damage) { this->_clientRegistry.addWindowDamage(damage); });
+    this->_manager.setDamageEventHandler([this](const std::vector<WebXWindowDamage> & damages) { this->_clientRegistry.addWindowDamage(damages); });
     this->_manager.setClipboardEventHandler([this](const std::string clipboardContent) { this->onClipboardEvent(clipboardContent); });
     this->_manager.setScreenResizeEventHandler([this](int width, int height) { this->onScreenResizeEvent(width, height); });
 }
@@ -66,6 +80,7 @@ WebXController::~WebXController() {
 void WebXController::stop() {
     spdlog::info("Shutdown");
     this->_state = WebXControllerState::Stopped;
+    this->_wakeupNotifier.notify();
 
     // Disconnect all clients
     this->_clientRegistry.disconnectAll();
@@ -90,30 +105,29 @@ void WebXController::run(bool testing) {
         this->_clientRegistry.addClient(WebXVersion());
     }
 
-    long calculateThreadSleepUs = this->_threadSleepUs;
-    std::chrono::high_resolution_clock::time_point lastTime = std::chrono::high_resolution_clock::now();
-    std::chrono::high_resolution_clock::time_point lastMouseRefreshTime = lastTime;
+    std::chrono::high_resolution_clock::time_point lastWindowRefreshTime = std::chrono::high_resolution_clock::now();
+    std::chrono::high_resolution_clock::time_point lastMouseRefreshTime = lastWindowRefreshTime;
 
     WebXDisplay * display = this->_manager.getDisplay();
     WebXMouse * mouse = display->getMouse();
 
     this->_state = WebXControllerState::Running;
     while (this->_state != WebXControllerState::Stopped) {
-        if (calculateThreadSleepUs > 0) {
-            std::this_thread::sleep_for(std::chrono::microseconds(calculateThreadSleepUs));
-        }
+        // Sleep until an instruction or X11 event arrives or until a window refresh (or periodic task) is due
+        this->waitForEvents(this->calculateWaitTimeUs(lastMouseRefreshTime));
 
         if (this->_state != WebXControllerState::Stopped) {
             std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double, std::micro> delayUs = start - lastTime;
             std::chrono::duration<double, std::milli> timeSinceMouseRefreshMs = start - lastMouseRefreshTime;
-            lastTime = start;
 
             // Handle all client instructions
             this->handleClientInstructions(display);
 
             // Handle all pending X11 events
-            this->_manager.handlePendingEvents();
+            this->_manager.handlePendingEvents(this->_clientRegistry.getNumberOfGroups() > 0);
+
+            // Inject the input received while handling the events
+            this->handleInputInstructions(display);
 
             // If window layout has changed, send layout to clients
             if (this->_displayDirty) {
@@ -132,7 +146,11 @@ void WebXController::run(bool testing) {
             }
 
             // Update necessary images of the client windows
-            float imageSizeKB = this->updateClientWindows(display);
+            bool hasRefreshedWindows = false;
+            float imageSizeKB = this->updateClientWindows(display, hasRefreshedWindows);
+
+            // Inject the input received while updating the windows
+            this->handleInputInstructions(display);
 
             // Check if the mouse has been moved by some other application (or locally)
             if (timeSinceMouseRefreshMs.count() > MOUSE_REFRESH_DELAY_MS) {
@@ -140,113 +158,251 @@ void WebXController::run(bool testing) {
                 if (mouse->isDirty()) {
                     this->notifyMousePositionChanged(mouse);
                     mouse->setDirty(false);
-                    lastMouseRefreshTime = std::chrono::high_resolution_clock::now();
                 }
+                lastMouseRefreshTime = std::chrono::high_resolution_clock::now();
             }
 
             std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double, std::micro> durationUs = end - start;
             long duration = durationUs.count();
-            calculateThreadSleepUs = duration > this->_threadSleepUs ? 0 : this->_threadSleepUs - duration;
 
-            float fps = 1000000 / delayUs.count();
-            this->_stats.updateFrameData(fps, 0.001 * duration, imageSizeKB);
+            // Shed load while the updates refreshing windows overrun their budget and restore the quality once there is headroom again
+            if (this->_clientRegistry.getNumberOfGroups() > 0 && this->_overloadGovernor.update(0.001 * duration, hasRefreshedWindows, display->getEncoderWorkerMetrics(), this->_gateway.getMessageLaneMetrics())) {
+                this->_clientRegistry.setQualityLimit(this->_overloadGovernor.getQualityLimit());
+            }
+
+            this->_stats.updateOverloadData(this->_overloadGovernor.getLevel(), this->_overloadGovernor.getQualityLimit().index);
+
+            // Frames are the updates refreshing windows: the other wakeups only handle input and events
+            if (hasRefreshedWindows) {
+                std::chrono::duration<double, std::micro> frameIntervalUs = start - lastWindowRefreshTime;
+                lastWindowRefreshTime = start;
+
+                float fps = 1000000 / frameIntervalUs.count();
+                this->_stats.updateFrameData(fps, 0.001 * duration, imageSizeKB);
+            }
         }
     }
 
     spdlog::info("Stopped WebX Controller");
 }
 
+long WebXController::calculateWaitTimeUs(const std::chrono::high_resolution_clock::time_point & lastMouseRefreshTime) const {
+    // Wake up when a deferred (coalesced) window layout update or the periodic verification of the stacking order is due
+    // (without clients the stacking order is only verified at the next layout update)
+    WebXOptional<std::chrono::high_resolution_clock::time_point> nextDisplayUpdateTime = this->_manager.getNextDisplayUpdateTime();
+    if (this->_clientRegistry.getNumberOfGroups() > 0) {
+        WebXOptional<std::chrono::high_resolution_clock::time_point> nextStackingOrderCheckTime = this->_manager.getNextStackingOrderCheckTime();
+        if (nextStackingOrderCheckTime.hasValue() && (!nextDisplayUpdateTime.hasValue() || nextStackingOrderCheckTime.value() < nextDisplayUpdateTime.value())) {
+            nextDisplayUpdateTime = nextStackingOrderCheckTime;
+        }
+    }
+
+    // Nothing else is periodic when no clients are connected: wait for X11 events or client instructions
+    if (this->_clientRegistry.getNumberOfGroups() == 0 && !nextDisplayUpdateTime.hasValue()) {
+        return -1;
+    }
+
+    // Poll the mouse position (client pings and clipboard updates are handled at the same time)
+    std::chrono::high_resolution_clock::time_point nextWakeupTime = lastMouseRefreshTime + std::chrono::milliseconds(MOUSE_REFRESH_DELAY_MS);
+    if (this->_clientRegistry.getNumberOfGroups() == 0 || (nextDisplayUpdateTime.hasValue() && nextDisplayUpdateTime.value() < nextWakeupTime)) {
+        nextWakeupTime = nextDisplayUpdateTime.value();
+    }
+
+    // Wake up when a damaged window can next be refreshed
+    WebXOptional<std::chrono::high_resolution_clock::time_point> nextWindowRefreshTime = this->_clientRegistry.getNextWindowRefreshTime();
+    if (nextWindowRefreshTime.hasValue() && nextWindowRefreshTime.value() < nextWakeupTime) {
+        nextWakeupTime = nextWindowRefreshTime.value();
+    }
+
+    std::chrono::duration<double, std::micro> waitTimeUs = nextWakeupTime - std::chrono::high_resolution_clock::now();
+    return waitTimeUs.count() > 0 ? (long)waitTimeUs.count() : 0;
+}
+
+void WebXController::waitForEvents(long timeoutUs) {
+    // Events already read by Xlib do not make the connection readable
+    if (this->_manager.hasQueuedEvents()) {
+        timeoutUs = 0;
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = this->_manager.getConnectionFd();
+    fds[0].events = POLLIN;
+    fds[1].fd = this->_wakeupNotifier.getFd();
+    fds[1].events = POLLIN;
+
+    if (timeoutUs < 0) {
+        ppoll(fds, 2, NULL, NULL);
+
+    } else if (timeoutUs > 0) {
+        struct timespec timeout;
+        timeout.tv_sec = timeoutUs / 1000000;
+        timeout.tv_nsec = (timeoutUs % 1000000) * 1000;
+        ppoll(fds, 2, &timeout, NULL);
+    }
+
+    // Clear notifications: instructions received from now on will trigger a new wakeup
+    this->_wakeupNotifier.reset();
+}
+
 void WebXController::handleClientInstructions(WebXDisplay * display) {
-    std::lock_guard<std::mutex> lock(this->_instructionsMutex);
+    // Instructions are handled without holding the lock so that the transport is never blocked
+    std::vector<std::shared_ptr<WebXInstruction>> instructions;
+    {
+        std::lock_guard<std::mutex> lock(this->_instructionsMutex);
+        instructions.swap(this->_instructions);
+    }
+
+    this->coalesceMouseInstructions(display, instructions);
+
+    for (const auto & instruction : instructions) {
+        this->handleClientInstruction(display, instruction);
+    }
+}
+
+void WebXController::handleInputInstructions(WebXDisplay * display) {
+    // Only the leading mouse and keyboard instructions are handled to preserve the order with the other instructions
+    // (eg a clipboard update followed by a paste)
+    std::vector<std::shared_ptr<WebXInstruction>> instructions;
+    {
+        std::lock_guard<std::mutex> lock(this->_instructionsMutex);
+        auto firstOtherInstruction = std::find_if(this->_instructions.begin(), this->_instructions.end(), [](const std::shared_ptr<WebXInstruction> & instruction) {
+            return instruction->type != WebXInstruction::Type::Mouse && instruction->type != WebXInstruction::Type::Keyboard;
+        });
+        instructions.assign(this->_instructions.begin(), firstOtherInstruction);
+        this->_instructions.erase(this->_instructions.begin(), firstOtherInstruction);
+    }
 
-    for (const auto & instruction : this->_instructions) {
+    if (!instructions.empty()) {
+        this->coalesceMouseInstructions(display, instructions);
 
-        // Verify that the instruction->clientId is known. Reject the instruction if client unknown
-        const std::shared_ptr<WebXClient> & client = this->_clientRegistry.getClientById(instruction->clientId);
-        if (client == nullptr) {
-            spdlog::debug("Ignoring instruction {:d} from unknown client {:08x}", (int)instruction->type, instruction->clientId);
-            continue;
+        for (const auto & instruction : instructions) {
+            this->handleClientInstruction(display, instruction);
         }
+    }
+}
 
-        if (instruction->type == WebXInstruction::Type::Mouse) {
-            auto mouseInstruction = std::static_pointer_cast<WebXMouseInstruction>(instruction);
-            this->onClientMouseInstruction(display, mouseInstruction, client);
-        
-        } else if (instruction->type == WebXInstruction::Type::Keyboard) {
-           auto keyboardInstruction = std::static_pointer_cast<WebXKeyboardInstruction>(instruction);
-            display->sendKeyboard(keyboardInstruction->key, keyboardInstruction->pressed);
+void WebXController::coalesceMouseInstructions(WebXDisplay * display, std::vector<std::shared_ptr<WebXInstruction>> & instructions) const {
+    // A mouse instruction that doesn't change the button mask (pure motion) is replaced by the next mouse instruction of
+    // the same client: only its position is lost. Keyboard instructions are applied at the position of the mouse so
+    // motion is never coalesced across them.
+    std::vector<bool> isPureMotion(instructions.size(), false);
+    int buttonMask = display->getMouse()->getState()->getButtonMask();
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i]->type == WebXInstruction::Type::Mouse) {
+            auto mouseInstruction = std::static_pointer_cast<WebXMouseInstruction>(instructions[i]);
+            isPureMotion[i] = (int)mouseInstruction->buttonMask == buttonMask;
+            buttonMask = mouseInstruction->buttonMask;
+        }
+    }
+
+    std::vector<bool> isCoalesced(instructions.size(), false);
+    std::set<uint32_t> clientsWithLaterMouseInstruction;
+    for (size_t i = instructions.size(); i-- > 0;) {
+        const std::shared_ptr<WebXInstruction> & instruction = instructions[i];
+        if (instruction->type == WebXInstruction::Type::Keyboard) {
+            clientsWithLaterMouseInstruction.clear();
+
+        } else if (instruction->type == WebXInstruction::Type::Mouse) {
+            isCoalesced[i] = isPureMotion[i] && clientsWithLaterMouseInstruction.find(instruction->clientId) != clientsWithLaterMouseInstruction.end();
+            clientsWithLaterMouseInstruction.insert(instruction->clientId);
+        }
+    }
+
+    size_t index = 0;
+    size_t numberOfInstructions = instructions.size();
+    instructions.erase(std::remove_if(instructions.begin(), instructions.end(), [&isCoalesced, &index](const std::shared_ptr<WebXInstruction> &) {
+        return isCoalesced[index++];
+    }), instructions.end());
+
+    if (instructions.size() < numberOfInstructions) {
+        spdlog::trace("Coalesced {:d} mouse motion instructions", numberOfInstructions - instructions.size());
+    }
+}
+
+void WebXController::handleClientInstruction(WebXDisplay * display, const std::shared_ptr<WebXInstruction> & instruction) {
+    // Verify that the instruction->clientId is known. Reject the instruction if client unknown
+    const std::shared_ptr<WebXClient> & client = this->_clientRegistry.getClientById(instruction->clientId);
+    if (client == nullptr) {
+        spdlog::debug("Ignoring instruction {:d} from unknown client {:08x}", (int)instruction->type, instruction->clientId);
+        return;
+    }
+
+    if (instruction->type == WebXInstruction::Type::Mouse) {
+        auto mouseInstruction = std::static_pointer_cast<WebXMouseInstruction>(instruction);
+        this->onClientMouseInstruction(display, mouseInstruction, client);
     
-        } else if (instruction->type == WebXInstruction::Type::Screen) {
-            // Send message to specific client
-            this->sendMessage(std::make_shared<WebXScreenMessage>(
-                client->getIndex(), instruction->id, 
-                display->getScreenSize(), 
-                WebXQuality::MaxQuality().index, 
-                WebXVersion(WEBX_ENGINE_VERSION),
-                display->canResizeScreen(),
-                display->getKeyboardLayoutName()));
-
-        } else if (instruction->type == WebXInstruction::Type::Windows) {
-            // Send message to specific client
-            this->sendMessage(std::make_shared<WebXWindowsMessage>(client->getIndex(), instruction->id, display->getVisibleWindowsProperties()));
-        
-        } else if (instruction->type == WebXInstruction::Type::Image) {
-            auto imageInstruction = std::static_pointer_cast<WebXImageInstruction>(instruction);
-            // Client request full window image: make it the best quality 
-            const WebXQuality & quality = WebXQuality::MaxQuality();
-            std::shared_ptr<WebXImage> image = display->getImage(imageInstruction->windowId, quality);
-
-            // Send message to specific client
-            this->sendMessage(std::make_shared<WebXImageMessage>(client->getIndex(), instruction->id, imageInstruction->windowId, image));
+    } else if (instruction->type == WebXInstruction::Type::Keyboard) {
+       auto keyboardInstruction = std::static_pointer_cast<WebXKeyboardInstruction>(instruction);
+        display->sendKeyboard(keyboardInstruction->key, keyboardInstruction->pressed);
+
+    } else if (instruction->type == WebXInstruction::Type::Screen) {
+        // Send message to specific client
+        this->sendMessage(std::make_shared<WebXScreenMessage>(
+            client->getIndexMask(), instruction->id, 
+            display->getScreenSize(), 
+            WebXQuality::MaxQuality().index, 
+            WebXVersion(WEBX_ENGINE_VERSION),
+            display->canResizeScreen(),
+            display->getKeyboardLayoutName()));
+
+    } else if (instruction->type == WebXInstruction::Type::Windows) {
+        // Send message to specific client
+        this->sendMessage(std::make_shared<WebXWindowsMessage>(client->getIndexMask(), instruction->id, display->getVisibleWindowsProperties()));
+    
+    } else if (instruction->type == WebXInstruction::Type::Image) {
+        auto imageInstruction = std::static_pointer_cast<WebXImageInstruction>(instruction);
+        // Client request full window image: make it the best quality 
+        const WebXQuality & quality = WebXQuality::MaxQuality();
+        std::shared_ptr<WebXImage> image = display->getImage(imageInstruction->windowId, quality);
+
+        // Send message to specific client
+        this->sendMessage(std::make_shared<WebXImageMessage>(client->getIndexMask(), instruction->id, imageInstruction->windowId, image));
+    
+    } else if (instruction->type == WebXInstruction::Type::Shape) {
+        auto shapeInstruction = std::static_pointer_cast<WebXShapeInstruction>(instruction);
+        std::shared_ptr<WebXImage> shape = display->getWindowShapeMask(shapeInstruction->windowId);
+
+        // Send message to specific client
+        this->sendMessage(std::make_shared<WebXShapeMessage>(client->getIndexMask(), instruction->id, shapeInstruction->windowId, shape));
+
+    } else if (instruction->type == WebXInstruction::Type::Cursor) {
+        auto cursorImageInstruction = std::static_pointer_cast<WebXCursorImageInstruction>(instruction);
+
+        WebXMouse * mouse = display->getMouse();
+        WebXMouseState * mouseState = mouse->getState();
+        std::shared_ptr<WebXMouseCursor> mouseCursor = mouse->getCursor(cursorImageInstruction->cursorId);
         
-        } else if (instruction->type == WebXInstruction::Type::Shape) {
-            auto shapeInstruction = std::static_pointer_cast<WebXShapeInstruction>(instruction);
-            std::shared_ptr<WebXImage> shape = display->getWindowShapeMask(shapeInstruction->windowId);
-
-            // Send message to specific client
-            this->sendMessage(std::make_shared<WebXShapeMessage>(client->getIndex(), instruction->id, shapeInstruction->windowId, shape));
-
-        } else if (instruction->type == WebXInstruction::Type::Cursor) {
-            auto cursorImageInstruction = std::static_pointer_cast<WebXCursorImageInstruction>(instruction);
-
-            WebXMouse * mouse = display->getMouse();
-            WebXMouseState * mouseState = mouse->getState();
-            std::shared_ptr<WebXMouseCursor> mouseCursor = mouse->getCursor(cursorImageInstruction->cursorId);
-            
-            // Send message to specific client
-            this->sendMessage(std::make_shared<WebXCursorImageMessage>(client->getIndex(), instruction->id, mouseState->getX(), mouseState->getY(), mouseCursor->getXhot(), mouseCursor->getYhot(), mouseCursor->getId(), mouseCursor->getImage()));
-
-        } else if (instruction->type == WebXInstruction::Type::Quality) {
-            auto qualityInstruction = std::static_pointer_cast<WebXQualityInstruction>(instruction);
-            uint32_t qualityIndex = qualityInstruction->qualityIndex;
-            this->_clientRegistry.setClientMaxQuality(qualityInstruction->clientId, WebXQuality::QualityForIndex(qualityIndex));
-
-        } else if (instruction->type == WebXInstruction::Type::Pong) {
-            auto pongInstruction = std::static_pointer_cast<WebXPongInstruction>(instruction);
-            this->_clientRegistry.onPongReceived(pongInstruction->clientId, pongInstruction->sendTimestampMs, pongInstruction->recvTimestampMs);
-
-        } else if (instruction->type == WebXInstruction::Type::DataAck) {
-            auto dataAckInstruction = std::static_pointer_cast<WebXDataAckInstruction>(instruction);
-            this->_clientRegistry.onDataAckReceived(dataAckInstruction->clientId, dataAckInstruction->sendTimestampMs, dataAckInstruction->recvTimestampMs, dataAckInstruction->dataLength);
-
-        } else if (instruction->type == WebXInstruction::Type::Clipboard) {
-            auto clipboardInstruction = std::static_pointer_cast<WebXClipboardInstruction>(instruction);
-            this->_manager.setClipboardContent(clipboardInstruction->clipboardContent);
-
-        } else if (instruction->type == WebXInstruction::Type::ScreenResize) {
-            auto resizeInstruction = std::static_pointer_cast<WebXScreenResizeInstruction>(instruction);
-            display->resizeScreen(resizeInstruction->width, resizeInstruction->height);
-
-        } else if (instruction->type == WebXInstruction::Type::KeyboardLayout) {
-            auto keyboardLayoutInstruction = std::static_pointer_cast<WebXKeyboardLayoutInstruction>(instruction);
-            if (display->loadKeyboardLayout(keyboardLayoutInstruction->keyboardLayout)) {
-                this->sendMessage(std::make_shared<WebXKeyboardLayoutMessage>(GLOBAL_CLIENT_INDEX_MASK, keyboardLayoutInstruction->keyboardLayout));
-            }
+        // Send message to specific client
+        this->sendMessage(std::make_shared<WebXCursorImageMessage>(client->getIndexMask(), instruction->id, mouseState->getX(), mouseState->getY(), mouseCursor->getXhot(), mouseCursor->getYhot(), mouseCursor->getId(), mouseCursor->getImage()));
+
+    } else if (instruction->type == WebXInstruction::Type::Quality) {
+        auto qualityInstruction = std::static_pointer_cast<WebXQualityInstruction>(instruction);
+        uint32_t qualityIndex = qualityInstruction->qualityIndex;
+        this->_clientRegistry.setClientMaxQuality(qualityInstruction->clientId, WebXQuality::QualityForIndex(qualityIndex));
+
+    } else if (instruction->type == WebXInstruction::Type::Pong) {
+        auto pongInstruction = std::static_pointer_cast<WebXPongInstruction>(instruction);
+        this->_clientRegistry.onPongReceived(pongInstruction->clientId, pongInstruction->sendTimestampMs, pongInstruction->recvTimestampMs);
+
+    } else if (instruction->type == WebXInstruction::Type::DataAck) {
+        auto dataAckInstruction = std::static_pointer_cast<WebXDataAckInstruction>(instruction);
+        this->_clientRegistry.onDataAckReceived(dataAckInstruction->clientId, dataAckInstruction->sendTimestampMs, dataAckInstruction->recvTimestampMs, dataAckInstruction->dataLength);
+
+    } else if (instruction->type == WebXInstruction::Type::Clipboard) {
+        auto clipboardInstruction = std::static_pointer_cast<WebXClipboardInstruction>(instruction);
+        this->_manager.setClipboardContent(clipboardInstruction->clipboardContent);
+
+    } else if (instruction->type == WebXInstruction::Type::ScreenResize) {
+        auto resizeInstruction = std::static_pointer_cast<WebXScreenResizeInstruction>(instruction);
+        display->resizeScreen(resizeInstruction->width, resizeInstruction->height);
+
+    } else if (instruction->type == WebXInstruction::Type::KeyboardLayout) {
+        auto keyboardLayoutInstruction = std::static_pointer_cast<WebXKeyboardLayoutInstruction>(instruction);
+        if (display->loadKeyboardLayout(keyboardLayoutInstruction->keyboardLayout)) {
+            this->sendMessage(std::make_shared<WebXKeyboardLayoutMessage>(GLOBAL_CLIENT_INDEX_MASK, keyboardLayoutInstruction->keyboardLayout));
         }
     }
-
-    this->_instructions.clear();
 }
 
 void WebXController::notifyDisplayChanged(WebXDisplay * display) {
@@ -260,13 +416,26 @@ void WebXController::handleClientPings() {
     this->_clientRegistry.handleClientPings();
 }
 
-float WebXController::updateClientWindows(WebXDisplay * display) {
+float WebXController::updateClientWindows(WebXDisplay * display, bool & hasRefreshedWindows) {
     // Send all current window visibilities to registry to update all current visible client windows and their coverage
     this->_clientRegistry.updateVisibleWindows(display->getWindowVisiblities());
 
-    // Handle all necessary damage in the client windows
+    // Share window captures and encoded images between client groups during this update
+    bool useImageCache = this->_clientRegistry.getNumberOfGroups() > 1;
+    if (useImageCache) {
+        display->activateImageCache();
+    }
+
+    // Handle all necessary damage in the client windows: images are grabbed and queued for encoding, the
+    // returned (deferred) results send the encoded images once all the windows of a group have been queued
     float totalImageSizeKB = 0.0;
-    this->_clientRegistry.handleWindowGraphicalUpdates([&](const std::unique_ptr<WebXClientWindow> & window, uint64_t clientIndexMask) { 
+    size_t refreshedWindows = this->_clientRegistry.handleWindowGraphicalUpdates([&](const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask) { 
+
+        // Window grabs can be long: inject the input received in the meantime
+        this->handleInputInstructions(display);
+
+        // The cost of the refresh excludes the input injection
+        std::chrono::high_resolution_clock::time_point refreshStartTime = std::chrono::high_resolution_clock::now();
 
         // Handle window shape updates
         if (window->shapeRequiresUpdate()) {
@@ -277,64 +446,180 @@ float WebXController::updateClientWindows(WebXDisplay * display) {
             }
         }
 
-        // Handle window damage
-        const WebXWindowDamage & windowDamage = window->getDamage();
-        if (window->isFullWindowDamage() || window->getDamageAreaRatio() > 0.9) {
-            std::shared_ptr<WebXImage> image = display->getImage(window->getId(), window->getCurrentQuality());
-
-            WebXController::WebXImageUpdateVerification verification = this->verifyImageUpdate(image, window);
-            if (verification.hasChanged) {
-                spdlog::trace("Window 0x{:x} sending encoded image {:d} x {:d} x {:d} @ {:d}KB (rgb = {:d}KB alpha = {:d}KB in {:d}ms)", window->getId(), image->getWidth(), image->getHeight(), image->getDepth(), (int)((1.0 * image->getFullDataSize()) / 1024), (int)((1.0 * image->getRawDataSize()) / 1024), (int)((1.0 * image->getAlphaDataSize()) / 1024), (int)(image->getEncodingTimeUs() / 1000));
+        // Ignore the damaged areas hidden by other windows
+        window->clipDamageToVisibleRegion();
 
-                // Send message group of clients for the window full image update
-                this->sendMessage(std::make_shared<WebXImageMessage>(clientIndexMask, window->getId(), image));
+        // Only send the tiles that have changed if the window has a shadow framebuffer
+        if (this->_settings.controller.shadowFramebufferEnabled && window->getSize().area() > 0) {
+            return this->updateWindowTiles(display, window, clientIndexMask, refreshStartTime, totalImageSizeKB);
+        }
 
-                // Update stats
-                float imageSizeKB = image->getFullDataSize() / 1024.0;
-                totalImageSizeKB += imageSizeKB;
+        // Handle window damage
+        if (window->isFullWindowDamage() || window->getDamageAreaRatio() > 0.9) {
+            // Image is null if the pixels haven't changed since the last full window image
+            std::shared_future<std::shared_ptr<WebXImage>> futureImage = display->getImageAsync(window->getId(), window->getCurrentQuality(), nullptr, window->getPixelChecksum());
 
-                // Return full window transfer data
-                return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), imageSizeKB, verification.rgbChecksum, verification.alphaChecksum));
-            }
+            return this->transferWindowImage(window, clientIndexMask, futureImage, refreshStartTime, totalImageSizeKB);
 
         } else {
             // Get sub image changes
-            std::vector<WebXSubImage> subImages;
-            float totalSubImagesSizeKB = 0.0;
+            std::vector<std::pair<WebXRectangle, std::shared_future<std::shared_ptr<WebXImage>>>> futureSubImages;
             for (const WebXRectangle & area: window->getDamage().getDamagedAreas()) {
-                std::shared_ptr<WebXImage> image = display->getImage(window->getId(), window->getCurrentQuality(), &area);
-                // Check image not null
-                if (image) {
-                    subImages.push_back(WebXSubImage(area, image));
-                    totalSubImagesSizeKB += image->getFullDataSize() / 1024.0;
-                }
+                // Image is null if the pixels haven't changed since the last sub image of the same area
+                futureSubImages.push_back(std::make_pair(area, display->getImageAsync(window->getId(), window->getCurrentQuality(), &area, window->getSubImagePixelChecksum(area))));
             }
 
-            if (subImages.size() > 0) {
-                for (auto it = subImages.begin(); it != subImages.end(); it++) {
-                    const WebXSubImage & subImage = *it;
-                    spdlog::trace("Window 0x{:x} sending encoded subimage {:d} x {:d} x {:d} @ {:d}KB (rgb = {:d}KB alpha = {:d}KB in {:d}ms)", window->getId(), subImage.imageRectangle.size().width(), subImage.imageRectangle.size().height(), subImage.image->getDepth(), (int)((1.0 * subImage.image->getFullDataSize()) / 1024), (int)((1.0 * subImage.image->getRawDataSize()) / 1024), (int)((1.0 * subImage.image->getAlphaDataSize()) / 1024), (int)(subImage.image->getEncodingTimeUs() / 1000));
+            return this->transferWindowSubImages(window, clientIndexMask, futureSubImages, refreshStartTime, totalImageSizeKB);
+        }
+    });
+    hasRefreshedWindows = refreshedWindows > 0;
+
+    if (useImageCache) {
+        const WebXWindowImageCache & imageCache = display->getImageCache();
+        this->_stats.updateImageCacheData(imageCache.getCaptureHits(), imageCache.getCaptureMisses(), imageCache.getImageHits(), imageCache.getImageMisses());
+        display->deactivateImageCache();
+    }
+
+    // Update the encoder worker utilisation
+    this->_stats.updateEncoderWorkerData(display->getEncoderWorkerMetrics());
+
+    // Update the depth and wait times of the message lanes
+    this->_stats.updateMessageLaneData(this->_gateway.getMessageLaneMetrics());
+
+    // Keep the shadow framebuffers within their memory budget
+    if (this->_settings.controller.shadowFramebufferEnabled) {
+        this->_clientRegistry.limitShadowFramebufferMemory((size_t)this->_settings.controller.shadowFramebufferMaxMemoryKB * 1024);
+    }
+
+    // Verify quality settings for each client
+    this->_clientRegistry.performQualityVerification();
+
+    return totalImageSizeKB;
+}
+
+std::future<WebXResult<WebXWindowImageTransferData>> WebXController::updateWindowTiles(WebXDisplay * display, const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask, const std::chrono::high_resolution_clock::time_point & refreshStartTime, float & totalImageSizeKB) {
+    WebXShadowFramebuffer * shadowFramebuffer = window->getShadowFramebuffer(this->_settings.controller.shadowFramebufferTileSize);
+    const WebXQuality & quality = window->getCurrentQuality();
+    
+    // Coarse damage: compare all the tiles of the window if the clients already have all of them
+    bool isFullWindowDamage = window->isFullWindowDamage() || window->getDamageAreaRatio() > 0.9;
+    if (isFullWindowDamage && !shadowFramebuffer->isComplete()) {
+        // Send a full window image and record all the tiles
+        std::shared_ptr<WebXWindowCapture> capture = display->getCapture(window->getId());
+        if (capture) {
+            shadowFramebuffer->update(capture->getRectangle(), [&capture](const WebXRectangle & tile) { return capture->calculateAreaChecksum(tile); });
+            return this->transferWindowImage(window, clientIndexMask, display->encodeCaptureAsync(capture, quality), refreshStartTime, totalImageSizeKB);
+        }
+        return this->transferWindowSubImages(window, clientIndexMask, {}, refreshStartTime, totalImageSizeKB);
+    }
+
+    std::vector<WebXRectangle> tileAreas = isFullWindowDamage ? std::vector<WebXRectangle>{WebXRectangle(0, 0, window->getSize().width(), window->getSize().height())} : shadowFramebuffer->getTileAreas(window->getDamage().getDamagedRegion().getRectangles());
+
+    std::vector<std::pair<WebXRectangle, std::shared_future<std::shared_ptr<WebXImage>>>> futureSubImages;
+    int damagedArea = 0;
+    int changedArea = 0;
+    for (const WebXRectangle & tileArea : tileAreas) {
+        const WebXRectangle * captureArea = isFullWindowDamage ? nullptr : &tileArea;
+        std::shared_ptr<WebXWindowCapture> capture = display->getCapture(window->getId(), captureArea);
+        if (capture) {
+            std::vector<WebXRectangle> changedTileAreas = shadowFramebuffer->update(capture->getRectangle(), [&capture](const WebXRectangle & tile) { return capture->calculateAreaChecksum(tile); });
+            damagedArea += capture->getRectangle().area();
+
+            for (const WebXRectangle & changedTileArea : changedTileAreas) {
+                // Encode only the changed tiles (the complete capture if all have changed or if it can't be cropped)
+                std::shared_ptr<WebXWindowCapture> changedTiles = changedTileArea == capture->getRectangle() ? capture : capture->crop(changedTileArea);
+                if (!changedTiles) {
+                    changedTiles = capture;
+                }
+                changedArea += changedTiles->getRectangle().area();
+
+                futureSubImages.push_back(std::make_pair(changedTiles->getRectangle(), display->encodeCaptureAsync(changedTiles, quality)));
+
+                if (changedTiles == capture) {
+                    break;
                 }
+            }
+        }
+    }
+
+    if (damagedArea > 0) {
+        spdlog::trace("Window 0x{:x} shadow framebuffer: {:d} of {:d} damaged pixels changed", window->getId(), changedArea, damagedArea);
+    }
+
+    return this->transferWindowSubImages(window, clientIndexMask, futureSubImages, refreshStartTime, totalImageSizeKB);
+}
+
+std::future<WebXResult<WebXWindowImageTransferData>> WebXController::transferWindowImage(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask, std::shared_future<std::shared_ptr<WebXImage>> futureImage, const std::chrono::high_resolution_clock::time_point & refreshStartTime, float & totalImageSizeKB) {
+    // The capture has been done on the controller thread, the encoding time is measured by the encoder job
+    std::chrono::duration<float, std::micro> captureDuration = std::chrono::high_resolution_clock::now() - refreshStartTime;
+    float captureTimeUs = captureDuration.count();
+
+    return std::async(std::launch::deferred, [this, &window, &totalImageSizeKB, clientIndexMask, futureImage, captureTimeUs]() {
+        std::shared_ptr<WebXImage> image = futureImage.get();
+        float refreshCostUs = captureTimeUs + (image ? image->getEncodingTimeUs() : 0.0);
+
+        WebXController::WebXImageUpdateVerification verification = this->verifyImageUpdate(image, window);
+        if (verification.hasChanged) {
+            // The (possibly shared) image is sent without its alpha data if the clients already have it
+            std::shared_ptr<WebXImageMessage> imageMessage = std::make_shared<WebXImageMessage>(clientIndexMask, window->getId(), image, verification.alphaIncluded);
+            spdlog::trace("Window 0x{:x} sending encoded image {:d} x {:d} x {:d} @ {:d}KB (rgb = {:d}KB alpha = {:d}KB in {:d}ms)", window->getId(), image->getWidth(), image->getHeight(), image->getDepth(), (int)((1.0 * imageMessage->getImageDataSize()) / 1024), (int)((1.0 * image->getRawDataSize()) / 1024), (int)((1.0 * imageMessage->getAlphaDataSize()) / 1024), (int)(image->getEncodingTimeUs() / 1000));
 
-                // Send message group of clients for the window sub-image updates
-                this->sendMessage(std::make_shared<WebXSubImagesMessage>(clientIndexMask, window->getId(), subImages));
+            // Send message group of clients for the window full image update
+            this->sendMessage(imageMessage);
 
-                // Update stats
-                totalImageSizeKB += totalSubImagesSizeKB;
+            // Update stats
+            float imageSizeKB = imageMessage->getImageDataSize() / 1024.0;
+            totalImageSizeKB += imageSizeKB;
 
-                // Return sub window transfer data
-                return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), totalSubImagesSizeKB));
-            }            
+            // Return full window transfer data
+            return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), imageSizeKB, verification.rgbChecksum, verification.alphaChecksum, image->getPixelChecksum(), refreshCostUs));
         }
 
         // Return ignored window transfer data
-        return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), WebXWindowImageTransferData::WebXWindowImageTransferStatus::Ignored));
+        return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), WebXWindowImageTransferData::WebXWindowImageTransferStatus::Ignored, refreshCostUs));
     });
+}
 
-    // Verify quality settings for each client
-    this->_clientRegistry.performQualityVerification();
+std::future<WebXResult<WebXWindowImageTransferData>> WebXController::transferWindowSubImages(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask, const std::vector<std::pair<WebXRectangle, std::shared_future<std::shared_ptr<WebXImage>>>> & futureSubImages, const std::chrono::high_resolution_clock::time_point & refreshStartTime, float & totalImageSizeKB) {
+    // The captures have been done on the controller thread, the encoding times are measured by the encoder jobs
+    std::chrono::duration<float, std::micro> captureDuration = std::chrono::high_resolution_clock::now() - refreshStartTime;
+    float captureTimeUs = captureDuration.count();
+
+    return std::async(std::launch::deferred, [this, &window, &totalImageSizeKB, clientIndexMask, futureSubImages, captureTimeUs]() {
+        std::vector<WebXSubImage> subImages;
+        std::vector<std::pair<WebXRectangle, uint64_t>> subImagePixelChecksums;
+        float totalSubImagesSizeKB = 0.0;
+        float refreshCostUs = captureTimeUs;
+        for (const auto & futureSubImage : futureSubImages) {
+            std::shared_ptr<WebXImage> image = futureSubImage.second.get();
+            // Check image not null
+            if (image) {
+                refreshCostUs += image->getEncodingTimeUs();
+                subImages.push_back(WebXSubImage(futureSubImage.first, image));
+                subImagePixelChecksums.push_back(std::make_pair(futureSubImage.first, image->getPixelChecksum()));
+                totalSubImagesSizeKB += image->getFullDataSize() / 1024.0;
+            }
+        }
 
-    return totalImageSizeKB;
+        if (subImages.size() > 0) {
+            for (auto it = subImages.begin(); it != subImages.end(); it++) {
+                const WebXSubImage & subImage = *it;
+                spdlog::trace("Window 0x{:x} sending encoded subimage {:d} x {:d} x {:d} @ {:d}KB (rgb = {:d}KB alpha = {:d}KB in {:d}ms)", window->getId(), subImage.imageRectangle.size().width(), subImage.imageRectangle.size().height(), subImage.image->getDepth(), (int)((1.0 * subImage.image->getFullDataSize()) / 1024), (int)((1.0 * subImage.image->getRawDataSize()) / 1024), (int)((1.0 * subImage.image->getAlphaDataSize()) / 1024), (int)(subImage.image->getEncodingTimeUs() / 1000));
+            }
+
+            // Send message group of clients for the window sub-image updates
+            this->sendMessage(std::make_shared<WebXSubImagesMessage>(clientIndexMask, window->getId(), subImages));
+
+            // Update stats
+            totalImageSizeKB += totalSubImagesSizeKB;
+
+            // Return sub window transfer data
+            return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), totalSubImagesSizeKB, subImagePixelChecksums, refreshCostUs));
+        }
+
+        // Return ignored window transfer data
+        return WebXResult<WebXWindowImageTransferData>::Ok(WebXWindowImageTransferData(window->getId(), WebXWindowImageTransferData::WebXWindowImageTransferStatus::Ignored, refreshCostUs));
+    });
 }
 
 void WebXController::onClientMouseInstruction(WebXDisplay * display, const std::shared_ptr<WebXMouseInstruction> & mouseInstruction, const std::shared_ptr<WebXClient> & client) {
@@ -348,13 +633,13 @@ void WebXController::onClientMouseInstruction(WebXDisplay * display, const std::
     // If position has change notify the clients (except the one sending the instruction)
     if (previousMousePosition.x() != mouseInstruction->x || previousMousePosition.y() != mouseInstruction->y) {
         // Set bitmask to all clients except the one sending the instruction (if it exists)
-        uint64_t clientIndexMask = client ? ~client->getIndex() : GLOBAL_CLIENT_INDEX_MASK;
+        WebXClientIndexMask clientIndexMask = client ? ~client->getIndexMask() : GLOBAL_CLIENT_INDEX_MASK;
 
         // Send message with position to all clients (other that the one sending the instruction)
         this->sendMessage(std::make_shared<WebXMouseMessage>(clientIndexMask, mouseInstruction->x, mouseInstruction->y, mouse->getState()->getCursor()->getId()));
 
         // Send message with just cursor Id to the client sending the instruction
-        this->sendMessage(std::make_shared<WebXMouseMessage>(client->getIndex(), -1, -1, mouse->getState()->getCursor()->getId()));
+        this->sendMessage(std::make_shared<WebXMouseMessage>(client->getIndexMask(), -1, -1, mouse->getState()->getCursor()->getId()));
     }
 }
 
@@ -374,10 +659,10 @@ void WebXController::notifyMousePositionChanged(WebXMouse * mouse) {
     this->sendMessage(std::make_shared<WebXMouseMessage>(GLOBAL_CLIENT_INDEX_MASK, mouseState->getX(), mouseState->getY(), mouseState->getCursor()->getId()));
 }
 
-WebXController::WebXImageUpdateVerification WebXController::verifyImageUpdate(std::shared_ptr<WebXImage> & image, const std::unique_ptr<WebXClientWindow> & window) {
+WebXController::WebXImageUpdateVerification WebXController::verifyImageUpdate(const std::shared_ptr<WebXImage> & image, const std::unique_ptr<WebXClientWindow> & window) {
     // Verify that the image is not null
     if (image == nullptr) {
-        return WebXImageUpdateVerification{0, 0, false};
+        return WebXImageUpdateVerification{0, 0, false, false};
     }
 
     if (this->_settings.controller.imageChecksumEnabled) {
@@ -388,22 +673,20 @@ WebXController::WebXImageUpdateVerification WebXController::verifyImageUpdate(st
         // Send event if checksum has changed
         if (rgbChecksum != window->getRGBChecksum()) {
 
-            // Compare alpha checksums
-            if (alphaChecksum == window->getAlphaChecksum()) {
-                bool removed = image->removeAlpha();
-                if (removed) {
-                    spdlog::trace("Removed alpha from image for window 0x{:01x}", window->getId());
-                }
+            // Compare alpha checksums: the alpha data is not sent if unchanged (the image itself is not modified)
+            bool alphaIncluded = alphaChecksum != window->getAlphaChecksum();
+            if (!alphaIncluded && image->getAlphaDataSize() > 0) {
+                spdlog::trace("Omitting unchanged alpha from image for window 0x{:01x}", window->getId());
             }
 
-            return WebXImageUpdateVerification{rgbChecksum, alphaChecksum, true};
+            return WebXImageUpdateVerification{rgbChecksum, alphaChecksum, true, alphaIncluded};
         }
 
-        return WebXImageUpdateVerification{rgbChecksum, alphaChecksum, false};
+        return WebXImageUpdateVerification{rgbChecksum, alphaChecksum, false, false};
     
     } else {
         // No checksum verification: always return true
-        return WebXImageUpdateVerification{0, 0, true};
+        return WebXImageUpdateVerification{0, 0, true, true};
     }
 }
 
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <string>
 #include "WebXStats.h"
+#include "WebXOverloadGovernor.h"
 #include <display/WebXManager.h>
 #include <gateway/WebXGateway.h>
 #include "client/WebXClientRegistry.h"
@@ -16,6 +17,7 @@
 #include <models/WebXSettings.h>
 #include <models/message/WebXClipboardMessage.h>
 #include <models/message/WebXScreenResizeMessage.h>
+#include <utils/WebXEventNotifier.h>
 
 class WebXDisplay;
 class WebXInstruction;
@@ -69,11 +71,13 @@ private:
      * @param rgbChecksum Checksum for the RGB data.
      * @param alphaChecksum Checksum for the alpha data.
      * @param hasChanged Flag indicating if the image has changed.
+     * @param alphaIncluded Flag indicating if the alpha data has to be sent (false if the clients already have it).
      */
     struct WebXImageUpdateVerification {
         uint32_t rgbChecksum;
         uint32_t alphaChecksum;
         bool hasChanged;
+        bool alphaIncluded;
     };
 
     /**
@@ -107,12 +111,47 @@ private:
         this->sendMessage(message);
     }
 
+    /**
+     * @brief Calculates how long the controller can sleep before a window refresh or periodic task is due.
+     * @param lastMouseRefreshTime The time the mouse position was last polled.
+     * @return The time to wait in microseconds, 0 if something is already due or -1 to wait indefinitely.
+     */
+    long calculateWaitTimeUs(const std::chrono::high_resolution_clock::time_point & lastMouseRefreshTime) const;
+
+    /**
+     * @brief Blocks until X11 events are available, a client instruction is received, the controller is stopped or the timeout expires.
+     * @param timeoutUs The maximum time to wait in microseconds (-1 to wait indefinitely).
+     */
+    void waitForEvents(long timeoutUs);
+
     /**
      * @brief Processes client instructions for a given display.
      * @param display Pointer to the WebXDisplay instance.
      */
     void handleClientInstructions(WebXDisplay * display);
 
+    /**
+     * @brief Processes the pending mouse and keyboard instructions that precede any other instruction. Called during
+     * the long steps of the main loop so that input is injected as soon as possible.
+     * @param display Pointer to the WebXDisplay instance.
+     */
+    void handleInputInstructions(WebXDisplay * display);
+
+    /**
+     * @brief Processes a single client instruction.
+     * @param display Pointer to the WebXDisplay instance.
+     * @param instruction Shared pointer to the instruction.
+     */
+    void handleClientInstruction(WebXDisplay * display, const std::shared_ptr<WebXInstruction> & instruction);
+
+    /**
+     * @brief Removes the mouse motion instructions that are followed by another mouse instruction of the same client:
+     * only the newest position is applied. Instructions that change the button mask are always kept.
+     * @param display Pointer to the WebXDisplay instance.
+     * @param instructions The instructions to coalesce (in order of arrival).
+     */
+    void coalesceMouseInstructions(WebXDisplay * display, std::vector<std::shared_ptr<WebXInstruction>> & instructions) const;
+
     /**
      * @brief Notifies that the display has changed.
      * @param display Pointer to the WebXDisplay instance.
@@ -127,9 +166,44 @@ private:
     /**
      * @brief Updates client windows and returns the total data transferred to clients in kilobytes.
      * @param display Pointer to the WebXDisplay instance.
+     * @param hasRefreshedWindows Set to true if windows have been refreshed.
      * @return Total data transferred to clients in kilobytes.
      */
-    float updateClientWindows(WebXDisplay * display);
+    float updateClientWindows(WebXDisplay * display, bool & hasRefreshedWindows);
+
+    /**
+     * @brief Captures the damaged tiles of a window and queues the encoding of those that have changed since they were
+     * last sent (according to the window shadow framebuffer).
+     * @param display Pointer to the WebXDisplay instance.
+     * @param window The client window to update.
+     * @param clientIndexMask The index mask of the clients to send the images to.
+     * @param refreshStartTime The time at which the refresh of the window started on the controller thread.
+     * @param totalImageSizeKB Incremented with the size of the images sent.
+     * @return The deferred result of the transfer.
+     */
+    std::future<WebXResult<WebXWindowImageTransferData>> updateWindowTiles(WebXDisplay * display, const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask, const std::chrono::high_resolution_clock::time_point & refreshStartTime, float & totalImageSizeKB);
+
+    /**
+     * @brief Creates the deferred transfer of a full window image: once encoded, the image is verified and sent to the clients.
+     * @param window The client window.
+     * @param clientIndexMask The index mask of the clients to send the image to.
+     * @param futureImage The future encoded image (can be null).
+     * @param refreshStartTime The time at which the refresh of the window started on the controller thread.
+     * @param totalImageSizeKB Incremented with the size of the image sent.
+     * @return The deferred result of the transfer.
+     */
+    std::future<WebXResult<WebXWindowImageTransferData>> transferWindowImage(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask, std::shared_future<std::shared_ptr<WebXImage>> futureImage, const std::chrono::high_resolution_clock::time_point & refreshStartTime, float & totalImageSizeKB);
+
+    /**
+     * @brief Creates the deferred transfer of window sub images: once encoded, the non-null images are sent to the clients.
+     * @param window The client window.
+     * @param clientIndexMask The index mask of the clients to send the images to.
+     * @param futureSubImages The areas of the sub images and their future encoded images.
+     * @param refreshStartTime The time at which the refresh of the window started on the controller thread.
+     * @param totalImageSizeKB Incremented with the size of the images sent.
+     * @return The deferred result of the transfer.
+     */
+    std::future<WebXResult<WebXWindowImageTransferData>> transferWindowSubImages(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask, const std::vector<std::pair<WebXRectangle, std::shared_future<std::shared_ptr<WebXImage>>>> & futureSubImages, const std::chrono::high_resolution_clock::time_point & refreshStartTime, float & totalImageSizeKB);
 
     /**
      * Handles client mouse instructions. Updates the display and sends the mouse position to clients.
@@ -156,10 +230,11 @@ private:
      * @param image Shared pointer to the WebXImage to be verified.
      * @param window Unique pointer to the WebXClientWindow to be verified.
      * @return Verification data containing checksums and change status.
-     * @note This function checks if the image has changed and updates the alpha channel if necessary.
+     * @note This function checks if the image has changed and if its alpha data has to be sent. The image is not
+     * modified: it can be shared with other client groups.
      * @note It also handles the case where the image is null.
      */
-    WebXImageUpdateVerification verifyImageUpdate(std::shared_ptr<WebXImage> & image, const std::unique_ptr<WebXClientWindow> & window);
+    WebXImageUpdateVerification verifyImageUpdate(const std::shared_ptr<WebXImage> & image, const std::unique_ptr<WebXClientWindow> & window);
 
     /**
      * @brief Sends a message to the gateway to be published to clients.
@@ -170,24 +245,24 @@ private:
     }
 
 private:
-    const static unsigned int THREAD_RATE = 60;
     const static unsigned int DEFAULT_IMAGE_REFRESH_RATE = 30;
     const static unsigned int MOUSE_REFRESH_DELAY_MS = 100;
-    const static uint64_t GLOBAL_CLIENT_INDEX_MASK; // Sets all bits
+    const static WebXClientIndexMask GLOBAL_CLIENT_INDEX_MASK; // Sets all bits
 
     WebXGateway & _gateway;
     const WebXSettings & _settings;
     WebXManager _manager;
     WebXClientRegistry _clientRegistry;
     WebXStats _stats;
+    WebXOverloadGovernor _overloadGovernor;
 
     std::vector<std::shared_ptr<WebXInstruction>> _instructions;
 
     bool _displayDirty;
     bool _cursorDirty;
 
-    long _threadSleepUs;
     std::mutex _instructionsMutex;
+    WebXEventNotifier _wakeupNotifier;
     WebXControllerState _state;
 
 };
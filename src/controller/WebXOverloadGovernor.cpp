@@ -0,0 +1,97 @@
+#include "WebXOverloadGovernor.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+WebXOverloadGovernor::WebXOverloadGovernor(int tickBudgetMs, int maxQueueDepth, int recoveryTimeMs) :
+    _tickBudgetMs(tickBudgetMs),
+    _maxQueueDepth(maxQueueDepth > 0 ? maxQueueDepth : 0),
+    _recoveryTimeMs(recoveryTimeMs),
+    _level(0),
+    _periodStartTime(std::chrono::high_resolution_clock::now()),
+    _headroomStartTime(_periodStartTime),
+    _hasHeadroom(false),
+    _periodRefreshTicks(0),
+    _periodRefreshTickDurationMs(0.0),
+    _periodMaxQueueDepth(0),
+    _periodStartEncoderBusyTimeUs(-1.0) {
+}
+
+WebXOverloadGovernor::~WebXOverloadGovernor() {
+}
+
+bool WebXOverloadGovernor::update(float tickDurationMs, bool hasRefreshedWindows, const std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> & encoderWorkerMetrics, const std::vector<WebXMessageLaneMetrics> & messageLaneMetrics) {
+    if (this->_tickBudgetMs <= 0) {
+        return false;
+    }
+
+    double encoderBusyTimeUs = 0.0;
+    for (const WebXImageEncoderPool::WebXImageEncoderWorkerMetrics & workerMetrics : encoderWorkerMetrics) {
+        encoderBusyTimeUs += workerMetrics.busyTimeUs;
+    }
+
+    size_t queueDepth = 0;
+    for (const WebXMessageLaneMetrics & laneMetrics : messageLaneMetrics) {
+        queueDepth += laneMetrics.depth;
+    }
+
+    if (this->_periodStartEncoderBusyTimeUs < 0.0) {
+        this->_periodStartEncoderBusyTimeUs = encoderBusyTimeUs;
+    }
+
+    if (hasRefreshedWindows) {
+        this->_periodRefreshTicks++;
+        this->_periodRefreshTickDurationMs += tickDurationMs;
+    }
+    this->_periodMaxQueueDepth = std::max(this->_periodMaxQueueDepth, queueDepth);
+
+    std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float, std::milli> periodMs = now - this->_periodStartTime;
+    if (periodMs.count() < EVALUATION_PERIOD_MS) {
+        return false;
+    }
+
+    // Measures of the period
+    float averageTickDurationMs = this->_periodRefreshTicks > 0 ? this->_periodRefreshTickDurationMs / this->_periodRefreshTicks : 0.0;
+    float encoderUtilisation = encoderWorkerMetrics.empty() ? 0.0 : (encoderBusyTimeUs - this->_periodStartEncoderBusyTimeUs) / (1000.0 * periodMs.count() * encoderWorkerMetrics.size());
+    size_t maxQueueDepth = this->_periodMaxQueueDepth;
+
+    this->_periodStartTime = now;
+    this->_periodRefreshTicks = 0;
+    this->_periodRefreshTickDurationMs = 0.0;
+    this->_periodMaxQueueDepth = 0;
+    this->_periodStartEncoderBusyTimeUs = encoderBusyTimeUs;
+
+    bool isOverloaded = averageTickDurationMs > this->_tickBudgetMs || encoderUtilisation > MAX_ENCODER_UTILISATION || (this->_maxQueueDepth > 0 && maxQueueDepth > this->_maxQueueDepth);
+    bool hasHeadroom = averageTickDurationMs < HEADROOM_RATIO * this->_tickBudgetMs && encoderUtilisation < HEADROOM_RATIO * MAX_ENCODER_UTILISATION && (this->_maxQueueDepth == 0 || maxQueueDepth <= HEADROOM_RATIO * this->_maxQueueDepth);
+
+    int previousLevel = this->_level;
+    if (isOverloaded) {
+        // Lower the quality limit by one index for each overloaded period (down to the lowest quality)
+        this->_level = std::min(this->_level + 1, WebXQuality::MaxQuality().index - 1);
+        this->_hasHeadroom = false;
+
+    } else if (hasHeadroom && this->_level > 0) {
+        // Raise the quality limit by one index once the headroom has been sustained for the recovery time
+        if (!this->_hasHeadroom) {
+            this->_hasHeadroom = true;
+            this->_headroomStartTime = now;
+
+        } else {
+            std::chrono::duration<float, std::milli> headroomMs = now - this->_headroomStartTime;
+            if (headroomMs.count() >= this->_recoveryTimeMs) {
+                this->_level--;
+                this->_headroomStartTime = now;
+            }
+        }
+
+    } else {
+        this->_hasHeadroom = false;
+    }
+
+    if (this->_level != previousLevel) {
+        spdlog::info("Controller {:s}: quality limited to {:d} (shedding level {:d}, average update = {:.1f}ms, encoder utilisation = {:.0f}%, queue depth = {:d})", this->_level > previousLevel ? "overloaded" : "recovered", this->getQualityLimit().index, this->_level, averageTickDurationMs, 100.0 * encoderUtilisation, maxQueueDepth);
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,86 @@
+#ifndef WEBX_OVERLOAD_GOVERNOR_H
+#define WEBX_OVERLOAD_GOVERNOR_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <image/WebXImageEncoderPool.h>
+#include <models/WebXMessageLaneMetrics.h>
+#include <models/WebXQuality.h>
+
+/**
+ * @class WebXOverloadGovernor
+ * @brief Sheds load when the controller cannot keep up: lowers the maximum quality (and so the frame rate) of all the
+ * clients while its updates overrun their time budget and restores it once there is headroom again.
+ *
+ * The duration of the controller updates that refresh windows, the utilisation of the image encoder workers and the
+ * depth of the message publisher queue are measured over evaluation periods. Updates that only handle input or events
+ * (waking the controller much more often and taking microseconds) are not included in the average update duration:
+ * they would dilute it and hide the refresh overruns. Each overloaded period increases the shedding level by one,
+ * each level lowering the quality limit by one quality index. The level is decreased only after a recovery time during
+ * which all the measures have stayed well below their limits: measures between the overload and headroom thresholds
+ * keep the current level, avoiding oscillations around the budget.
+ */
+class WebXOverloadGovernor {
+public:
+    /**
+     * @brief Constructor for initializing the governor.
+     * @param tickBudgetMs The average duration allowed for a controller update refreshing windows (0 to disable the governor).
+     * @param maxQueueDepth The number of messages waiting to be published above which the publisher is overloaded.
+     * @param recoveryTimeMs The time with headroom after which the shedding level is decreased.
+     */
+    WebXOverloadGovernor(int tickBudgetMs, int maxQueueDepth, int recoveryTimeMs);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~WebXOverloadGovernor();
+
+    /**
+     * @brief Adds the measures of a controller update and evaluates the load at the end of each period.
+     * @param tickDurationMs The duration of the update in milliseconds.
+     * @param hasRefreshedWindows Whether the update has refreshed windows (only these updates are averaged).
+     * @param encoderWorkerMetrics The cumulative metrics of the image encoder workers.
+     * @param messageLaneMetrics The metrics of the lanes of the message publisher queue.
+     * @return True if the quality limit has changed.
+     */
+    bool update(float tickDurationMs, bool hasRefreshedWindows, const std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> & encoderWorkerMetrics, const std::vector<WebXMessageLaneMetrics> & messageLaneMetrics);
+
+    /**
+     * @brief Gets the current shedding level (0 when not shedding load).
+     * @return The shedding level.
+     */
+    int getLevel() const {
+        return this->_level;
+    }
+
+    /**
+     * @brief Gets the maximum quality allowed for the clients at the current shedding level.
+     * @return The quality limit.
+     */
+    const WebXQuality & getQualityLimit() const {
+        return WebXQuality::QualityForIndex(WebXQuality::MaxQuality().index - this->_level);
+    }
+
+private:
+    const static int EVALUATION_PERIOD_MS = 500;
+    constexpr static float MAX_ENCODER_UTILISATION = 0.9;
+    constexpr static float HEADROOM_RATIO = 0.5;
+
+    const float _tickBudgetMs;
+    const size_t _maxQueueDepth;
+    const int _recoveryTimeMs;
+
+    int _level;
+
+    std::chrono::high_resolution_clock::time_point _periodStartTime;
+    std::chrono::high_resolution_clock::time_point _headroomStartTime;
+    bool _hasHeadroom;
+
+    int _periodRefreshTicks;
+    float _periodRefreshTickDurationMs;
+    size_t _periodMaxQueueDepth;
+    double _periodStartEncoderBusyTimeUs;
+};
+
+#endif /* WEBX_OVERLOAD_GOVERNOR_H */
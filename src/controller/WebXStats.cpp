@@ -1,8 +1,15 @@
 #include "WebXStats.h"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 WebXStats::WebXStats() :
-    _statsCalcTime(std::chrono::high_resolution_clock::now()) {
+    _statsCalcTime(std::chrono::high_resolution_clock::now()),
+    _imageCacheCaptureHits(0),
+    _imageCacheCaptureMisses(0),
+    _imageCacheImageHits(0),
+    _imageCacheImageMisses(0),
+    _overloadLevel(0),
+    _overloadQualityLimitIndex(WebXQuality::MaxQuality().index) {
 }
 
 WebXStats::~WebXStats() {
@@ -32,11 +39,86 @@ void WebXStats::updateFrameData(float fps, float durationMs, float imageSizeKB)
         this->_averageImageMbps = 7.8125 * totalImageSizeKB / durationMs.count(); // (KB * 8 / 1024) / (ms / 1000)
 
         spdlog::trace("Average FPS = {:f}, average frame duration = {:f}ms, average image data rate = {:f} Mb/s", this->_averageFps, this->_averageDurationMs, this->_averageImageMbps);
+        if (this->_imageCacheCaptureMisses > 0) {
+            spdlog::trace("Image cache: captures (hits = {:d}, misses = {:d}), encoded images (hits = {:d}, misses = {:d})", this->_imageCacheCaptureHits, this->_imageCacheCaptureMisses, this->_imageCacheImageHits, this->_imageCacheImageMisses);
+        }
+
+        if (this->_overloadLevel > 0) {
+            spdlog::trace("Overload governor: shedding level = {:d}, quality limit = {:d}", this->_overloadLevel, this->_overloadQualityLimitIndex);
+        }
+
+        this->calculateEncoderWorkerUtilisation(timeSinceCalc.count());
+        this->calculateMessageLaneWaitTimes();
     
         this->_statsCalcTime = now;
     }
 }
 
+void WebXStats::updateImageCacheData(unsigned int captureHits, unsigned int captureMisses, unsigned int imageHits, unsigned int imageMisses) {
+    this->_imageCacheCaptureHits += captureHits;
+    this->_imageCacheCaptureMisses += captureMisses;
+    this->_imageCacheImageHits += imageHits;
+    this->_imageCacheImageMisses += imageMisses;
+}
+
+void WebXStats::calculateEncoderWorkerUtilisation(float periodMs) {
+    this->_encoderWorkerUtilisation.clear();
+    if (this->_encoderWorkerMetrics.size() != this->_previousEncoderWorkerMetrics.size()) {
+        this->_previousEncoderWorkerMetrics = std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics>(this->_encoderWorkerMetrics.size(), WebXImageEncoderPool::WebXImageEncoderWorkerMetrics{0, 0.0});
+    }
+
+    std::string utilisation;
+    uint64_t totalJobs = 0;
+    for (size_t i = 0; i < this->_encoderWorkerMetrics.size(); i++) {
+        const WebXImageEncoderPool::WebXImageEncoderWorkerMetrics & current = this->_encoderWorkerMetrics[i];
+        const WebXImageEncoderPool::WebXImageEncoderWorkerMetrics & previous = this->_previousEncoderWorkerMetrics[i];
+
+        float workerUtilisation = std::min(1.0, (current.busyTimeUs - previous.busyTimeUs) / (1000.0 * periodMs));
+        this->_encoderWorkerUtilisation.push_back(workerUtilisation);
+        totalJobs += current.jobs - previous.jobs;
+
+        utilisation += fmt::format("{:s}{:.0f}%", i == 0 ? "" : ", ", 100.0 * workerUtilisation);
+    }
+    this->_previousEncoderWorkerMetrics = this->_encoderWorkerMetrics;
+
+    if (totalJobs > 0) {
+        spdlog::trace("Encoder workers: {:d} jobs, utilisation = [{:s}]", totalJobs, utilisation);
+    }
+}
+
+void WebXStats::calculateMessageLaneWaitTimes() {
+    this->_messageLaneAverageWaitMs.clear();
+    if (this->_messageLaneMetrics.size() != this->_previousMessageLaneMetrics.size()) {
+        this->_previousMessageLaneMetrics = this->_messageLaneMetrics;
+        for (WebXMessageLaneMetrics & previous : this->_previousMessageLaneMetrics) {
+            previous.messages = 0;
+            previous.waitTimeUs = 0;
+            previous.droppedMessages = 0;
+            previous.droppedBytes = 0;
+        }
+    }
+
+    std::string lanes;
+    for (size_t i = 0; i < this->_messageLaneMetrics.size(); i++) {
+        const WebXMessageLaneMetrics & current = this->_messageLaneMetrics[i];
+        const WebXMessageLaneMetrics & previous = this->_previousMessageLaneMetrics[i];
+
+        uint64_t messages = current.messages - previous.messages;
+        float averageWaitMs = messages > 0 ? 0.001 * (current.waitTimeUs - previous.waitTimeUs) / messages : 0.0;
+        this->_messageLaneAverageWaitMs.push_back(averageWaitMs);
+
+        uint64_t droppedMessages = current.droppedMessages - previous.droppedMessages;
+        uint64_t droppedBytes = current.droppedBytes - previous.droppedBytes;
+
+        lanes += fmt::format("{:s}{:s} (messages = {:d}, depth = {:d}, wait = {:.2f}ms, dropped = {:d} / {:d}KB)", i == 0 ? "" : ", ", current.name, messages, current.depth, averageWaitMs, droppedMessages, droppedBytes / 1024);
+    }
+    this->_previousMessageLaneMetrics = this->_messageLaneMetrics;
+
+    if (!lanes.empty()) {
+        spdlog::trace("Message lanes: {:s}", lanes);
+    }
+}
+
 void WebXStats::removeAncientData() {
     std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
 
@@ -3,6 +3,10 @@
 
 #include <vector>
 #include <chrono>
+#include <cstdint>
+#include <image/WebXImageEncoderPool.h>
+#include <models/WebXMessageLaneMetrics.h>
+#include <models/WebXQuality.h>
 
 /**
  * @class WebXStats
@@ -51,13 +55,48 @@ public:
     virtual ~WebXStats();
 
     /**
-     * @brief Updates the frame data with new statistics.
-     * @param fps Frames per second.
+     * @brief Updates the frame data with new statistics (a frame being a controller update refreshing windows).
+     * @param fps Frames per second (from the interval since the previous frame).
      * @param durationMs Duration of the frame in milliseconds.
      * @param imageSizeKB Size of the frame image in kilobytes.
      */
     void updateFrameData(float fps, float durationMs, float imageSizeKB);
 
+    /**
+     * @brief Adds the image cache hits and misses of a frame (captures and encoded images shared between client groups).
+     * @param captureHits Number of window captures obtained from the cache.
+     * @param captureMisses Number of window captures made.
+     * @param imageHits Number of encoded images obtained from the cache.
+     * @param imageMisses Number of images encoded.
+     */
+    void updateImageCacheData(unsigned int captureHits, unsigned int captureMisses, unsigned int imageHits, unsigned int imageMisses);
+
+    /**
+     * @brief Updates the cumulative metrics of the image encoder workers, used to calculate their utilisation.
+     * @param workerMetrics The number of jobs and busy time of each worker.
+     */
+    void updateEncoderWorkerData(const std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> & workerMetrics) {
+        this->_encoderWorkerMetrics = workerMetrics;
+    }
+
+    /**
+     * @brief Updates the metrics of the lanes of the message publisher queue, used to calculate their wait times.
+     * @param laneMetrics The depth and cumulative counters of each lane.
+     */
+    void updateMessageLaneData(const std::vector<WebXMessageLaneMetrics> & laneMetrics) {
+        this->_messageLaneMetrics = laneMetrics;
+    }
+
+    /**
+     * @brief Updates the state of the overload governor.
+     * @param level The current shedding level (0 when not shedding load).
+     * @param qualityLimitIndex The maximum quality index allowed for the clients.
+     */
+    void updateOverloadData(int level, int qualityLimitIndex) {
+        this->_overloadLevel = level;
+        this->_overloadQualityLimitIndex = qualityLimitIndex;
+    }
+
     /**
      * @brief Gets the average frames per second.
      * @return Average FPS.
@@ -82,12 +121,101 @@ public:
         return this->_averageImageMbps;
     }
 
+    /**
+     * @brief Gets the total number of window captures obtained from the image cache.
+     * @return Number of capture cache hits.
+     */
+    uint64_t imageCacheCaptureHits() const {
+        return this->_imageCacheCaptureHits;
+    }
+
+    /**
+     * @brief Gets the total number of window captures not found in the image cache.
+     * @return Number of capture cache misses.
+     */
+    uint64_t imageCacheCaptureMisses() const {
+        return this->_imageCacheCaptureMisses;
+    }
+
+    /**
+     * @brief Gets the total number of encoded images obtained from the image cache.
+     * @return Number of encoded image cache hits.
+     */
+    uint64_t imageCacheImageHits() const {
+        return this->_imageCacheImageHits;
+    }
+
+    /**
+     * @brief Gets the total number of encoded images not found in the image cache.
+     * @return Number of encoded image cache misses.
+     */
+    uint64_t imageCacheImageMisses() const {
+        return this->_imageCacheImageMisses;
+    }
+
+    /**
+     * @brief Gets the utilisation of each image encoder worker (fraction of time spent encoding) over the last stats period.
+     * @return Utilisation of each worker between 0 and 1 (empty if there are no encoder workers).
+     */
+    const std::vector<float> & encoderWorkerUtilisation() const {
+        return this->_encoderWorkerUtilisation;
+    }
+
+    /**
+     * @brief Gets the average time messages have waited in each lane of the message publisher queue over the last
+     * stats period.
+     * @return Average wait time in milliseconds of each lane (0 for lanes without messages during the period).
+     */
+    const std::vector<float> & messageLaneAverageWaitMs() const {
+        return this->_messageLaneAverageWaitMs;
+    }
+
+    /**
+     * @brief Gets the total number of bytes of the queued messages that have been superseded by newer ones and dropped
+     * before being sent.
+     * @return Number of dropped bytes for all the message lanes.
+     */
+    uint64_t messageDroppedBytes() const {
+        uint64_t droppedBytes = 0;
+        for (const WebXMessageLaneMetrics & laneMetrics : this->_messageLaneMetrics) {
+            droppedBytes += laneMetrics.droppedBytes;
+        }
+        return droppedBytes;
+    }
+
+    /**
+     * @brief Gets the current shedding level of the overload governor.
+     * @return The shedding level (0 when not shedding load).
+     */
+    int overloadLevel() const {
+        return this->_overloadLevel;
+    }
+
+    /**
+     * @brief Gets the maximum quality index allowed for the clients by the overload governor.
+     * @return The quality limit index.
+     */
+    int overloadQualityLimitIndex() const {
+        return this->_overloadQualityLimitIndex;
+    }
+
 private:
     /**
      * @brief Removes outdated frame data from the store.
      */
     void removeAncientData();
 
+    /**
+     * @brief Calculates the utilisation of each encoder worker since the last calculation.
+     * @param periodMs The time elapsed since the last calculation in milliseconds.
+     */
+    void calculateEncoderWorkerUtilisation(float periodMs);
+
+    /**
+     * @brief Calculates the average wait time of the messages of each lane since the last calculation.
+     */
+    void calculateMessageLaneWaitTimes();
+
 private:
     const static int STATS_CALC_TIME_MS = 500;
     const static int FRAME_DATA_RETENTION_TIME_MS = 3000;
@@ -100,6 +228,22 @@ private:
     float _averageFps;
     float _averageDurationMs;
     float _averageImageMbps;
+
+    uint64_t _imageCacheCaptureHits;
+    uint64_t _imageCacheCaptureMisses;
+    uint64_t _imageCacheImageHits;
+    uint64_t _imageCacheImageMisses;
+
+    std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> _encoderWorkerMetrics;
+    std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> _previousEncoderWorkerMetrics;
+    std::vector<float> _encoderWorkerUtilisation;
+
+    std::vector<WebXMessageLaneMetrics> _messageLaneMetrics;
+    std::vector<WebXMessageLaneMetrics> _previousMessageLaneMetrics;
+    std::vector<float> _messageLaneAverageWaitMs;
+
+    int _overloadLevel;
+    int _overloadQualityLimitIndex;
 };
 
 #endif /* WEBX_STATS_H */
\ No newline at end of file
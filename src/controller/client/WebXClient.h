@@ -9,6 +9,7 @@
 #include <models/WebXQuality.h>
 #include <utils/WebXOptional.h>
 #include <models/WebXVersion.h>
+#include <models/WebXClientIndexMask.h>
 
 /**
  * @class WebXClient
@@ -80,14 +81,15 @@ public:
      * and maximum quality level. It also sets the initial ping status, timestamps, and bitrate means.
      * 
      * @param id The unique identifier of the client.
-     * @param index The index mask associated with the client.
+     * @param indexPosition The position of the client in the client index bitmap.
      * @param clientVersion The version of the client.
      * @param maxQuality The maximum quality level allowed for the client.
      * @param pingResponseTimeoutMs The timeout in milliseconds for receiving a ping response from a client
      */
-    WebXClient(uint32_t id, uint64_t index, const WebXVersion & clientVersion, const WebXQuality & maxQuality, const int pingResponseTimeoutMs) :
+    WebXClient(uint32_t id, size_t indexPosition, const WebXVersion & clientVersion, const WebXQuality & maxQuality, const int pingResponseTimeoutMs) :
         _id(id),
-        _index(index),
+        _indexPosition(indexPosition),
+        _indexMask(WebXClientIndexMask::ForPosition(indexPosition)),
         _clientVersion(clientVersion),
         _maxQuality(maxQuality),
         _pingResponseTimeoutMs(pingResponseTimeoutMs),
@@ -116,14 +118,39 @@ public:
     }
 
     /**
-     * @brief Gets the index mask associated with the client.
+     * @brief Gets the index associated with the client.
      * 
-     * This method returns the index mask that is used to identify messages for the client.
+     * This method returns the bit identifying the client in its word of the client index bitmap (for the first 64
+     * clients, the bit in the client index mask of the message header).
      * 
-     * @return The client index mask.
+     * @return The client index.
      */
     uint64_t getIndex() const {
-        return this->_index;
+        return (uint64_t)1 << (this->_indexPosition % WebXClientIndexMask::BITS_PER_WORD);
+    }
+
+    /**
+     * @brief Gets the word of the client index bitmap containing the index of the client (0 for the first 64 clients).
+     * @return The word of the client index.
+     */
+    size_t getIndexWord() const {
+        return this->_indexPosition / WebXClientIndexMask::BITS_PER_WORD;
+    }
+
+    /**
+     * @brief Gets the position of the client in the client index bitmap.
+     * @return The client index position.
+     */
+    size_t getIndexPosition() const {
+        return this->_indexPosition;
+    }
+
+    /**
+     * @brief Gets the index mask used to address messages to the client only.
+     * @return The client index mask.
+     */
+    const WebXClientIndexMask & getIndexMask() const {
+        return this->_indexMask;
     }
 
     /**
@@ -274,7 +301,8 @@ private:
     const static int QUALITY_VERIFICATION_PERIOD_MS = 10000;
 
     const uint32_t _id;
-    const uint64_t _index;
+    const size_t _indexPosition;
+    const WebXClientIndexMask _indexMask;
     const WebXVersion _clientVersion;
     WebXQuality _maxQuality;
     const int _pingResponseTimeoutMs;
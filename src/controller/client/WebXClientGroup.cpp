@@ -5,7 +5,7 @@
 WebXClientGroup::WebXClientGroup(const WebXSettings & settings, const WebXQuality & quality) :
     _settings(settings),
     _quality(quality),
-    _clientIndexMask(0),
+    _clientIndexMask(),
     _averageImageMbps(WebXOptional<float>::Empty()) {
 }
 
@@ -14,44 +14,50 @@ WebXClientGroup::~WebXClientGroup() {
 }
 
 void WebXClientGroup::updateVisibleWindows(const std::vector<const WebXWindowVisibility *> & windowVisibilities) {
-    // Remove windows that no longer exist
-    this->_windows.erase(std::remove_if(this->_windows.begin(), this->_windows.end(), [&windowVisibilities](const std::unique_ptr<WebXClientWindow> & window) {
-        auto it = std::find_if(windowVisibilities.begin(), windowVisibilities.end(), [&window](const WebXWindowVisibility * windowVisibility) {
-            return windowVisibility->getX11Window() == window->getId();
-        });
-
-        return it == windowVisibilities.end();
-    }), this->_windows.end());
-
-    // Add or update windows
+    // Add or update windows, flagging the existing windows that are still visible
+    std::vector<bool> stillVisible(this->_windows.size(), false);
     for (const WebXWindowVisibility * windowVisibility : windowVisibilities) {
-        auto it = std::find_if(this->_windows.begin(), this->_windows.end(), [&windowVisibility](const std::unique_ptr<WebXClientWindow> & window) {
-            return windowVisibility->getX11Window() == window->getId();
-        });
+        auto it = this->_windowPositions.find(windowVisibility->getX11Window());
+        if (it == this->_windowPositions.end()) {
+            this->addWindow(std::unique_ptr<WebXClientWindow>(new WebXClientWindow(windowVisibility->getX11Window(), this->_quality, windowVisibility->getRectangle(), windowVisibility->getCoverage(), windowVisibility->getShapeMaskChecksum(), this->_settings.quality)));
+            this->_windows.back()->setVisibleRegion(windowVisibility->getVisibleRegion());
 
-        if (it == this->_windows.end()) {
-            this->_windows.push_back(std::unique_ptr<WebXClientWindow>(new WebXClientWindow(windowVisibility->getX11Window(), this->_quality, windowVisibility->getRectangle(), windowVisibility->getCoverage(), windowVisibility->getShapeMaskChecksum(), this->_settings.quality)));
-        
-        } else {
-            std::unique_ptr<WebXClientWindow> & window = *it;
+        } else if (it->second < stillVisible.size()) {
+            stillVisible[it->second] = true;
+
+            std::unique_ptr<WebXClientWindow> & window = this->_windows[it->second];
             window->setSize(windowVisibility->getRectangle().size());
             window->setCoverage(windowVisibility->getCoverage());
+            window->setVisibleRegion(windowVisibility->getVisibleRegion());
             window->setShapeMaskChecksum(windowVisibility->getShapeMaskChecksum());
         }
     }
 
+    // Remove windows that no longer exist, keeping the order of the others
+    size_t nextPosition = 0;
+    for (size_t position = 0; position < this->_windows.size(); position++) {
+        if (position < stillVisible.size() && !stillVisible[position]) {
+            this->_windowPositions.erase(this->_windows[position]->getId());
+
+        } else {
+            if (nextPosition != position) {
+                this->_windows[nextPosition] = std::move(this->_windows[position]);
+                this->_windowPositions[this->_windows[nextPosition]->getId()] = nextPosition;
+            }
+            nextPosition++;
+        }
+    }
+    this->_windows.resize(nextPosition);
+
     // Update quality calc for all windows that haven't been refreshed for a while
     for (std::unique_ptr<WebXClientWindow> & window : this->_windows) {
         window->updateQuality();
     }
 }
 
-void WebXClientGroup::handleWindowGraphicalUpdates(std::function<WebXResult<WebXWindowImageTransferData>(const std::unique_ptr<WebXClientWindow> & window, uint64_t clientIndexMask)> updateHandlerFunc) {
-
-    float totalImageSizeKB = 0.0;
-
-    // Handle all windows that have damage and need to be refreshed
-    for (std::unique_ptr<WebXClientWindow> & window : this->_windows) {
+std::vector<WebXClientWindow *> WebXClientGroup::getWindowsToRefresh() const {
+    std::vector<WebXClientWindow *> windowsToRefresh;
+    for (const std::unique_ptr<WebXClientWindow> & window : this->_windows) {
 
         // Get the current calculated window quality
         const WebXQuality & calculatedQuality = window->getCurrentQuality();
@@ -60,26 +66,49 @@ void WebXClientGroup::handleWindowGraphicalUpdates(std::function<WebXResult<WebX
         std::chrono::high_resolution_clock::time_point reference = std::chrono::high_resolution_clock::now() - std::chrono::microseconds(calculatedQuality.imageUpdateTimeUs);
 
         if ((window->hasDamage() || window->shapeRequiresUpdate()) && window->requiresRefresh(reference)) {
-            // Handle the image grab and transfer with quality information
-            WebXResult<WebXWindowImageTransferData> result = updateHandlerFunc(window, this->_clientIndexMask);
-            if (result.ok()) {
-                // If image grab and transfer ok then update the client window data
-                const WebXWindowImageTransferData & transferData = result.data();
-                window->onImageTransfer(transferData);
-
-                // Update total amount of data transferred
-                totalImageSizeKB += transferData.imageSizeKB;
-
-            } else {
-                spdlog::error("Error handling damage for window 0x{:0x} with desired quality level {:d}: {:s}", window->getId(), this->_quality.index, result.error());
-            }
+            windowsToRefresh.push_back(window.get());
+        }
+    }
+    return windowsToRefresh;
+}
 
-            // Reset the damage and shape checksum in the window
-            window->resetDamage();
-            window->resetShapeMaskChecksum();
+void WebXClientGroup::handleWindowGraphicalUpdates(const std::vector<WebXClientWindow *> & scheduledWindows, std::function<std::future<WebXResult<WebXWindowImageTransferData>>(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask)> updateHandlerFunc) {
+
+    float totalImageSizeKB = 0.0;
+
+    // Start the image grab and transfer with quality information of the scheduled windows of the group
+    std::vector<std::pair<WebXClientWindow *, std::future<WebXResult<WebXWindowImageTransferData>>>> pendingResults;
+    for (WebXClientWindow * window : scheduledWindows) {
+        auto it = this->_windowPositions.find(window->getId());
+        if (it != this->_windowPositions.end() && this->_windows[it->second].get() == window) {
+            pendingResults.push_back(std::make_pair(window, updateHandlerFunc(this->_windows[it->second], this->_clientIndexMask)));
         }
     }
 
+    // Wait for the encoding of all the images
+    for (auto & pendingResult : pendingResults) {
+        WebXClientWindow * window = pendingResult.first;
+        WebXResult<WebXWindowImageTransferData> result = pendingResult.second.get();
+        if (result.ok()) {
+            // If image grab and transfer ok then update the client window data
+            const WebXWindowImageTransferData & transferData = result.data();
+            window->onImageTransfer(transferData);
+
+            // Update the estimated cost of refreshing the window (capture and encoding, excluding the waits)
+            window->onRefreshCompleted(transferData.refreshCostUs);
+
+            // Update total amount of data transferred
+            totalImageSizeKB += transferData.imageSizeKB;
+
+        } else {
+            spdlog::error("Error handling damage for window 0x{:0x} with desired quality level {:d}: {:s}", window->getId(), this->_quality.index, result.error());
+        }
+
+        // Reset the damage and shape checksum in the window
+        window->resetDamage();
+        window->resetShapeMaskChecksum();
+    }
+
     if (totalImageSizeKB > 0.0) {
         this->_transferDataPoints.push_back(WebXTransferData(totalImageSizeKB));
     }
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <memory>
+#include <future>
+#include <unordered_map>
 #include "WebXClient.h"
 #include "WebXClientWindow.h"
 #include <utils/WebXResult.h>
@@ -19,7 +21,8 @@ class WebXWindowVisibility;
  * @brief Represents a group of clients sharing the same quality level.
  * 
  * This class manages a collection of clients and their associated windows, handling
- * quality verification, window damage, and visibility updates.
+ * quality verification, window damage, and visibility updates. Windows are kept in creation order (the order in
+ * which refreshes are scheduled) and are looked up by X11 window through a hash table of their positions.
  */
 class WebXClientGroup {
 public:
@@ -65,7 +68,7 @@ public:
 
             // Add client and update client index mask
             this->_clients.push_back(client);
-            this->_clientIndexMask |= client->getIndex();
+            this->_clientIndexMask.set(client->getIndexPosition());
 
             // Reset bitrate data
             client->resetBitrateData(this->_averageImageMbps);
@@ -86,7 +89,7 @@ public:
             }
 
             // Remove clientIndex bits from mask
-            this->_clientIndexMask &= ~client->getIndex();
+            this->_clientIndexMask.reset(client->getIndexPosition());
         }
     }
 
@@ -98,6 +101,14 @@ public:
         return this->_clients.empty();
     }
 
+    /**
+     * @brief Gets the clients of the group.
+     * @return The clients of the group.
+     */
+    const std::vector<std::shared_ptr<WebXClient>> & getClients() const {
+        return this->_clients;
+    }
+
     /**
      * @brief Updates the visibility of windows based on the provided visibility data.
      * @param windowVisibilities A vector of visibility data for windows.
@@ -110,26 +121,64 @@ public:
      */
     void addWindowDamage(const WebXWindowDamage & damage) {
         // See if window exists or create new one
-        auto it = std::find_if(this->_windows.begin(), this->_windows.end(), [&damage](const std::unique_ptr<WebXClientWindow> & window) {
-            return window->getId() == damage.getX11Window();
-        });
-    
+        WebXClientWindow * window = this->getWindow(damage.getX11Window());
+
         // Modify or add window damage
-        if (it == this->_windows.end()) {
-            this->_windows.push_back(std::unique_ptr<WebXClientWindow>(new WebXClientWindow(damage.getX11Window(), this->_quality, damage, this->_settings.quality)));
+        if (window == nullptr) {
+            this->addWindow(std::unique_ptr<WebXClientWindow>(new WebXClientWindow(damage.getX11Window(), this->_quality, damage, this->_settings.quality)));
 
         } else {
-            std::unique_ptr<WebXClientWindow> & window = *it;
             window->addDamage(damage);
         }
     }
 
     /**
-     * @brief Handles window graphical updates by invoking a provided handler function.
-     * @param updateHandlerFunc A function to process window update and return transfer data.
+     * @brief Gets the windows with pending damage (or shape update) whose refresh time at their current quality has come.
+     * @return The windows requiring a refresh, in creation order.
      */
-    void handleWindowGraphicalUpdates(std::function<WebXResult<WebXWindowImageTransferData>(const std::unique_ptr<WebXClientWindow> & window, uint64_t clientIndexMask)> updateHandlerFunc);
+    std::vector<WebXClientWindow *> getWindowsToRefresh() const;
+
+    /**
+     * @brief Handles window graphical updates by invoking a provided handler function. The handler is called for all the
+     * scheduled windows of the group before any of the returned results is obtained, allowing the images to be encoded
+     * in parallel.
+     * @param scheduledWindows The windows (of all the groups) selected for a refresh in this update: the windows of
+     * other groups are ignored.
+     * @param updateHandlerFunc A function to process window update and return the (future) transfer data.
+     */
+    void handleWindowGraphicalUpdates(const std::vector<WebXClientWindow *> & scheduledWindows, std::function<std::future<WebXResult<WebXWindowImageTransferData>>(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask)> updateHandlerFunc);
  
+    /**
+     * @brief Gets the earliest time at which a window with pending damage (or shape update) will require a refresh.
+     * @return The time of the next refresh or empty if no window has pending updates.
+     */
+    WebXOptional<std::chrono::high_resolution_clock::time_point> getNextWindowRefreshTime() const {
+        WebXOptional<std::chrono::high_resolution_clock::time_point> nextRefreshTime = WebXOptional<std::chrono::high_resolution_clock::time_point>::Empty();
+        for (const std::unique_ptr<WebXClientWindow> & window : this->_windows) {
+            if (window->hasDamage() || window->shapeRequiresUpdate()) {
+                std::chrono::high_resolution_clock::time_point windowRefreshTime = window->getNextRefreshTime();
+                if (!nextRefreshTime.hasValue() || windowRefreshTime < nextRefreshTime.value()) {
+                    nextRefreshTime = WebXOptional<std::chrono::high_resolution_clock::time_point>::Value(windowRefreshTime);
+                }
+            }
+        }
+        return nextRefreshTime;
+    }
+
+    /**
+     * @brief Gets the windows of the group that have a shadow framebuffer.
+     * @return Pointers to the windows.
+     */
+    std::vector<WebXClientWindow *> getWindowsWithShadowFramebuffer() const {
+        std::vector<WebXClientWindow *> windows;
+        for (const std::unique_ptr<WebXClientWindow> & window : this->_windows) {
+            if (window->getShadowFramebuffer() != NULL) {
+                windows.push_back(window.get());
+            }
+        }
+        return windows;
+    }
+
     /**
      * @brief Performs quality verification for all clients in the group.
      */
@@ -146,16 +195,36 @@ private:
      */
     void calculateImageMbps();
 
+    /**
+     * @brief Retrieves a window by its X11 window.
+     * @param x11Window The X11 window.
+     * @return A pointer to the window if found, otherwise nullptr.
+     */
+    WebXClientWindow * getWindow(Window x11Window) const {
+        auto it = this->_windowPositions.find(x11Window);
+        return (it != this->_windowPositions.end()) ? this->_windows[it->second].get() : nullptr;
+    }
+
+    /**
+     * @brief Adds a window after the existing ones.
+     * @param window The window to add.
+     */
+    void addWindow(std::unique_ptr<WebXClientWindow> window) {
+        this->_windowPositions[window->getId()] = this->_windows.size();
+        this->_windows.push_back(std::move(window));
+    }
+
 private:
     const static int BITRATE_DATA_RETENTION_TIME_MS = 4000;
     const static int TIME_FOR_VALID_IMAGE_KBPS_MS = 2000;
 
     const WebXSettings & _settings;
     const WebXQuality & _quality;
-    uint64_t _clientIndexMask;
+    WebXClientIndexMask _clientIndexMask;
 
     std::vector<std::shared_ptr<WebXClient>> _clients;
     std::vector<std::unique_ptr<WebXClientWindow>> _windows;
+    std::unordered_map<Window, size_t> _windowPositions;
 
     std::vector<WebXTransferData> _transferDataPoints;
     WebXOptional<float> _averageImageMbps;
@@ -10,7 +10,11 @@ WebXClientRegistry::WebXClientRegistry(const WebXSettings & settings, const std:
     _settings(settings),
     _clientMessageHandler(clientMessageHandler),
     _randomNumberGenerator(std::random_device{}()),
-    _clientIndexMask(0) {
+    _maxClients(settings.transport.maxClients > 0 ? settings.transport.maxClients : 1),
+    _qualityLimitIndex(WebXQuality::MaxQuality().index),
+    _clientIndexMask(),
+    _refreshScheduler(settings.controller.windowRefreshBudgetMs, settings.controller.windowRefreshMaxDeferrals),
+    _clientIndex(std::make_shared<WebXClientIndex>()) {
 
 }
 
@@ -18,18 +22,18 @@ WebXClientRegistry::~WebXClientRegistry() {
 
 }
 
-const WebXResult<std::pair<uint32_t, uint64_t>> WebXClientRegistry::addClient(const WebXVersion & clientVersion) {
+const WebXResult<std::pair<uint32_t, WebXClientIndexMask>> WebXClientRegistry::addClient(const WebXVersion & clientVersion) {
     const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
 
-    // Check we have available indices
-    if (~this->_clientIndexMask == 0) {
-        return WebXResult<std::pair<uint32_t, uint64_t>>::Err("no client indices available");
+    // Get next available index (beyond the first 64 clients only with extended client addressing)
+    size_t clientIndexPosition = 0;
+    while (clientIndexPosition < this->_maxClients && this->_clientIndexMask.test(clientIndexPosition)) {
+        clientIndexPosition++;
     }
 
-    // Get next available index
-    uint64_t clientIndex = 1;
-    while ((clientIndex & this->_clientIndexMask) != 0) {
-        clientIndex <<= 1;
+    // Check we have available indices
+    if (clientIndexPosition == this->_maxClients) {
+        return WebXResult<std::pair<uint32_t, WebXClientIndexMask>>::Err("no client indices available");
     }
 
     // Get unique Id
@@ -40,21 +44,22 @@ const WebXResult<std::pair<uint32_t, uint64_t>> WebXClientRegistry::addClient(co
 
     } while (this->getClientById(clientId) != nullptr);
 
-    const WebXQuality & defaultQuality = WebXQuality::MaxQuality();
+    const WebXQuality & defaultQuality = WebXQuality::QualityForIndex(std::min(WebXQuality::MaxQuality().index, this->_qualityLimitIndex));
 
     // Create client and add index to mask
-    const std::shared_ptr<WebXClient> & client = std::make_shared<WebXClient>(clientId, clientIndex, clientVersion, defaultQuality, this->_settings.controller.clientPingResponseTimeoutMs);
+    const std::shared_ptr<WebXClient> & client = std::make_shared<WebXClient>(clientId, clientIndexPosition, clientVersion, defaultQuality, this->_settings.controller.clientPingResponseTimeoutMs);
     this->_clients.push_back(client);
-    this->_clientIndexMask |= clientIndex;
+    this->_clientIndexMask.set(clientIndexPosition);
 
     // Add to default group (create group if needed)
     const std::shared_ptr<WebXClientGroup> & group = this->getOrCreateGroupByQuality(defaultQuality);
     group->addClient(client);
+    this->updateClientIndex();
 
-    spdlog::debug("Added client with Id {:08x} and index {:016x} (webx-client {:s}) and added to default group ({:d}). Now have {:d} clients connected", clientId, clientIndex, clientVersion.versionString(), defaultQuality.index, this->_clients.size());
+    spdlog::debug("Added client with Id {:08x} and index {:016x} (word {:d}) (webx-client {:s}) and added to default group ({:d}). Now have {:d} clients connected", clientId, client->getIndex(), client->getIndexWord(), clientVersion.versionString(), defaultQuality.index, this->_clients.size());
 
     // Return identifier clientid and index
-    return WebXResult<std::pair<uint32_t, uint64_t>>::Ok(std::pair<uint32_t, uint64_t>(clientId, clientIndex));
+    return WebXResult<std::pair<uint32_t, WebXClientIndexMask>>::Ok(std::pair<uint32_t, WebXClientIndexMask>(clientId, client->getIndexMask()));
 }
 
 const WebXResult<void> WebXClientRegistry::removeClient(uint32_t clientId) {
@@ -70,9 +75,10 @@ const WebXResult<void> WebXClientRegistry::removeClient(uint32_t clientId) {
         spdlog::debug("Removed client with Id {:08x} and index {:016x}. Now have {:d} clients connected", clientId, client->getIndex(), this->_clients.size());
 
         // Remove clientIndex bits from mask
-        this->_clientIndexMask &= ~client->getIndex();
+        this->_clientIndexMask.reset(client->getIndexPosition());
 
         this->removeClientFromGroups(clientId);
+        this->updateClientIndex();
 
         return WebXResult<void>::Ok();
 
@@ -81,6 +87,7 @@ const WebXResult<void> WebXClientRegistry::removeClient(uint32_t clientId) {
 
         // Ensure that client doesn't exist in group anyway
         this->removeClientFromGroups(clientId);
+        this->updateClientIndex();
 
         return WebXResult<void>::Err("client id is unknown");
     }
@@ -95,9 +102,35 @@ void WebXClientRegistry::setClientMaxQuality(uint32_t clientId, const WebXQualit
         client->setMaxQuality(quality);
         const std::shared_ptr<WebXClientGroup> & oldGroup = this->getGroupWithClientId(client->getId());
 
-        // Update the quality if too high
-        if (oldGroup == nullptr || oldGroup->getQuality() != quality) {
-            this->setClientQuality(client, quality);
+        // Update the quality if too high (within the quality limit of all the clients)
+        const WebXQuality & newQuality = WebXQuality::QualityForIndex(this->getClientMaxQualityIndex(client));
+        if (oldGroup == nullptr || oldGroup->getQuality() != newQuality) {
+            this->setClientQuality(client, newQuality);
+        }
+    }
+}
+
+void WebXClientRegistry::setQualityLimit(const WebXQuality & qualityLimit) {
+    const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
+
+    int previousQualityLimitIndex = this->_qualityLimitIndex;
+    this->_qualityLimitIndex = qualityLimit.index;
+
+    for (auto & client : this->_clients) {
+        const std::shared_ptr<WebXClientGroup> & clientGroup = this->getGroupWithClientId(client->getId());
+        if (clientGroup == nullptr) {
+            continue;
+        }
+
+        int qualityIndex = clientGroup->getQuality().index;
+        int maxQualityIndex = this->getClientMaxQualityIndex(client);
+        if (qualityIndex > maxQualityIndex) {
+            // Lower the clients above the limit
+            this->setClientQuality(client, WebXQuality::QualityForIndex(maxQualityIndex));
+
+        } else if (qualityLimit.index > previousQualityLimitIndex && qualityIndex == previousQualityLimitIndex && qualityIndex < maxQualityIndex) {
+            // Restore the clients held by the previous limit (bitrate verification adjusts them afterwards)
+            this->setClientQuality(client, WebXQuality::QualityForIndex(maxQualityIndex));
         }
     }
 }
@@ -120,7 +153,7 @@ void WebXClientRegistry::handleClientPings() {
         spdlog::debug("Ping Timeout for client with Id {:08x} and index {:016x}", client->getId(), client->getIndex());
 
         spdlog::trace("Sending Disconnect to client with Id {:08x} and index {:016x}", client->getId(), client->getIndex());
-        this->_clientMessageHandler(std::make_shared<WebXDisconnectMessage>(client->getIndex()));
+        this->_clientMessageHandler(std::make_shared<WebXDisconnectMessage>(client->getIndexMask()));
 
         this->removeClient(client->getId());
     }
@@ -129,12 +162,32 @@ void WebXClientRegistry::handleClientPings() {
     for (auto & client : this->_clients) {
         if (client->getPingStatus() == WebXClient::RequiresPing) {
             spdlog::trace("Sending Ping to client with Id {:08x} and index {:016x}", client->getId(), client->getIndex());
-            this->_clientMessageHandler(std::make_shared<WebXPingMessage>(client->getIndex()));
+            this->_clientMessageHandler(std::make_shared<WebXPingMessage>(client->getIndexMask()));
             client->onPingSent();
         }
     }
 }
 
+size_t WebXClientRegistry::handleWindowGraphicalUpdates(std::function<std::future<WebXResult<WebXWindowImageTransferData>>(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask)> updateHandlerFunc) {
+    const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
+
+    // Find the windows of all the groups that have damage and need to be refreshed
+    std::vector<WebXClientWindow *> windowsToRefresh;
+    for (auto & group : this->_groups) {
+        std::vector<WebXClientWindow *> groupWindowsToRefresh = group->getWindowsToRefresh();
+        windowsToRefresh.insert(windowsToRefresh.end(), groupWindowsToRefresh.begin(), groupWindowsToRefresh.end());
+    }
+
+    // Keep the most valuable refreshes that fit in the time budget of the update (the others remain pending for the next update)
+    std::vector<WebXClientWindow *> scheduledWindows = this->_refreshScheduler.schedule(windowsToRefresh);
+
+    for (auto & group : this->_groups) {
+        group->handleWindowGraphicalUpdates(scheduledWindows, updateHandlerFunc);
+    }
+
+    return scheduledWindows.size();
+}
+
 void WebXClientRegistry::performQualityVerification() {
     const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
     for (auto & group : this->_groups) {
@@ -171,8 +224,8 @@ void WebXClientRegistry::performQualityVerification() {
 
             int suggestedQualityIndex = quality.index + suggestedQualityDelta;
 
-            // Get max quality for a client
-            int maxQualityIndex = client->getMaxQuality().index;
+            // Get max quality for a client (within the quality limit of all the clients)
+            int maxQualityIndex = this->getClientMaxQualityIndex(client);
 
             suggestedQualityIndex = suggestedQualityIndex < 1 ? 1 : suggestedQualityIndex > maxQualityIndex ? maxQualityIndex : suggestedQualityIndex;
 
@@ -191,11 +244,13 @@ void WebXClientRegistry::disconnectAll() {
 
     for (const std::shared_ptr<WebXClient> & client : this->_clients) {
         spdlog::trace("Sending Disconnect to client with Id {:08x} and index {:016x}", client->getId(), client->getIndex());
-        this->_clientMessageHandler(std::make_shared<WebXDisconnectMessage>(client->getIndex()));
+        this->_clientMessageHandler(std::make_shared<WebXDisconnectMessage>(client->getIndexMask()));
     }
 
     this->_clients.clear();
     this->_groups.clear();
+    this->_clientIndexMask = WebXClientIndexMask();
+    this->updateClientIndex();
 }
 
 void WebXClientRegistry::setClientQuality(std::shared_ptr<WebXClient> client, const WebXQuality & quality) {
@@ -218,9 +273,10 @@ void WebXClientRegistry::setClientQuality(std::shared_ptr<WebXClient> client, co
     
         spdlog::debug("Moved client with Id {:08x} and index {:016x} from group with quality {:d} to {:d}", client->getId(), client->getIndex(), oldGroup->getQuality().index, quality.index);
     }
+    this->updateClientIndex();
 
     spdlog::trace("Sending Quality Message to client with Id {:08x} and index {:016x}", client->getId(), client->getIndex());
-    this->_clientMessageHandler(std::make_shared<WebXQualityMessage>(client->getIndex(), quality));
+    this->_clientMessageHandler(std::make_shared<WebXQualityMessage>(client->getIndexMask(), quality));
 }
 
 void WebXClientRegistry::removeClientFromGroups(uint32_t clientId) {
@@ -244,3 +300,53 @@ void WebXClientRegistry::removeClientFromGroup(uint32_t clientId, const std::sha
         spdlog::trace("Removed empty group with with quality index {:d}. Now have {:d} client groups", group->getQuality().index, this->_groups.size());
     }
 }
+
+void WebXClientRegistry::updateClientIndex() {
+    std::shared_ptr<WebXClientIndex> clientIndex = std::make_shared<WebXClientIndex>();
+    clientIndex->clientsById.reserve(this->_clients.size());
+    clientIndex->clientsByIndexPosition.reserve(this->_clients.size());
+
+    for (const std::shared_ptr<WebXClientGroup> & group : this->_groups) {
+        for (const std::shared_ptr<WebXClient> & client : group->getClients()) {
+            const WebXClientEntry entry = { client, group };
+            clientIndex->clientsById[client->getId()] = entry;
+            clientIndex->clientsByIndexPosition[client->getIndexPosition()] = entry;
+        }
+    }
+
+    // Readers holding the previous tables keep them until they release them
+    std::atomic_store(&this->_clientIndex, std::shared_ptr<const WebXClientIndex>(clientIndex));
+}
+
+void WebXClientRegistry::limitShadowFramebufferMemory(size_t maxMemorySize) {
+    const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
+
+    std::vector<WebXClientWindow *> windows;
+    size_t memorySize = 0;
+    for (auto & group : this->_groups) {
+        for (WebXClientWindow * window : group->getWindowsWithShadowFramebuffer()) {
+            windows.push_back(window);
+            memorySize += window->getShadowFramebuffer()->getMemorySize();
+        }
+    }
+
+    if (memorySize <= maxMemorySize) {
+        return;
+    }
+
+    std::sort(windows.begin(), windows.end(), [](const WebXClientWindow * window1, const WebXClientWindow * window2) {
+        bool isCovered1 = window1->getCoverage().coverage >= 1.0;
+        bool isCovered2 = window2->getCoverage().coverage >= 1.0;
+        if (isCovered1 != isCovered2) {
+            return isCovered1;
+        }
+        return window1->getShadowFramebuffer()->getLastUpdateTime() < window2->getShadowFramebuffer()->getLastUpdateTime();
+    });
+
+    for (auto it = windows.begin(); it != windows.end() && memorySize > maxMemorySize; it++) {
+        WebXClientWindow * window = *it;
+        memorySize -= window->getShadowFramebuffer()->getMemorySize();
+        spdlog::trace("Releasing shadow framebuffer of window 0x{:x} (coverage = {:f})", window->getId(), window->getCoverage().coverage);
+        window->releaseShadowFramebuffer();
+    }
+}
@@ -4,9 +4,12 @@
 #include <vector>
 #include <memory>
 #include <random>
+#include <unordered_map>
+#include <atomic>
 
 #include "WebXClient.h"
 #include "WebXClientGroup.h"
+#include "WebXWindowRefreshScheduler.h"
 #include <utils/WebXResult.h>
 #include <models/WebXQuality.h>
 #include <models/WebXSettings.h>
@@ -19,8 +22,27 @@ class WebXMessage;
  * 
  * This class is responsible for adding, removing, and managing clients, as well as
  * handling client-related events such as pings, data acknowledgments, and window damage.
+ *
+ * Each client has a position in the client index bitmap used to address messages: the first 64 clients are addressed
+ * by the 64-bit mask of the message header, the others (when the maximum number of clients allows it) through the
+ * extended client addressing of the transport.
+ *
+ * Clients are looked up by Id or index position through hash tables that associate each client to its group. The
+ * tables are rebuilt (under the mutex) when clients are added, removed or moved between groups and published as an
+ * immutable snapshot: lookups never take the mutex.
  */
 class WebXClientRegistry {
+private:
+    struct WebXClientEntry {
+        std::shared_ptr<WebXClient> client;
+        std::shared_ptr<WebXClientGroup> group;
+    };
+
+    struct WebXClientIndex {
+        std::unordered_map<uint32_t, WebXClientEntry> clientsById;
+        std::unordered_map<size_t, WebXClientEntry> clientsByIndexPosition;
+    };
+
 public:
     /**
      * @brief Constructor for initializing the client registry.
@@ -37,9 +59,9 @@ public:
     /**
      * @brief Adds a new client to the registry.
      * @param clientVersion The version of the client.
-     * @return A result containing the client ID and index if successful.
+     * @return A result containing the client ID and index mask if successful.
      */
-    const WebXResult<std::pair<uint32_t, uint64_t>> addClient(const WebXVersion & clientVersion);
+    const WebXResult<std::pair<uint32_t, WebXClientIndexMask>> addClient(const WebXVersion & clientVersion);
 
     /**
      * @brief Removes a client from the registry.
@@ -49,7 +71,7 @@ public:
     const WebXResult<void> removeClient(uint32_t clientId);
     
     /**
-     * @brief Checks if a client ID is valid.
+     * @brief Checks if a client ID is valid. Does not lock the registry.
      * @param clientId The ID of the client to check.
      * @return True if the client ID is valid, false otherwise.
      */
@@ -58,17 +80,25 @@ public:
     }
 
     /**
-     * @brief Retrieves a client by its ID.
+     * @brief Retrieves a client by its ID. Does not lock the registry.
      * @param id The ID of the client to retrieve.
      * @return A shared pointer to the client if found, nullptr otherwise.
      */
     std::shared_ptr<WebXClient> getClientById(uint32_t id) const {
-        const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
-        auto it = std::find_if(this->_clients.begin(), this->_clients.end(), [&id](const std::shared_ptr<WebXClient> & client) {
-            return client->getId() == id;
-        });
+        const std::shared_ptr<const WebXClientIndex> clientIndex = std::atomic_load(&this->_clientIndex);
+        auto it = clientIndex->clientsById.find(id);
+        return (it != clientIndex->clientsById.end()) ? it->second.client : nullptr;
+    }
 
-        return (it != this->_clients.end()) ? *it : nullptr;
+    /**
+     * @brief Retrieves a client by its position in the client index bitmap. Does not lock the registry.
+     * @param indexPosition The index position of the client to retrieve.
+     * @return A shared pointer to the client if found, nullptr otherwise.
+     */
+    std::shared_ptr<WebXClient> getClientByIndexPosition(size_t indexPosition) const {
+        const std::shared_ptr<const WebXClientIndex> clientIndex = std::atomic_load(&this->_clientIndex);
+        auto it = clientIndex->clientsByIndexPosition.find(indexPosition);
+        return (it != clientIndex->clientsByIndexPosition.end()) ? it->second.client : nullptr;
     }
 
     /**
@@ -78,6 +108,14 @@ public:
      */
     void setClientMaxQuality(uint32_t clientId, const WebXQuality & quality);
 
+    /**
+     * @brief Sets the maximum quality of all the clients, used to shed load when the engine is overloaded. The clients
+     * above the limit are lowered to it and, when the limit is raised, those held at the previous limit are raised to
+     * the new one (within their own maximum quality).
+     * @param qualityLimit The quality limit.
+     */
+    void setQualityLimit(const WebXQuality & qualityLimit);
+
     /**
      * @brief Handles client pings.
      */
@@ -116,13 +154,15 @@ public:
     }
 
     /**
-     * @brief Adds window damage information to all client groups.
-     * @param damage The window damage information.
+     * @brief Adds a batch of window damage information to all client groups.
+     * @param damages The damage information of each damaged window.
      */
-    void addWindowDamage(const WebXWindowDamage & damage) {
+    void addWindowDamage(const std::vector<WebXWindowDamage> & damages) {
         const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
         for (auto & group : this->_groups) {
-            group->addWindowDamage(damage);
+            for (const WebXWindowDamage & damage : damages) {
+                group->addWindowDamage(damage);
+            }
         }
     }
 
@@ -138,16 +178,46 @@ public:
     }
 
     /**
-     * @brief Handles window graphical updates (damage or shape mask) for all client groups.
+     * @brief Gets the number of client groups (clients sharing the same quality).
+     * @return The number of client groups.
+     */
+    size_t getNumberOfGroups() const {
+        const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
+        return this->_groups.size();
+    }
+
+    /**
+     * @brief Handles window graphical updates (damage or shape mask) for all client groups. When a refresh time budget
+     * is set, it is shared by all the groups: only the most valuable refreshes of all the groups that fit in the budget
+     * are handled, the others are handled in a following call.
      * @param updateHandlerFunc The function to handle window damage.
+     * @return The number of windows refreshed.
+     */
+    size_t handleWindowGraphicalUpdates(std::function<std::future<WebXResult<WebXWindowImageTransferData>>(const std::unique_ptr<WebXClientWindow> & window, const WebXClientIndexMask & clientIndexMask)> updateHandlerFunc);
+
+    /**
+     * @brief Gets the earliest time at which a window of any client group will require a refresh.
+     * @return The time of the next refresh or empty if no window has pending updates.
      */
-    void handleWindowGraphicalUpdates(std::function<WebXResult<WebXWindowImageTransferData>(const std::unique_ptr<WebXClientWindow> & window, uint64_t clientIndexMask)> updateHandlerFunc) {
+    WebXOptional<std::chrono::high_resolution_clock::time_point> getNextWindowRefreshTime() const {
         const std::lock_guard<std::recursive_mutex> lock(this->_mutex);
-        for (auto & group : this->_groups) {
-            group->handleWindowGraphicalUpdates(updateHandlerFunc);
+        WebXOptional<std::chrono::high_resolution_clock::time_point> nextRefreshTime = WebXOptional<std::chrono::high_resolution_clock::time_point>::Empty();
+        for (const auto & group : this->_groups) {
+            WebXOptional<std::chrono::high_resolution_clock::time_point> groupRefreshTime = group->getNextWindowRefreshTime();
+            if (groupRefreshTime.hasValue() && (!nextRefreshTime.hasValue() || groupRefreshTime.value() < nextRefreshTime.value())) {
+                nextRefreshTime = groupRefreshTime;
+            }
         }
+        return nextRefreshTime;
     }
 
+    /**
+     * @brief Releases shadow framebuffers until their total memory is below a limit: those of fully covered windows
+     * are released first, then those that have been idle for the longest time.
+     * @param maxMemorySize The maximum memory in bytes.
+     */
+    void limitShadowFramebufferMemory(size_t maxMemorySize);
+
     /**
      * @brief Performs quality verification for all clients.
      */
@@ -199,11 +269,24 @@ private:
      * @return A shared pointer to the client group if found, nullptr otherwise.
      */
     std::shared_ptr<WebXClientGroup> getGroupWithClientId(uint32_t clientId) const {
-        auto it = std::find_if(this->_groups.begin(), this->_groups.end(), [&clientId](const std::shared_ptr<WebXClientGroup> & group) {
-            return group->getClientById(clientId) != nullptr;
-        });
+        const std::shared_ptr<const WebXClientIndex> clientIndex = std::atomic_load(&this->_clientIndex);
+        auto it = clientIndex->clientsById.find(clientId);
+        return (it != clientIndex->clientsById.end()) ? it->second.group : nullptr;
+    }
 
-        return (it != this->_groups.end()) ? *it : nullptr;
+    /**
+     * @brief Rebuilds the client lookup tables from the groups and publishes them. Must be called with the mutex
+     * held after any change of the clients or of their groups.
+     */
+    void updateClientIndex();
+
+    /**
+     * @brief Gets the maximum quality index of a client within the quality limit of all the clients.
+     * @param client The client.
+     * @return The maximum quality index.
+     */
+    int getClientMaxQualityIndex(const std::shared_ptr<WebXClient> & client) const {
+        return std::min(client->getMaxQuality().index, this->_qualityLimitIndex);
     }
 
     /**
@@ -230,12 +313,16 @@ private:
     const WebXSettings & _settings;
     const std::function<void(std::shared_ptr<WebXMessage> clientMessage)> _clientMessageHandler;
     std::mt19937 _randomNumberGenerator;
-    uint64_t _clientIndexMask;
+    const size_t _maxClients;
+    int _qualityLimitIndex;
+    WebXClientIndexMask _clientIndexMask;
+    WebXWindowRefreshScheduler _refreshScheduler;
 
     mutable std::recursive_mutex _mutex;
 
     std::vector<std::shared_ptr<WebXClient>> _clients;
     std::vector<std::shared_ptr<WebXClientGroup>> _groups;
+    std::shared_ptr<const WebXClientIndex> _clientIndex;
 };
 
 
@@ -2,7 +2,12 @@
 #define WEBX_CLIENT_WINDOW_H
 
 #include <X11/Xlib.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <memory>
 #include "WebXWindowQualityHandler.h"
+#include "WebXShadowFramebuffer.h"
 #include <models/WebXSettings.h>
 #include <models/WebXQuality.h>
 #include <models/WebXRectangle.h>
@@ -35,8 +40,13 @@ public:
         _shapeUpdateTime(std::chrono::high_resolution_clock::now()),
         _rgbChecksum(0),
         _alphaChecksum(0),
+        _pixelChecksum(0),
+        _pixelChecksumQualityIndex(0),
         _shapeMaskChecksum(shapeMaskChecksum),
-        _lastSentShapeMaskChecksum(shapeMaskChecksum) {
+        _lastSentShapeMaskChecksum(shapeMaskChecksum),
+        _isVisibleRegionKnown(false),
+        _refreshCostUs(0.0),
+        _refreshDeferrals(0) {
     }
 
     /**
@@ -54,8 +64,13 @@ public:
         _shapeUpdateTime(std::chrono::high_resolution_clock::now()),
         _rgbChecksum(0),
         _alphaChecksum(0),
+        _pixelChecksum(0),
+        _pixelChecksumQualityIndex(0),
         _shapeMaskChecksum(0),
-        _lastSentShapeMaskChecksum(0) {
+        _lastSentShapeMaskChecksum(0),
+        _isVisibleRegionKnown(false),
+        _refreshCostUs(0.0),
+        _refreshDeferrals(0) {
     }
 
     /**
@@ -144,6 +159,7 @@ public:
     void setSize(const WebXSize & size) {
         if (this->_windowSize != size) {
             this->_windowSize = size;
+            this->resetPixelChecksums();
         }
     }
 
@@ -155,6 +171,25 @@ public:
         this->_qualityHandler.setWindowCoverage(coverage);
     }
 
+    /**
+     * @brief Sets the pixels of the window that are not hidden by other windows.
+     * @param visibleRegion The visible region in window coordinates.
+     */
+    void setVisibleRegion(const WebXRegion & visibleRegion) {
+        this->_visibleRegion = visibleRegion;
+        this->_isVisibleRegionKnown = true;
+    }
+
+    /**
+     * @brief Removes the damaged areas hidden by other windows: they don't need to be grabbed and encoded (the display
+     * reports them as damaged when they are exposed).
+     */
+    void clipDamageToVisibleRegion() {
+        if (this->_isVisibleRegionKnown) {
+            this->_damage.clip(this->_visibleRegion);
+        }
+    }
+
     /**
      * @brief Checks if the window requires a refresh based on the reference time.
      * @param reference The reference time to compare against.
@@ -164,6 +199,14 @@ public:
         return this->_imageRefreshTime < reference;
     }
 
+    /**
+     * @brief Gets the earliest time at which the window can be refreshed again, given its current quality.
+     * @return The time of the next possible refresh.
+     */
+    std::chrono::high_resolution_clock::time_point getNextRefreshTime() const {
+        return this->_imageRefreshTime + std::chrono::microseconds(this->getCurrentQuality().imageUpdateTimeUs);
+    }
+
     /**
      * @brief Gets the RGB checksum of the window.
      * @return The RGB checksum.
@@ -196,6 +239,74 @@ public:
         this->_alphaChecksum = alphaChecksum;
     }
 
+    /**
+     * @brief Gets the checksum of the raw pixels of the last full window image sent to the clients.
+     * @return The pixel checksum, or 0 if unknown or if the image was sent with a different quality.
+     */
+    uint64_t getPixelChecksum() const {
+        return this->getCurrentQuality().index == this->_pixelChecksumQualityIndex ? this->_pixelChecksum : 0;
+    }
+
+    /**
+     * @brief Gets the checksum of the raw pixels of the last sub image sent to the clients for exactly the same area.
+     * @param area The area of the sub image.
+     * @return The pixel checksum, or 0 if unknown, if the area has since been overwritten or if the image was sent with a different quality.
+     */
+    uint64_t getSubImagePixelChecksum(const WebXRectangle & area) const {
+        if (this->getCurrentQuality().index != this->_pixelChecksumQualityIndex) {
+            return 0;
+        }
+
+        auto it = std::find_if(this->_subImagePixelChecksums.begin(), this->_subImagePixelChecksums.end(), [&area](const std::pair<WebXRectangle, uint64_t> & subImagePixelChecksum) {
+            return subImagePixelChecksum.first == area;
+        });
+        return it != this->_subImagePixelChecksums.end() ? it->second : 0;
+    }
+
+    /**
+     * @brief Gets the shadow framebuffer of the window, creating a new one (with all tiles unknown) if it doesn't exist
+     * or if the window size or quality has changed.
+     * @param tileSize The size of the tiles in pixels.
+     * @return Pointer to the shadow framebuffer.
+     */
+    WebXShadowFramebuffer * getShadowFramebuffer(int tileSize) {
+        if (!this->_shadowFramebuffer || !this->_shadowFramebuffer->isValid(this->_windowSize, this->getCurrentQuality().index)) {
+            this->_shadowFramebuffer = std::unique_ptr<WebXShadowFramebuffer>(new WebXShadowFramebuffer(this->_windowSize, tileSize, this->getCurrentQuality().index));
+        }
+        return this->_shadowFramebuffer.get();
+    }
+
+    /**
+     * @brief Gets the shadow framebuffer of the window if it exists.
+     * @return Pointer to the shadow framebuffer or NULL.
+     */
+    const WebXShadowFramebuffer * getShadowFramebuffer() const {
+        return this->_shadowFramebuffer.get();
+    }
+
+    /**
+     * @brief Releases the shadow framebuffer: the next update of the window will send all damaged tiles.
+     */
+    void releaseShadowFramebuffer() {
+        this->_shadowFramebuffer.reset();
+    }
+
+    /**
+     * @brief Gets the size of the window.
+     * @return The window size.
+     */
+    const WebXSize & getSize() const {
+        return this->_windowSize;
+    }
+
+    /**
+     * @brief Gets the coverage of the window by the windows above it.
+     * @return The window coverage.
+     */
+    const WebXWindowCoverage & getCoverage() const {
+        return this->_qualityHandler.getWindowCoverage();
+    }
+
     /**
      * @brief Gets the shapemask checksum of the window.
      * @return The shapemask checksum.
@@ -222,8 +333,14 @@ public:
             this->_alphaChecksum = transferData.alphaChecksum;
             this->_imageRefreshTime = transferData.timestamp;
 
+            // The full window image replaces all previous sub images
+            this->resetPixelChecksums();
+            this->_pixelChecksum = transferData.pixelChecksum;
+
         } else if (transferData.status == WebXWindowImageTransferData::WebXWindowImageTransferStatus::SubWindow) {
             this->_imageRefreshTime = transferData.timestamp;
+
+            this->updateSubImagePixelChecksums(transferData.subImagePixelChecksums);
         }
 
         this->_qualityHandler.onImageTransfer(transferData);
@@ -237,8 +354,81 @@ public:
         this->_lastSentShapeMaskChecksum = this->_shapeMaskChecksum;
     }
 
+    /**
+     * @brief Gets the estimated time to refresh the window (capture and encoding), from the previous refreshes.
+     * @return The estimated refresh time in microseconds (0 if the window has never been refreshed).
+     */
+    float getRefreshCostUs() const {
+        return this->_refreshCostUs;
+    }
+
+    /**
+     * @brief Updates the estimated refresh time with the processing time of a refresh.
+     * @param refreshTimeUs The capture and encoding time of the refresh in microseconds.
+     */
+    void onRefreshCompleted(float refreshTimeUs) {
+        this->_refreshCostUs = this->_refreshCostUs == 0.0 ? refreshTimeUs : (1.0 - REFRESH_COST_SMOOTHING) * this->_refreshCostUs + REFRESH_COST_SMOOTHING * refreshTimeUs;
+        this->_refreshDeferrals = 0;
+    }
+
+    /**
+     * @brief Gets the number of consecutive updates in which a required refresh of the window has been deferred.
+     * @return The number of deferrals.
+     */
+    int getRefreshDeferrals() const {
+        return this->_refreshDeferrals;
+    }
+
+    /**
+     * @brief Records that a required refresh has been deferred to a later update.
+     */
+    void onRefreshDeferred() {
+        this->_refreshDeferrals++;
+    }
+
+private:
+    /**
+     * @brief Forgets all pixel checksums (full window and sub images).
+     */
+    void resetPixelChecksums() {
+        this->_pixelChecksum = 0;
+        this->_pixelChecksumQualityIndex = this->getCurrentQuality().index;
+        this->_subImagePixelChecksums.clear();
+    }
+
+    /**
+     * @brief Stores the pixel checksums of sent sub images. Checksums of previous sub images that overlap the new ones
+     * are invalid (the client content has changed) and are removed, as is the full window checksum.
+     * @param subImagePixelChecksums The areas of the sub images and the checksums of their raw pixels.
+     */
+    void updateSubImagePixelChecksums(const std::vector<std::pair<WebXRectangle, uint64_t>> & subImagePixelChecksums) {
+        if (this->getCurrentQuality().index != this->_pixelChecksumQualityIndex) {
+            this->resetPixelChecksums();
+        }
+        this->_pixelChecksum = 0;
+
+        for (const auto & subImagePixelChecksum : subImagePixelChecksums) {
+            const WebXRectangle & area = subImagePixelChecksum.first;
+            this->_subImagePixelChecksums.erase(std::remove_if(this->_subImagePixelChecksums.begin(), this->_subImagePixelChecksums.end(), [&area](const std::pair<WebXRectangle, uint64_t> & previous) {
+                return previous.first.overlap(area);
+            }), this->_subImagePixelChecksums.end());
+        }
+
+        for (const auto & subImagePixelChecksum : subImagePixelChecksums) {
+            if (subImagePixelChecksum.second != 0) {
+                this->_subImagePixelChecksums.push_back(subImagePixelChecksum);
+            }
+        }
+
+        if (this->_subImagePixelChecksums.size() > MAX_SUB_IMAGE_PIXEL_CHECKSUMS) {
+            this->_subImagePixelChecksums.erase(this->_subImagePixelChecksums.begin(), this->_subImagePixelChecksums.end() - MAX_SUB_IMAGE_PIXEL_CHECKSUMS);
+        }
+    }
+
 private:
     const static int QUALITY_REFRESH_TIME_MS = 500;
+    const static size_t MAX_SUB_IMAGE_PIXEL_CHECKSUMS = 64;
+    constexpr static float REFRESH_COST_SMOOTHING = 0.3;
 
     Window _id;
     WebXWindowDamage _damage;
@@ -250,8 +440,16 @@ private:
 
     uint32_t _rgbChecksum;
     uint32_t _alphaChecksum;
+    uint64_t _pixelChecksum;
+    int _pixelChecksumQualityIndex;
+    std::vector<std::pair<WebXRectangle, uint64_t>> _subImagePixelChecksums;
+    std::unique_ptr<WebXShadowFramebuffer> _shadowFramebuffer;
     uint32_t _shapeMaskChecksum;
     uint32_t _lastSentShapeMaskChecksum;
+    WebXRegion _visibleRegion;
+    bool _isVisibleRegionKnown;
+    float _refreshCostUs;
+    int _refreshDeferrals;
 };
 
 
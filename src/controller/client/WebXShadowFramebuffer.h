@@ -0,0 +1,203 @@
+#ifndef WEBX_SHADOW_FRAMEBUFFER_H
+#define WEBX_SHADOW_FRAMEBUFFER_H
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <models/WebXRectangle.h>
+#include <models/WebXSize.h>
+
+/**
+ * @class WebXShadowFramebuffer
+ * @brief Records the state of the pixels of a window as last sent to a client group, split into fixed-size tiles.
+ *
+ * Rather than a copy of the pixels, the hash of each tile is stored: after a capture the tiles are hashed again and
+ * only those whose hash has changed need to be encoded and sent. A hash of 0 marks a tile whose content is unknown
+ * to the clients (it is always considered as changed).
+ */
+class WebXShadowFramebuffer {
+public:
+    /**
+     * @brief Constructs a WebXShadowFramebuffer instance with all tiles unknown.
+     * @param windowSize The size of the window.
+     * @param tileSize The width and height of the tiles in pixels.
+     * @param qualityIndex The quality index of the images sent to the clients.
+     */
+    WebXShadowFramebuffer(const WebXSize & windowSize, int tileSize, int qualityIndex) :
+        _windowSize(windowSize),
+        _tileSize(tileSize),
+        _columns((windowSize.width() + tileSize - 1) / tileSize),
+        _rows((windowSize.height() + tileSize - 1) / tileSize),
+        _qualityIndex(qualityIndex),
+        _tileChecksums(_columns * _rows, 0),
+        _lastUpdateTime(std::chrono::high_resolution_clock::now()) {}
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~WebXShadowFramebuffer() {}
+
+    /**
+     * @brief Checks if the shadow framebuffer still describes the client image of the window: it is invalid
+     * if the window has been resized or if the images are now sent with a different quality.
+     * @param windowSize The current size of the window.
+     * @param qualityIndex The current quality index of the window.
+     * @return True if the tile hashes can be compared with new captures.
+     */
+    bool isValid(const WebXSize & windowSize, int qualityIndex) const {
+        return this->_windowSize == windowSize && this->_qualityIndex == qualityIndex;
+    }
+
+    /**
+     * @brief Checks if the content of every tile is known (ie a full window image has been sent).
+     * @return True if no tile is unknown.
+     */
+    bool isComplete() const {
+        return std::find(this->_tileChecksums.begin(), this->_tileChecksums.end(), 0) == this->_tileChecksums.end();
+    }
+
+    /**
+     * @brief Converts damaged areas into rectangles aligned to the tile grid (clipped to the window). Each damaged tile
+     * is contained in exactly one of the rectangles.
+     * @param areas The damaged areas of the window.
+     * @return The tile-aligned rectangles covering the damaged areas.
+     */
+    std::vector<WebXRectangle> getTileAreas(const std::vector<WebXRectangle> & areas) const {
+        std::vector<bool> damagedTiles(this->_tileChecksums.size(), false);
+        for (const WebXRectangle & area : areas) {
+            int firstColumn = std::max(0, area.x() / this->_tileSize);
+            int lastColumn = std::min(this->_columns - 1, (area.x() + area.size().width() - 1) / this->_tileSize);
+            int firstRow = std::max(0, area.y() / this->_tileSize);
+            int lastRow = std::min(this->_rows - 1, (area.y() + area.size().height() - 1) / this->_tileSize);
+
+            for (int row = firstRow; row <= lastRow; row++) {
+                for (int column = firstColumn; column <= lastColumn; column++) {
+                    damagedTiles[row * this->_columns + column] = true;
+                }
+            }
+        }
+
+        return this->mergeTiles(damagedTiles);
+    }
+
+    /**
+     * @brief Hashes the tiles of a tile-aligned area of a new capture and stores the hashes.
+     * @param area A tile-aligned area of the window (as returned by getTileAreas or the full window).
+     * @param checksumFunc Function calculating the hash of the captured pixels of a tile.
+     * @return The rectangles covering the tiles that have changed since they were last sent.
+     */
+    std::vector<WebXRectangle> update(const WebXRectangle & area, std::function<uint64_t(const WebXRectangle & tile)> checksumFunc) {
+        std::vector<bool> changedTiles(this->_tileChecksums.size(), false);
+
+        int firstColumn = std::max(0, area.x() / this->_tileSize);
+        int lastColumn = std::min(this->_columns - 1, (area.x() + area.size().width() - 1) / this->_tileSize);
+        int firstRow = std::max(0, area.y() / this->_tileSize);
+        int lastRow = std::min(this->_rows - 1, (area.y() + area.size().height() - 1) / this->_tileSize);
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int column = firstColumn; column <= lastColumn; column++) {
+                uint64_t checksum = checksumFunc(this->getTileRectangle(column, row, column + 1, row + 1));
+                uint64_t & previousChecksum = this->_tileChecksums[row * this->_columns + column];
+                if (checksum != previousChecksum) {
+                    changedTiles[row * this->_columns + column] = true;
+                    previousChecksum = checksum;
+                }
+            }
+        }
+
+        this->_lastUpdateTime = std::chrono::high_resolution_clock::now();
+
+        return this->mergeTiles(changedTiles);
+    }
+
+    /**
+     * @brief Gets the memory used by the shadow framebuffer.
+     * @return The size in bytes.
+     */
+    size_t getMemorySize() const {
+        return sizeof(WebXShadowFramebuffer) + this->_tileChecksums.capacity() * sizeof(uint64_t);
+    }
+
+    /**
+     * @brief Gets the time of the last update of the tile hashes.
+     * @return The time of the last update.
+     */
+    const std::chrono::high_resolution_clock::time_point & getLastUpdateTime() const {
+        return this->_lastUpdateTime;
+    }
+
+private:
+    /**
+     * @brief Calculates the rectangle covering a range of tiles, clipped to the window.
+     * @param firstColumn The first column of the range.
+     * @param firstRow The first row of the range.
+     * @param endColumn The column following the last column of the range.
+     * @param endRow The row following the last row of the range.
+     * @return The rectangle in window coordinates.
+     */
+    WebXRectangle getTileRectangle(int firstColumn, int firstRow, int endColumn, int endRow) const {
+        int x = firstColumn * this->_tileSize;
+        int y = firstRow * this->_tileSize;
+        int width = std::min(endColumn * this->_tileSize, this->_windowSize.width()) - x;
+        int height = std::min(endRow * this->_tileSize, this->_windowSize.height()) - y;
+        return WebXRectangle(x, y, width, height);
+    }
+
+    /**
+     * @brief Groups the flagged tiles into rectangles: horizontal runs of tiles are first found in each row and
+     * identical runs in consecutive rows are then merged.
+     * @param tiles Flags for each tile of the grid.
+     * @return The rectangles covering the flagged tiles.
+     */
+    std::vector<WebXRectangle> mergeTiles(const std::vector<bool> & tiles) const {
+        struct TileRun {
+            int firstColumn;
+            int endColumn;
+            int firstRow;
+        };
+
+        std::vector<WebXRectangle> rectangles;
+        std::vector<TileRun> openRuns;
+        for (int row = 0; row <= this->_rows; row++) {
+            // Find the runs of flagged tiles in the row (none after the last row)
+            std::vector<TileRun> rowRuns;
+            for (int column = 0; row < this->_rows && column < this->_columns; column++) {
+                if (tiles[row * this->_columns + column]) {
+                    if (rowRuns.empty() || rowRuns.back().endColumn != column) {
+                        rowRuns.push_back(TileRun{column, column + 1, row});
+                    } else {
+                        rowRuns.back().endColumn = column + 1;
+                    }
+                }
+            }
+
+            // Extend the identical runs of the previous rows and close the others
+            for (const TileRun & openRun : openRuns) {
+                auto it = std::find_if(rowRuns.begin(), rowRuns.end(), [&openRun](const TileRun & rowRun) {
+                    return rowRun.firstColumn == openRun.firstColumn && rowRun.endColumn == openRun.endColumn;
+                });
+                if (it != rowRuns.end()) {
+                    it->firstRow = openRun.firstRow;
+                } else {
+                    rectangles.push_back(this->getTileRectangle(openRun.firstColumn, openRun.firstRow, openRun.endColumn, row));
+                }
+            }
+            openRuns = rowRuns;
+        }
+
+        return rectangles;
+    }
+
+private:
+    WebXSize _windowSize;
+    int _tileSize;
+    int _columns;
+    int _rows;
+    int _qualityIndex;
+    std::vector<uint64_t> _tileChecksums;
+    std::chrono::high_resolution_clock::time_point _lastUpdateTime;
+};
+
+#endif /* WEBX_SHADOW_FRAMEBUFFER_H */
@@ -65,6 +65,14 @@ public:
      */
     void setWindowCoverage(const WebXWindowCoverage & coverage);
 
+    /**
+     * @brief Gets the coverage area of the window.
+     * @return The window coverage.
+     */
+    const WebXWindowCoverage & getWindowCoverage() const {
+        return this->_coverage;
+    }
+
     /**
      * @brief Gets the current quality level of the window.
      * @return The current quality level.
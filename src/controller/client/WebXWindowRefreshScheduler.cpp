@@ -0,0 +1,79 @@
+#include "WebXWindowRefreshScheduler.h"
+#include "WebXClientWindow.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+WebXWindowRefreshScheduler::WebXWindowRefreshScheduler(int budgetMs, int maxDeferrals) :
+    _budgetUs(1000.0 * budgetMs),
+    _maxDeferrals(maxDeferrals) {
+}
+
+WebXWindowRefreshScheduler::~WebXWindowRefreshScheduler() {
+}
+
+std::vector<WebXClientWindow *> WebXWindowRefreshScheduler::schedule(const std::vector<WebXClientWindow *> & windows) const {
+    if (this->_budgetUs <= 0 || windows.size() <= 1) {
+        return windows;
+    }
+
+    struct WebXRefreshCandidate {
+        WebXClientWindow * window;
+        float costUs;
+        float priority;
+        bool overdue;
+    };
+
+    std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+    std::vector<WebXRefreshCandidate> candidates;
+    for (WebXClientWindow * window : windows) {
+        float costUs = std::max(window->getRefreshCostUs(), (float)MIN_REFRESH_COST_US);
+        bool overdue = window->getRefreshDeferrals() >= this->_maxDeferrals;
+        candidates.push_back(WebXRefreshCandidate{window, costUs, GetRefreshValue(window, now) / costUs, overdue});
+    }
+
+    // Overdue refreshes first, then by value per microsecond (creation order for equal priorities)
+    std::stable_sort(candidates.begin(), candidates.end(), [](const WebXRefreshCandidate & candidate1, const WebXRefreshCandidate & candidate2) {
+        if (candidate1.overdue != candidate2.overdue) {
+            return candidate1.overdue;
+        }
+        return candidate1.priority > candidate2.priority;
+    });
+
+    std::vector<WebXClientWindow *> scheduledWindows;
+    float remainingBudgetUs = this->_budgetUs;
+    int deferredWindows = 0;
+    for (const WebXRefreshCandidate & candidate : candidates) {
+        if (scheduledWindows.empty() || candidate.overdue || candidate.costUs <= remainingBudgetUs) {
+            scheduledWindows.push_back(candidate.window);
+            remainingBudgetUs -= candidate.costUs;
+
+        } else {
+            candidate.window->onRefreshDeferred();
+            deferredWindows++;
+        }
+    }
+
+    if (deferredWindows > 0) {
+        spdlog::trace("Deferred the refresh of {:d} windows (refresh budget of {:.1f}ms)", deferredWindows, 0.001 * this->_budgetUs);
+    }
+
+    return scheduledWindows;
+}
+
+float WebXWindowRefreshScheduler::GetRefreshValue(const WebXClientWindow * window, const std::chrono::high_resolution_clock::time_point & now) {
+    // Time the damage has been waiting since the window could have been refreshed
+    std::chrono::duration<float, std::milli> waitingMs = now - window->getNextRefreshTime();
+    float ageValue = 1.0 + std::max(waitingMs.count(), 0.0f) / 50.0;
+
+    // The window under the mouse is the one the user is most likely to be interacting with
+    const WebXWindowCoverage & coverage = window->getCoverage();
+    float mouseOverValue = coverage.mouseOver ? 4.0 : 1.0;
+
+    // Covered windows are less visible to the user
+    float visibilityValue = 0.25 + 0.75 * (1.0 - std::min(std::max((float)coverage.coverage, 0.0f), 1.0f));
+
+    // Windows degraded to a low quality (by coverage or bitrate) are less important
+    float qualityValue = 0.5 + 0.5 * window->getCurrentQuality().index / WebXQuality::MaxQuality().index;
+
+    return ageValue * mouseOverValue * visibilityValue * qualityValue;
+}
@@ -0,0 +1,60 @@
+#ifndef WEBX_WINDOW_REFRESH_SCHEDULER_H
+#define WEBX_WINDOW_REFRESH_SCHEDULER_H
+
+#include <vector>
+#include <chrono>
+
+class WebXClientWindow;
+
+/**
+ * @class WebXWindowRefreshScheduler
+ * @brief Selects the window refreshes done in an update of all the client groups within a time budget.
+ *
+ * The windows requiring a refresh are ordered by the value of their refresh divided by its estimated cost. The value
+ * increases with the time the damage has been waiting, when the mouse is over the window, with the visible part of
+ * the window and with its quality. The cost is estimated from the previous refreshes of the window: the capture time on
+ * the controller thread plus the encoding time measured by the encoder jobs (the time spent waiting for the encoder
+ * workers, which encode the images of the update in parallel, is not attributed to the windows).
+ * Refreshes are selected in this order until the budget is spent and the others are deferred to the next update. The
+ * most valuable refresh is always done, as are those that have been deferred too many times: a deferred window is
+ * always refreshed eventually.
+ */
+class WebXWindowRefreshScheduler {
+public:
+    /**
+     * @brief Constructor for initializing the scheduler.
+     * @param budgetMs The estimated processing time allowed for the refreshes of an update (0 for no limit).
+     * @param maxDeferrals The number of consecutive deferrals after which a refresh is done whatever the budget.
+     */
+    WebXWindowRefreshScheduler(int budgetMs, int maxDeferrals);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~WebXWindowRefreshScheduler();
+
+    /**
+     * @brief Selects the windows to refresh in the current update. The windows that are not selected are marked as
+     * deferred.
+     * @param windows The windows of all the client groups requiring a refresh, in group and creation order.
+     * @return The windows to refresh, most valuable first.
+     */
+    std::vector<WebXClientWindow *> schedule(const std::vector<WebXClientWindow *> & windows) const;
+
+private:
+    /**
+     * @brief Calculates the value of refreshing a window.
+     * @param window The window.
+     * @param now The current time.
+     * @return The value of the refresh.
+     */
+    static float GetRefreshValue(const WebXClientWindow * window, const std::chrono::high_resolution_clock::time_point & now);
+
+private:
+    const static int MIN_REFRESH_COST_US = 100;
+
+    const float _budgetUs;
+    const int _maxDeferrals;
+};
+
+#endif /* WEBX_WINDOW_REFRESH_SCHEDULER_H */
@@ -1,6 +1,7 @@
 #include "WebXDisplay.h"
 #include "WebXWindow.h"
 #include "WebXRandR.h"
+#include "WebXShmImagePool.h"
 #include <image/WebXJPGImageConverter.h>
 #include <algorithm>
 #include <X11/Xatom.h>
@@ -8,11 +9,20 @@
 #include "input/WebXMouse.h"
 #include "input/WebXKeyboard.h"
 #include <models/WebXWindowCoverage.h>
+#include <models/WebXRegion.h>
+#include <utils/WebXPixelKernels.h>
+#include "WebXErrorHandler.h"
+#include "events/WebXDamageOverride.h"
+#include <set>
 
-WebXDisplay::WebXDisplay(Display * display) :
+WebXDisplay::WebXDisplay(Display * display, const WebXDisplaySettings & settings) :
     _x11Display(display),
+    _settings(settings),
     _rootWindow(NULL),
+    _stackingOrderValid(false),
     _imageConverter(new WebXJPGImageConverter()),
+    _shmImagePool(NULL),
+    _encoderPool(NULL),
     _mouse(NULL),
     _keyboard(NULL),
     _randr(NULL) {
@@ -27,9 +37,19 @@ WebXDisplay::~WebXDisplay() {
 
     this->_rootWindow = NULL;
 
+    if (this->_encoderPool) {
+        delete this->_encoderPool;
+        this->_encoderPool = NULL;
+    }
+
     delete this->_imageConverter;
     this->_imageConverter = NULL;
 
+    if (this->_shmImagePool) {
+        delete this->_shmImagePool;
+        this->_shmImagePool = NULL;
+    }
+
     if (this->_mouse) {
         delete this->_mouse;
         this->_mouse = NULL;
@@ -53,6 +73,20 @@ void WebXDisplay::init() {
     this->_keyboard = new WebXKeyboard(this->_x11Display);
     this->_keyboard->init();
 
+    spdlog::info("Using {:s} pixel kernels", WebXPixelKernels::Get().name);
+
+    if (this->_settings.encoderThreads > 1) {
+        this->_encoderPool = new WebXImageEncoderPool(this->_settings.encoderThreads);
+    }
+
+    if (this->_settings.shmCaptureEnabled) {
+        this->_shmImagePool = new WebXShmImagePool(this->_x11Display);
+        if (!this->_shmImagePool->init()) {
+            delete this->_shmImagePool;
+            this->_shmImagePool = NULL;
+        }
+    }
+
     this->_rootWindow = this->createWindow(rootX11Window, true);
     if (this->_rootWindow) {
         this->createTree(this->_rootWindow);
@@ -95,6 +129,11 @@ WebXWindow * WebXDisplay::createWindowInTree(Window x11Window) {
             spdlog::trace("Added child 0x{:01x} to parent 0x{:01x}", x11Window, parent->getX11Window());
             parent->addChild(window);
 
+            // A top-level window that hasn't been restacked since its creation is on top of its siblings
+            if (parent == this->_rootWindow && std::find(this->_stackingOrder.begin(), this->_stackingOrder.end(), x11Window) == this->_stackingOrder.end()) {
+                this->_stackingOrder.push_back(x11Window);
+            }
+
         } else {
             spdlog::error("Couldn't find parent of window 0x{:01x}", x11Window);
         }
@@ -133,9 +172,22 @@ void WebXDisplay::removeWindowFromTree(Window x11Window) {
     }
 }
 
+void WebXDisplay::destroyWindow(Window x11Window) {
+    // Normally already removed when unmapped
+    this->removeWindowFromTree(x11Window);
+
+    auto it = std::find(this->_stackingOrder.begin(), this->_stackingOrder.end(), x11Window);
+    if (it != this->_stackingOrder.end()) {
+        this->_stackingOrder.erase(it);
+    }
+}
+
 void WebXDisplay::reparentWindow(Window x11Window, Window parentX11Window) {
     WebXWindow * window = this->getWindow(x11Window);
     if (window != NULL) {
+        // The position of the window is now relative to its new parent
+        window->invalidateAttributes();
+
         WebXWindow * parent = window->getParent();
         if (parent != NULL) {
             parent->removeChild(window);
@@ -149,6 +201,84 @@ void WebXDisplay::reparentWindow(Window x11Window, Window parentX11Window) {
             printf("Couldn't find new parent 0x%08lx for window 0X%08lx\n", parentX11Window, x11Window);
         }
     }
+
+    // A window reparented to the root is placed on top of the top-level windows
+    auto it = std::find(this->_stackingOrder.begin(), this->_stackingOrder.end(), x11Window);
+    if (it != this->_stackingOrder.end()) {
+        this->_stackingOrder.erase(it);
+    }
+    if (this->_rootWindow != NULL && parentX11Window == this->_rootWindow->getX11Window()) {
+        this->_stackingOrder.push_back(x11Window);
+    }
+}
+
+void WebXDisplay::restackWindow(Window x11Window, Window aboveX11Window) {
+    auto it = std::find(this->_stackingOrder.begin(), this->_stackingOrder.end(), x11Window);
+    if (it != this->_stackingOrder.end()) {
+        this->_stackingOrder.erase(it);
+    }
+
+    if (aboveX11Window == None) {
+        this->_stackingOrder.insert(this->_stackingOrder.begin(), x11Window);
+
+    } else {
+        auto aboveIt = std::find(this->_stackingOrder.begin(), this->_stackingOrder.end(), aboveX11Window);
+        if (aboveIt != this->_stackingOrder.end()) {
+            this->_stackingOrder.insert(aboveIt + 1, x11Window);
+
+        } else {
+            // Sibling created since the last query of the window tree
+            spdlog::trace("Unknown sibling 0x{:x} of restacked window 0x{:x}: stacking order will be requested", aboveX11Window, x11Window);
+            this->_stackingOrder.push_back(x11Window);
+            this->_stackingOrderValid = false;
+        }
+    }
+}
+
+void WebXDisplay::circulateWindow(Window x11Window, bool placeOnTop) {
+    auto it = std::find(this->_stackingOrder.begin(), this->_stackingOrder.end(), x11Window);
+    if (it != this->_stackingOrder.end()) {
+        this->_stackingOrder.erase(it);
+    }
+
+    if (placeOnTop) {
+        this->_stackingOrder.push_back(x11Window);
+
+    } else {
+        this->_stackingOrder.insert(this->_stackingOrder.begin(), x11Window);
+    }
+}
+
+bool WebXDisplay::updateStackingOrder() {
+    std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+    bool checkIsDue = now - this->_stackingOrderCheckTime >= std::chrono::milliseconds(this->_settings.stackingOrderCheckIntervalMs);
+    if (this->_stackingOrderValid && !checkIsDue) {
+        return false;
+    }
+
+    bool hasChanged = !this->_stackingOrderValid;
+    WebXTreeDetails tree;
+    if (queryTree(this->_x11Display, this->_rootWindow->getX11Window(), tree)) {
+        std::vector<Window> stackingOrder(tree.children, tree.children + tree.numberOfChildren);
+
+        if (this->_stackingOrderValid) {
+            // Verify the order of the known windows (unmapped and destroyed windows are ignored)
+            std::vector<Window> knownWindows;
+            std::vector<Window> knownQueriedWindows;
+            std::copy_if(this->_stackingOrder.begin(), this->_stackingOrder.end(), std::back_inserter(knownWindows), [this](Window x11Window) { return this->getWindow(x11Window) != NULL; });
+            std::copy_if(stackingOrder.begin(), stackingOrder.end(), std::back_inserter(knownQueriedWindows), [this](Window x11Window) { return this->getWindow(x11Window) != NULL; });
+            if (knownWindows != knownQueriedWindows) {
+                spdlog::debug("Window stacking order maintained from events is inconsistent with the X server: it has been updated");
+                hasChanged = true;
+            }
+        }
+
+        this->_stackingOrder.swap(stackingOrder);
+        this->_stackingOrderValid = true;
+    }
+    this->_stackingOrderCheckTime = now;
+
+    return hasChanged;
 }
 
 
@@ -156,40 +286,47 @@ void WebXDisplay::updateVisibleWindows() {
 
     std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
-    this->_rootWindow->updateAttributes();
+    // Attributes are only requested for windows that have been invalidated: geometries are maintained from the X11 events
+    this->_rootWindow->refreshAttributes();
 
     std::lock_guard<std::mutex> lock(this->_visibleWindowsMutex);
 
     // Make a copy of current visible windows
     std::vector<WebXWindow *> oldVisibleWindows = this->_visibleWindows;
-    std::vector<Window> allX11Windows;
+    std::vector<WebXWindow *> damageWindows;
 
     // Clear current list
     this->_visibleWindows.clear();
 
-    WebXTreeDetails tree;
-    if (queryTree(this->_x11Display, this->_rootWindow->getX11Window(), tree)) {
-        for (unsigned int i = 0; i < tree.numberOfChildren; i++) {
-            Window childX11Window = tree.children[i];
-            
-            allX11Windows.push_back(childX11Window);
-            
-            WebXWindow * child = this->getWindow(childX11Window);
-            if (child != NULL) {
-                Status status = child->updateAttributes();
-                if (status && child->isVisible(this->_rootWindow->getRectangle().size())) {
-                    // Bugfix with nvidia: check for id that is 1 less than the root window (seems to be a ghost window that is present when power saving)
-                    if (child->getX11Window() != (this->_rootWindow->getX11Window() - 1)) {
+    // The stacking order is maintained from the X11 events (the window tree is only queried periodically to verify it)
+    this->updateStackingOrder();
+    const std::vector<Window> & allX11Windows = this->_stackingOrder;
+
+    for (Window childX11Window : allX11Windows) {
+        WebXWindow * child = this->getWindow(childX11Window);
+        if (child != NULL) {
+            Status status = child->refreshAttributes();
+            if (status && child->isVisible(this->_rootWindow->getRectangle().size())) {
+                // Bugfix with nvidia: check for id that is 1 less than the root window (seems to be a ghost window that is present when power saving)
+                if (child->getX11Window() != (this->_rootWindow->getX11Window() - 1)) {
+                    if (!this->_settings.asyncRequestsEnabled) {
                         child->enableDamage();
-                        child->updateShape(this->_imageConverter);
-                        this->_visibleWindows.push_back(child);
+
+                    } else if (!child->hasDamage()) {
+                        damageWindows.push_back(child);
                     }
+                    child->updateShape(this->_imageConverter);
+                    this->_visibleWindows.push_back(child);
+                }
 
-                } 
-            }
+            } 
         }
     }
 
+    if (!damageWindows.empty()) {
+        this->enableDamage(damageWindows);
+    }
+
     // Determine which windows are no longer visible and disable damage on them
     for (auto it = oldVisibleWindows.begin(); it != oldVisibleWindows.end(); it++) {
         WebXWindow * oldVisibleWindow = *it;
@@ -216,21 +353,106 @@ void WebXDisplay::updateVisibleWindows() {
     spdlog::trace("Updated visible windows: {:d} windows in {:.2f}ms (update = {:.2f}ms, coverage = {:.2f}ms)", this->_visibleWindows.size(), duration.count(), updateDuration.count(), coverageDuration.count());
 }
 
-void WebXDisplay::updateWindowCoverage() {
+void WebXDisplay::enableDamage(const std::vector<WebXWindow *> & windows) {
+    std::set<Window> x11Windows;
+    for (WebXWindow * window : windows) {
+        x11Windows.insert(window->getX11Window());
+    }
 
-    const WebXMouseState * mouseState = this->getMouse()->getState();
+    // In region mode a single damage event is sent per window and it must not be ignored
+    bool ignoreDamageEvents = this->_settings.damageReportMode == WebXDisplaySettings::RawRectangles;
+
+    if (ignoreDamageEvents) {
+        // Flush all pending events
+        XSync(this->_x11Display, False);
+
+        // Ignore the damage events generated when damage is enabled
+        WebXDamageOverride::setWindowsToIgnore(x11Windows);
+    }
+
+    unsigned long requestSerial = WebXErrorHandler::getNextRequestSerial(this->_x11Display);
+    for (WebXWindow * window : windows) {
+        window->createDamage();
+    }
 
-    // Calculate visible areas of each visible window
-    for (auto it = _visibleWindows.begin(); it != _visibleWindows.end(); it++) {
+    // Flush all events again (ignored via the override in raw mode) and receive any errors
+    XSync(this->_x11Display, False);
+
+    if (ignoreDamageEvents) {
+        WebXDamageOverride::setWindowsToIgnore(std::set<Window>());
+    }
+
+    for (WebXWindow * window : windows) {
+        XErrorEvent error;
+        if (WebXErrorHandler::getError(requestSerial, window->getX11Window(), error)) {
+            spdlog::debug("Failed to enable damage for window 0x{:x} (error 0x{:02x}): it is no longer visible", window->getX11Window(), error.error_code);
+            window->resetDamage();
+
+            auto it = std::find(this->_visibleWindows.begin(), this->_visibleWindows.end(), window);
+            if (it != this->_visibleWindows.end()) {
+                this->_visibleWindows.erase(it);
+            }
+        }
+    }
+}
+
+void WebXDisplay::updateWindowCoverage() {
+
+    // Calculate the visible areas of all the windows in a single pass from the top of the stack: each window is covered
+    // by the union of the windows above it. Windows with a shape cover the lower windows (for the coverage ratio) but
+    // their transparent pixels do not hide them.
+    WebXRegion coveredRegion;
+    WebXRegion occludedRegion;
+    for (auto it = this->_visibleWindows.rbegin(); it != this->_visibleWindows.rend(); it++) {
         WebXWindow * window = *it;
+        const WebXRectangle & rectangle = window->getRectangle();
+        WebXRegion windowRegion(rectangle);
+
+        WebXRegion uncoveredRegion = windowRegion;
+        uncoveredRegion -= coveredRegion;
+        double coverage = rectangle.area() > 0 ? 1.0 - (double)uncoveredRegion.area() / rectangle.area() : 0.0;
+        window->setCoverage(WebXWindowCoverage(coverage, window->getVisibility().getCoverage().mouseOver));
+
+        WebXRegion visibleRegion = windowRegion;
+        visibleRegion -= occludedRegion;
+        visibleRegion.translate(-rectangle.x(), -rectangle.y());
+
+        // Pixels that were hidden are no longer up to date in the clients: they have to be sent when exposed
+        WebXRegion exposedRegion = visibleRegion;
+        exposedRegion -= window->getVisibility().getVisibleRegion();
+        if (!exposedRegion.isEmpty()) {
+            this->_exposedWindowDamage.push_back(WebXWindowDamage(window->getX11Window(), exposedRegion));
+        }
+        window->setVisibleRegion(visibleRegion);
+
+        coveredRegion += windowRegion;
+        if (!window->hasShape()) {
+            occludedRegion += windowRegion;
+        }
+    }
+
+    this->updateMouseOver();
+}
 
-        auto it2 = it;
-        it2++;
-        std::vector<WebXRectangle> coveringRectangles;
-        std::transform(it2, this->_visibleWindows.end(), std::back_inserter(coveringRectangles), [](WebXWindow * window) { return window->getRectangle(); });
+void WebXDisplay::updateMouseOver() {
+    const WebXMouseState * mouseState = this->getMouse()->getState();
 
-        WebXWindowCoverage coverage = WebXWindowCoverage::OverlapCalc(window->getRectangle(), coveringRectangles, mouseState->getX(), mouseState->getY());
-        window->setCoverage(coverage);
+    // The mouse is over the top-most window containing it (the uncovered part of a window is the part not covered by
+    // the windows above it)
+    WebXWindow * mouseOverWindow = NULL;
+    for (auto it = this->_visibleWindows.rbegin(); it != this->_visibleWindows.rend() && mouseOverWindow == NULL; it++) {
+        if ((*it)->getRectangle().contains(mouseState->getX(), mouseState->getY())) {
+            mouseOverWindow = *it;
+        }
+    }
+
+    // Only the mouse-over flags change: the cached coverage ratios are kept until the layout changes
+    for (WebXWindow * window : this->_visibleWindows) {
+        const WebXWindowCoverage & coverage = window->getVisibility().getCoverage();
+        bool mouseOver = window == mouseOverWindow;
+        if (coverage.mouseOver != mouseOver) {
+            window->setCoverage(WebXWindowCoverage(coverage.coverage, mouseOver));
+        }
     }
 }
 
@@ -260,16 +482,83 @@ void WebXDisplay::debugTree(Window window, int indent) {
     }
 }
 
-std::shared_ptr<WebXImage> WebXDisplay::getImage(Window x11Window, const WebXQuality & quality, const WebXRectangle * imageRectangle) {
-    std::shared_ptr<WebXImage> image = nullptr;
-    auto imageConverter = this->_imageConverter;
-    this->callIfWindowVisible(x11Window, [&image, imageRectangle, imageConverter, quality](WebXWindow * window) {
-        image = window->getImage(imageRectangle, imageConverter, quality);
+std::shared_ptr<WebXImage> WebXDisplay::getImage(Window x11Window, const WebXQuality & quality, const WebXRectangle * imageRectangle, uint64_t previousPixelChecksum) {
+    return this->getImageAsync(x11Window, quality, imageRectangle, previousPixelChecksum).get();
+}
+
+std::shared_future<std::shared_ptr<WebXImage>> WebXDisplay::getImageAsync(Window x11Window, const WebXQuality & quality, const WebXRectangle * imageRectangle, uint64_t previousPixelChecksum) {
+    std::promise<std::shared_ptr<WebXImage>> noImagePromise;
+    noImagePromise.set_value(nullptr);
+    const std::shared_future<std::shared_ptr<WebXImage>> noImage = noImagePromise.get_future().share();
+    std::shared_future<std::shared_ptr<WebXImage>> image = noImage;
+
+    this->callIfWindowVisible(x11Window, [this, &image, &noImage, x11Window, imageRectangle, quality, previousPixelChecksum](WebXWindow * window) {
+        std::shared_ptr<WebXWindowCapture> capture = nullptr;
+        bool calculatePixelChecksum = this->_settings.pixelChecksumEnabled;
+
+        if (this->_imageCache.isActive()) {
+            // Use encoded image or capture from another client group if available
+            uint64_t pixelChecksum = 0;
+            if (this->_imageCache.findImage(x11Window, imageRectangle, quality, image, pixelChecksum)) {
+                if (window->isPixelChecksumUnchanged(pixelChecksum, previousPixelChecksum)) {
+                    image = noImage;
+                }
+                return;
+            }
+
+            if (!this->_imageCache.findCapture(x11Window, imageRectangle, capture)) {
+                capture = window->captureImage(imageRectangle, this->_shmImagePool, calculatePixelChecksum);
+                this->_imageCache.putCapture(x11Window, imageRectangle, capture);
+            }
+
+        } else {
+            capture = window->captureImage(imageRectangle, this->_shmImagePool, calculatePixelChecksum);
+        }
+
+        // Avoid encoding pixels that haven't changed
+        if (capture && !window->isPixelChecksumUnchanged(capture->getPixelChecksum(), previousPixelChecksum)) {
+            // When cached, keep the capture intact as it may be encoded with a different quality
+            image = this->encodeCapture(capture, quality, this->_imageCache.isActive());
+
+            if (this->_imageCache.isActive()) {
+                this->_imageCache.putImage(x11Window, imageRectangle, quality, image, capture->getPixelChecksum());
+            }
+        }
     });
 
     return image;
 }
 
+std::shared_ptr<WebXWindowCapture> WebXDisplay::getCapture(Window x11Window, const WebXRectangle * imageRectangle) {
+    std::shared_ptr<WebXWindowCapture> capture = nullptr;
+    this->callIfWindowVisible(x11Window, [this, &capture, x11Window, imageRectangle](WebXWindow * window) {
+        if (!this->_imageCache.isActive() || !this->_imageCache.findCapture(x11Window, imageRectangle, capture)) {
+            capture = window->captureImage(imageRectangle, this->_shmImagePool, this->_settings.pixelChecksumEnabled);
+
+            if (this->_imageCache.isActive()) {
+                this->_imageCache.putCapture(x11Window, imageRectangle, capture);
+            }
+        }
+    });
+
+    return capture;
+}
+
+std::shared_future<std::shared_ptr<WebXImage>> WebXDisplay::encodeCapture(std::shared_ptr<WebXWindowCapture> capture, const WebXQuality & quality, bool preserveCapture) {
+    WebXImageConverter * imageConverter = this->_imageConverter;
+    auto encodeFunc = [capture, imageConverter, quality, preserveCapture]() {
+        return capture->encode(imageConverter, quality, preserveCapture);
+    };
+
+    if (this->_encoderPool) {
+        return this->_encoderPool->submit(encodeFunc);
+    }
+
+    std::promise<std::shared_ptr<WebXImage>> encodedImage;
+    encodedImage.set_value(encodeFunc());
+    return encodedImage.get_future().share();
+}
+
 std::shared_ptr<WebXImage> WebXDisplay::getWindowShapeMask(Window x11Window) {
     std::shared_ptr<WebXImage> image = nullptr;
     auto imageConverter = this->_imageConverter;
@@ -297,7 +586,7 @@ void WebXDisplay::updateMouseCursor() {
 void WebXDisplay::sendClientMouseInstruction(int x, int y, unsigned int buttonMask) {
     spdlog::trace("Sending mouse instruction x={}, y={}, buttonMask={}", x, y, buttonMask);
     this->_mouse->sendClientInstruction(x, y, buttonMask);
-    this->updateWindowCoverage();
+    this->updateMouseOver();
 }
 
 void WebXDisplay::sendKeyboard(int keysym, bool pressed) {
@@ -336,7 +625,9 @@ WebXWindow * WebXDisplay::createWindow(Window x11Window, bool isRoot) {
         XWindowAttributes attr;
         Status status = XGetWindowAttributes(this->_x11Display, x11Window, &attr);
         if (status != BadWindow && attr.map_state == IsViewable && attr.c_class == InputOutput) {
-            window = new WebXWindow(this->_x11Display, x11Window, isRoot, attr.x, attr.y, attr.width, attr.height, (attr.map_state == IsViewable));
+            int damageReportLevel = this->_settings.damageReportMode == WebXDisplaySettings::Region ? XDamageReportNonEmpty : XDamageReportRawRectangles;
+            window = new WebXWindow(this->_x11Display, x11Window, isRoot, attr.x, attr.y, attr.width, attr.height, (attr.map_state == IsViewable), damageReportLevel);
+            window->setAttributes(attr);
 
             this->_allWindows[x11Window] = window;
         }
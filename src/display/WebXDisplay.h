@@ -7,9 +7,16 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <future>
+#include <chrono>
 #include "WebXWindowProperties.h"
+#include "WebXWindowImageCache.h"
 #include <models/WebXQuality.h>
 #include <models/WebXSize.h>
+#include <models/WebXSettings.h>
+#include <models/WebXWindowDamage.h>
+#include <image/WebXImageEncoderPool.h>
+#include <utils/WebXOptional.h>
 
 class WebXWindow;
 class WebXImageConverter;
@@ -17,6 +24,7 @@ class WebXMouse;
 class WebXKeyboard;
 class WebXRandR;
 class WebXRandREvent;
+class WebXShmImagePool;
 
 /**
  * @class WebXDisplay
@@ -30,8 +38,9 @@ public:
     /**
      * @brief Constructs a WebXDisplay instance.
      * @param display Pointer to the X11 display.
+     * @param settings Reference to the display settings.
      */
-    WebXDisplay(Display * display);
+    WebXDisplay(Display * display, const WebXDisplaySettings & settings);
 
     /**
      * @brief Destructor.
@@ -56,6 +65,17 @@ public:
      */
     WebXWindow * getWindow(Window window) const;
 
+    /**
+     * @brief Gets (and clears) the damage of the window areas that have been exposed since the last call, ie the pixels
+     * that were hidden by other windows (and therefore not sent to the clients) and are now visible.
+     * @return The damage of each window with newly exposed areas.
+     */
+    std::vector<WebXWindowDamage> takeExposedWindowDamage() {
+        std::vector<WebXWindowDamage> exposedWindowDamage;
+        exposedWindowDamage.swap(this->_exposedWindowDamage);
+        return exposedWindowDamage;
+    }
+
     /**
      * @brief Creates a window in the window tree.
      * @param x11Window X11 window ID.
@@ -69,6 +89,31 @@ public:
      */
     void removeWindowFromTree(Window x11Window);
 
+    /**
+     * @brief Removes a destroyed window from the window tree and from the stacking order of the top-level windows
+     * (an unmapped window keeps its place in the stacking order).
+     * @param x11Window X11 window ID.
+     */
+    void destroyWindow(Window x11Window);
+
+    /**
+     * @brief Requests the stacking order of the top-level windows from the X server if the incremental one is invalid
+     * or if its periodic consistency check is due.
+     * @return True if the stacking order has been rebuilt or found inconsistent (the window layout has to be updated).
+     */
+    bool updateStackingOrder();
+
+    /**
+     * @brief Gets the time at which the stacking order maintained from the X11 events is next verified.
+     * @return The time of the next check (empty if the window tree is queried at every layout update).
+     */
+    WebXOptional<std::chrono::high_resolution_clock::time_point> getNextStackingOrderCheckTime() const {
+        if (this->_settings.stackingOrderCheckIntervalMs <= 0) {
+            return WebXOptional<std::chrono::high_resolution_clock::time_point>::Empty();
+        }
+        return WebXOptional<std::chrono::high_resolution_clock::time_point>::Value(this->_stackingOrderCheckTime + std::chrono::milliseconds(this->_settings.stackingOrderCheckIntervalMs));
+    }
+
     /**
      * @brief Reparents a window to a new parent in the window tree.
      * @param x11Window X11 window ID of the window to reparent.
@@ -76,6 +121,21 @@ public:
      */
     void reparentWindow(Window x11Window, Window parentX11Window);
 
+    /**
+     * @brief Updates the stacking order of the top-level windows after a window has been configured: the window is
+     * placed directly above its sibling. The stacking order is requested again from the X server if the sibling is unknown.
+     * @param x11Window X11 window ID of the configured window.
+     * @param aboveX11Window X11 window ID of the sibling below the window (None if the window is at the bottom).
+     */
+    void restackWindow(Window x11Window, Window aboveX11Window);
+
+    /**
+     * @brief Updates the stacking order of the top-level windows after a window has been circulated.
+     * @param x11Window X11 window ID of the circulated window.
+     * @param placeOnTop True if the window has been placed on top of its siblings, false if at the bottom.
+     */
+    void circulateWindow(Window x11Window, bool placeOnTop);
+
     /**
      * @brief Retrieves the visibility properties of all visible windows.
      * @return Vector of pointers to the visibility properties of visible windows.
@@ -131,9 +191,72 @@ public:
      * @param x11Window X11 window ID.
      * @param quality Requested quality of the image.
      * @param imageRectangle Optional rectangle representing the area to capture.
+     * @param previousPixelChecksum Optional pixel checksum of the previous image of the same area: nullptr is returned if the pixels are unchanged.
      * @return Shared pointer to the captured image.
      */
-    std::shared_ptr<WebXImage> getImage(Window x11Window, const WebXQuality & quality, const WebXRectangle * imageRectangle = nullptr);
+    std::shared_ptr<WebXImage> getImage(Window x11Window, const WebXQuality & quality, const WebXRectangle * imageRectangle = nullptr, uint64_t previousPixelChecksum = 0);
+
+    /**
+     * @brief Grabs an image of a window and queues its encoding: the encoding is performed by the encoder pool if enabled.
+     * The future must be resolved before the window tree is modified (ie before handling the next X11 events).
+     * @param x11Window X11 window ID.
+     * @param quality Requested quality of the image.
+     * @param imageRectangle Optional rectangle representing the area to capture.
+     * @param previousPixelChecksum Optional pixel checksum of the previous image of the same area: the future image is null if the pixels are unchanged.
+     * @return Shared future of the encoded image.
+     */
+    std::shared_future<std::shared_ptr<WebXImage>> getImageAsync(Window x11Window, const WebXQuality & quality, const WebXRectangle * imageRectangle = nullptr, uint64_t previousPixelChecksum = 0);
+
+    /**
+     * @brief Grabs the raw pixels of a window (or an area of a window) without encoding them. The capture is shared
+     * between client groups when the image cache is active.
+     * @param x11Window X11 window ID.
+     * @param imageRectangle Optional rectangle representing the area to capture.
+     * @return Shared pointer to the capture or nullptr if the window is not visible or the grab failed.
+     */
+    std::shared_ptr<WebXWindowCapture> getCapture(Window x11Window, const WebXRectangle * imageRectangle = nullptr);
+
+    /**
+     * @brief Queues the encoding of a capture obtained with getCapture (or cropped from one).
+     * @param capture The capture to encode.
+     * @param quality Requested quality of the image.
+     * @return Shared future of the encoded image.
+     */
+    std::shared_future<std::shared_ptr<WebXImage>> encodeCaptureAsync(std::shared_ptr<WebXWindowCapture> capture, const WebXQuality & quality) {
+        // Cached captures may be encoded again by another client group: keep their pixels intact
+        return this->encodeCapture(capture, quality, this->_imageCache.isActive());
+    }
+
+    /**
+     * @brief Retrieves the cumulative metrics of the image encoder workers.
+     * @return The metrics of each worker (empty if images are encoded on the calling thread).
+     */
+    std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> getEncoderWorkerMetrics() const {
+        return this->_encoderPool ? this->_encoderPool->getWorkerMetrics() : std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics>();
+    }
+
+    /**
+     * @brief Activates the image cache: until it is deactivated, identical image requests share the same
+     * capture and encoded image.
+     */
+    void activateImageCache() {
+        this->_imageCache.activate();
+    }
+
+    /**
+     * @brief Deactivates the image cache and releases all cached captures and images.
+     */
+    void deactivateImageCache() {
+        this->_imageCache.deactivate();
+    }
+
+    /**
+     * @brief Retrieves the image cache (to obtain the hit and miss counters).
+     * @return Reference to the image cache.
+     */
+    const WebXWindowImageCache & getImageCache() const {
+        return this->_imageCache;
+    }
 
     /**
      * @brief Retrieves the shape mask image of a window.
@@ -301,16 +424,48 @@ private:
      */
     void updateWindowCoverage();
 
+    /**
+     * @brief Updates the mouse-over flag of the visible windows from the mouse position, keeping the coverage
+     * calculated by the last layout update.
+     */
+    void updateMouseOver();
+
+    /**
+     * @brief Enables damage tracking for a batch of windows with two sync points for the whole batch (rather than two
+     * per window). Errors received at the second sync point are attributed to the windows: those that have been destroyed
+     * in the meantime have their damage reset and are removed from the visible windows.
+     * @param windows The windows for which damage tracking needs to be enabled.
+     */
+    void enableDamage(const std::vector<WebXWindow *> & windows);
+
+    /**
+     * @brief Encodes a capture using the encoder pool if enabled, otherwise on the calling thread.
+     * @param capture The capture to encode.
+     * @param quality Requested quality of the image.
+     * @param preserveCapture If true the capture pixels are left unmodified so that the capture can be encoded again.
+     * @return Shared future of the encoded image.
+     */
+    std::shared_future<std::shared_ptr<WebXImage>> encodeCapture(std::shared_ptr<WebXWindowCapture> capture, const WebXQuality & quality, bool preserveCapture);
+
 private:
     Display * _x11Display;
+    const WebXDisplaySettings & _settings;
 
     WebXWindow * _rootWindow;
     std::map<Window, WebXWindow *> _allWindows;
 
+    std::vector<Window> _stackingOrder;
+    bool _stackingOrderValid;
+    std::chrono::high_resolution_clock::time_point _stackingOrderCheckTime;
+
     std::vector<WebXWindow *> _visibleWindows;
     std::mutex _visibleWindowsMutex;
+    std::vector<WebXWindowDamage> _exposedWindowDamage;
 
     WebXImageConverter * _imageConverter;
+    WebXShmImagePool * _shmImagePool;
+    WebXWindowImageCache _imageCache;
+    WebXImageEncoderPool * _encoderPool;
 
     WebXMouse * _mouse;
     WebXKeyboard * _keyboard;
@@ -1,3 +1,4 @@
 #include "WebXErrorHandler.h"
 
-XErrorEvent WebXErrorHandler::LAST_ERROR = {};
+std::mutex WebXErrorHandler::ERRORS_MUTEX;
+std::deque<XErrorEvent> WebXErrorHandler::ERRORS;
@@ -2,15 +2,18 @@
 #define WEBX_ERROR_HANDLER_H
 
 #include <X11/Xlib.h>
+#include <deque>
+#include <mutex>
 #include <spdlog/spdlog.h>
 
 /**
  * @class WebXErrorHandler
- * @brief Handles X11 errors and provides access to the last error details.
+ * @brief Handles X11 errors and attributes them to the requests (and resources) that caused them.
  * 
- * This class captures and logs X11 errors, storing the details of the last error
- * encountered. It provides methods to retrieve the last error's details, such as
- * the error code and the associated window.
+ * This class captures and logs X11 errors, keeping the most recent ones. Each error holds the serial number of the
+ * failed request: by recording the serial of the next request before a sequence of requests, the errors caused by
+ * that sequence (for a given window) can be retrieved once they have been received. When requests are not synchronous,
+ * errors are only received when the X server replies to a later request (or at an explicit sync point).
  */
 class WebXErrorHandler {
 public:
@@ -25,43 +28,58 @@ public:
     virtual ~WebXErrorHandler() {}
 
     /**
-     * @brief Retrieves the last X11 error event.
-     * @return Reference to the last XErrorEvent.
+     * @brief Gets the serial number that will be used by the next request on the X11 connection.
+     * @param display Pointer to the X11 display.
+     * @return The serial of the next request.
      */
-    static const XErrorEvent & getLastError() {
-        return LAST_ERROR;
+    static unsigned long getNextRequestSerial(Display * display) {
+        return NextRequest(display);
     }
 
     /**
-     * @brief Retrieves the window associated with the last X11 error.
-     * @return X11 window ID of the last error.
+     * @brief Searches for the most recent error caused by the requests made since a given serial.
+     * @param fromSerial The serial of the first request of the sequence (from getNextRequestSerial).
+     * @param resource The resource (window, drawable) of the failed request (0 for any resource).
+     * @param error Set to the error if found.
+     * @return True if an error has been found.
      */
-    static Window getLastErrorWindow() {
-        return LAST_ERROR.resourceid;
-    }
+    static bool getError(unsigned long fromSerial, XID resource, XErrorEvent & error) {
+        std::lock_guard<std::mutex> lock(ERRORS_MUTEX);
+        for (auto it = ERRORS.rbegin(); it != ERRORS.rend(); it++) {
+            if (it->serial < fromSerial) {
+                break;
+            }
 
-    /**
-     * @brief Retrieves the error code of the last X11 error.
-     * @return Error code of the last error.
-     */
-    static unsigned char getLastErrorCode() {
-        return LAST_ERROR.error_code;
+            if (resource == 0 || it->resourceid == resource) {
+                error = *it;
+                return true;
+            }
+        }
+        return false;
     }
 
     /**
-     * @brief Sets the details of the last X11 error and logs it.
+     * @brief Stores the details of an X11 error and logs it.
      * @param display Pointer to the X11 display.
      * @param error Pointer to the XErrorEvent.
      * @return Always returns 0.
      */
-    static int setLastError(Display * display, XErrorEvent * error) {
-        spdlog::error("X11 error for window with id 0x{:x}, error 0x{:02x}", error->resourceid, error->error_code);
-        LAST_ERROR = *error;
+    static int handleError(Display * display, XErrorEvent * error) {
+        spdlog::error("X11 error for window with id 0x{:x}, error 0x{:02x} (request {:d}.{:d}, serial {:d})", error->resourceid, error->error_code, error->request_code, error->minor_code, error->serial);
+
+        std::lock_guard<std::mutex> lock(ERRORS_MUTEX);
+        ERRORS.push_back(*error);
+        if (ERRORS.size() > MAX_ERRORS) {
+            ERRORS.pop_front();
+        }
         return 0;
     }
 
 private:
-    static XErrorEvent LAST_ERROR;
+    const static size_t MAX_ERRORS = 256;
+
+    static std::mutex ERRORS_MUTEX;
+    static std::deque<XErrorEvent> ERRORS;
 };
 
-#endif /* WEBX_ERROR_HANDLER_H */
\ No newline at end of file
+#endif /* WEBX_ERROR_HANDLER_H */
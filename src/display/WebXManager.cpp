@@ -60,11 +60,18 @@ void WebXManager::init(const std::string & keyboardLayout) {
         exit(EXIT_FAILURE);
     }
 
-    XSetErrorHandler(WebXErrorHandler::setLastError);
+    XSetErrorHandler(WebXErrorHandler::handleError);
     XSetIOErrorHandler(WebXManager::IO_ERROR_HANDLER);
-    XSynchronize(this->_x11Display, True);
 
-    this->_display = new WebXDisplay(this->_x11Display);
+    // In asynchronous mode requests are buffered until a reply is needed or the output is flushed (in the controller loop)
+    if (this->_settings.display.asyncRequestsEnabled) {
+        spdlog::info("Using asynchronous X11 requests");
+
+    } else {
+        XSynchronize(this->_x11Display, True);
+    }
+
+    this->_display = new WebXDisplay(this->_x11Display, this->_settings.display);
     this->_display->init();
 
     this->_clipboard = new WebXClipboard(this->_x11Display, this->_display->getRootWindow()->getX11Window(), [this](const std::string & content) {
@@ -85,6 +92,12 @@ void WebXManager::init(const std::string & keyboardLayout) {
         this->_displayRequiresUpdate = true;
     });
     
+    this->_eventListener->setDestroyEventHandler([this](const WebXDestroyEvent & event) {
+        spdlog::trace("Got Destroy Event for window 0x{:x}", event.getWindow());
+        this->_display->destroyWindow(event.getWindow());
+        this->_displayRequiresUpdate = true;
+    });
+    
     this->_eventListener->setReparentEventHandler([this](const WebXReparentEvent & event) {
         spdlog::trace("Got Reparent Event for window 0x{:x}", event.getWindow());
         this->_display->reparentWindow(event.getWindow(), event.getParentWindow());
@@ -96,9 +109,14 @@ void WebXManager::init(const std::string & keyboardLayout) {
         this->handleWindowConfigureEvent(event);
     });
     
-    this->_eventListener->setDamageEventHandler([this](const WebXDamageEvent & event) {
-        spdlog::trace("Got damage Event for window 0x{:x} {:d}", event.getWindow(), event.getSerial());
-        this->sendDamageEvent(WebXWindowDamage(event.getWindow(), event.getRectangle()));
+    this->_eventListener->setCirculateEventHandler([this](const WebXCirculateEvent & event) {
+        spdlog::trace("Got Circulate Event for window 0x{:x}", event.getWindow());
+        this->_display->circulateWindow(event.getWindow(), event.isPlacedOnTop());
+        this->_displayRequiresUpdate = true;
+    });
+
+    this->_eventListener->setDamageEventHandler([this](const std::vector<WebXWindowDamage> & damages) {
+        this->sendDamageEvent(damages);
     });
 
     this->_eventListener->setCursorEventHandler([this](const WebXCursorEvent & event) {
@@ -123,6 +141,8 @@ void WebXManager::init(const std::string & keyboardLayout) {
     this->_eventListener->setRandREventHandler([this](const WebXRandREvent & event) {
         if (this->_display->isValidRandREvent(event)) {
             spdlog::trace("Got screen resize event of {}x{}", event.getWidth(), event.getHeight());
+            this->_display->getRootWindow()->invalidateAttributes();
+            this->_displayRequiresUpdate = true;
             this->sendScreenResizeEvent(event.getWidth(), event.getHeight());
         }
     });
@@ -130,36 +150,72 @@ void WebXManager::init(const std::string & keyboardLayout) {
     this->_display->loadKeyboardLayout(keyboardLayout);
 }
 
-void WebXManager::handlePendingEvents() {
+void WebXManager::handlePendingEvents(bool verifyStackingOrder) {
     this->_clipboard->updateClipboard();
     this->_eventListener->flushQueuedEvents();
+
+    // Verify periodically the stacking order maintained from the events, whether or not windows have changed
+    if (verifyStackingOrder && !this->_displayRequiresUpdate && this->_display->updateStackingOrder()) {
+        this->_displayRequiresUpdate = true;
+    }
+
     this->updateDisplay();
 }
 
+WebXOptional<std::chrono::high_resolution_clock::time_point> WebXManager::getNextStackingOrderCheckTime() const {
+    // A pending layout update verifies the stacking order if the check is due
+    if (this->_displayRequiresUpdate) {
+        return WebXOptional<std::chrono::high_resolution_clock::time_point>::Empty();
+    }
+    return this->_display->getNextStackingOrderCheckTime();
+}
+
 void WebXManager::setClipboardContent(const std::string & clipboardContent) {
     this->_clipboard->setClipboardContent(clipboardContent);
 }
 
 void WebXManager::handleWindowConfigureEvent(const WebXConfigureEvent & event) {
-    this->_display->callIfWindowVisible(event.getWindow(), [event, this](WebXWindow * window) {
-        window->setRectangle(WebXRectangle(event.getX(), event.getY(), event.getWidth(), event.getHeight()));
+    // The stacking order of the top-level windows (mapped or not) is maintained from the configure events
+    this->_display->restackWindow(event.getWindow(), event.getAboveWindow());
+    this->_displayRequiresUpdate = true;
+
+    // The geometry of all windows (visible or not) is maintained from the configure events
+    WebXWindow * configuredWindow = this->_display->getWindow(event.getWindow());
+    if (configuredWindow == NULL) {
+        return;
+    }
 
-        const WebXSize & windowSize = window->getRectangle().size();
-        bool sizeHasChanged = windowSize.width() != event.getWidth() || windowSize.height() != event.getHeight();
+    const WebXSize & windowSize = configuredWindow->getRectangle().size();
+    bool sizeHasChanged = windowSize.width() != event.getWidth() || windowSize.height() != event.getHeight();
 
-        if (sizeHasChanged) {
-            // Send this as an event to indicate that the full window is damaged
-            this->sendDamageEvent(WebXWindowDamage(event.getWindow(), window->getRectangle(), true));
-        }
-        this->_displayRequiresUpdate = true;
-    });
+    configuredWindow->setRectangle(WebXRectangle(event.getX(), event.getY(), event.getWidth(), event.getHeight()));
+
+    if (sizeHasChanged) {
+        this->_display->callIfWindowVisible(event.getWindow(), [event, this](WebXWindow * window) {
+            // Add this to the damage batch to indicate that the full window is damaged
+            this->_eventListener->addWindowDamage(WebXWindowDamage(event.getWindow(), window->getRectangle(), true));
+        });
+    }
 }
 
 void WebXManager::updateDisplay() {
     if (this->_displayRequiresUpdate) {
+        // Coalesce the window events received during the layout update interval into a single update
+        std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+        if (now < this->_lastDisplayUpdateTime + std::chrono::milliseconds(this->_settings.display.layoutUpdateIntervalMs)) {
+            return;
+        }
+
         this->_display->updateVisibleWindows();
         this->sendDisplayEvent(WindowLayoutEvent);
+
+        // Areas that were hidden by other windows (and not sent) have to be refreshed
+        std::vector<WebXWindowDamage> exposedWindowDamage = this->_display->takeExposedWindowDamage();
+        if (!exposedWindowDamage.empty()) {
+            this->sendDamageEvent(exposedWindowDamage);
+        }
         this->_displayRequiresUpdate = false;
+        this->_lastDisplayUpdateTime = now;
     }
 }
 
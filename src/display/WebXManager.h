@@ -5,10 +5,12 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <chrono>
 #include "WebXDisplayEventType.h"
 #include "events/WebXConfigureEvent.h"
 #include <models/WebXSettings.h>
 #include <models/WebXWindowDamage.h>
+#include <utils/WebXOptional.h>
 
 class WebXWindow;
 class WebXDisplay;
@@ -55,8 +57,47 @@ public:
 
     /**
      * @brief Processes all pending X11 events.
+     * @param verifyStackingOrder Whether the periodic check of the stacking order is done (when clients are connected).
+     * Otherwise the stacking order is verified at the next layout update.
      */
-    void handlePendingEvents();
+    void handlePendingEvents(bool verifyStackingOrder);
+
+    /**
+     * @brief Gets the file descriptor of the X11 connection: it becomes readable when the X server sends events.
+     * @return The X11 connection file descriptor.
+     */
+    int getConnectionFd() const {
+        return ConnectionNumber(this->_x11Display);
+    }
+
+    /**
+     * @brief Flushes the X11 output buffer and checks if events have already been read from the connection
+     * (eg while waiting for a reply) and are waiting in the Xlib queue: these will not make the connection readable.
+     * @return True if events are waiting in the Xlib queue.
+     */
+    bool hasQueuedEvents() const {
+        XFlush(this->_x11Display);
+        return XEventsQueued(this->_x11Display, QueuedAlready) > 0;
+    }
+
+    /**
+     * @brief Gets the time at which a deferred window layout update is due: window events are coalesced so that the
+     * layout is recomputed at most once per layout update interval.
+     * @return The time of the next layout update (empty if no update is pending).
+     */
+    WebXOptional<std::chrono::high_resolution_clock::time_point> getNextDisplayUpdateTime() const {
+        if (!this->_displayRequiresUpdate) {
+            return WebXOptional<std::chrono::high_resolution_clock::time_point>::Empty();
+        }
+        return WebXOptional<std::chrono::high_resolution_clock::time_point>::Value(this->_lastDisplayUpdateTime + std::chrono::milliseconds(this->_settings.display.layoutUpdateIntervalMs));
+    }
+
+    /**
+     * @brief Gets the time at which the stacking order of the windows maintained from the X11 events is next verified
+     * against the window tree of the X server.
+     * @return The time of the next check (empty if the window tree is queried at every layout update).
+     */
+    WebXOptional<std::chrono::high_resolution_clock::time_point> getNextStackingOrderCheckTime() const;
 
     /**
      * @brief Sets the handler for display-related events.
@@ -67,10 +108,10 @@ public:
     }
 
     /**
-     * @brief Sets the handler for damage-related events.
+     * @brief Sets the handler for damage-related events: called once per event flush with the merged damage of each damaged window.
      * @param handler Function to handle damage events.
      */
-    void setDamageEventHandler(std::function<void(const WebXWindowDamage & damage)> handler) {
+    void setDamageEventHandler(std::function<void(const std::vector<WebXWindowDamage> & damages)> handler) {
         this->_onDamageEvent = handler;
     }
 
@@ -125,12 +166,12 @@ private:
     }
 
     /**
-     * @brief Sends a damage-related event to the registered handler.
-     * @param damage The damage event data.
+     * @brief Sends a batch of damage to the registered handler.
+     * @param damages The damage of each damaged window.
      */
-    void sendDamageEvent(const WebXWindowDamage & damage) {
+    void sendDamageEvent(const std::vector<WebXWindowDamage> & damages) {
         if (this->_onDamageEvent) {
-            this->_onDamageEvent(damage);
+            this->_onDamageEvent(damages);
         }
     }
 
@@ -163,9 +204,10 @@ private:
     WebXEventListener * _eventListener;
     WebXClipboard * _clipboard;
     bool _displayRequiresUpdate;
+    std::chrono::high_resolution_clock::time_point _lastDisplayUpdateTime;
 
     std::function<void(WebXDisplayEventType eventType)> _onDisplayEvent;
-    std::function<void(const WebXWindowDamage & damage)> _onDamageEvent;
+    std::function<void(const std::vector<WebXWindowDamage> & damages)> _onDamageEvent;
     std::function<void(const std::string & clipboardContent)> _onClipboardEvent;
     std::function<void(int width, int height)> _onScreenResizeEvent;
 };
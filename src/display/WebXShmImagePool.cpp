@@ -0,0 +1,211 @@
+#include "WebXShmImagePool.h"
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+bool WebXShmImagePool::PROBE_ERROR = false;
+
+WebXShmImagePool::WebXShmImagePool(Display * display) :
+    _display(display),
+    _available(false),
+    _allocationFailures(0),
+    _maxSegmentSize(0) {
+}
+
+WebXShmImagePool::~WebXShmImagePool() {
+    std::lock_guard<std::mutex> lock(this->_segmentsMutex);
+    for (WebXShmSegment * segment : this->_segments) {
+        this->destroySegment(segment);
+    }
+    this->_segments.clear();
+}
+
+bool WebXShmImagePool::init() {
+    if (!XShmQueryExtension(this->_display)) {
+        spdlog::info("MIT-SHM extension is not available: using XGetImage for window capture");
+        return false;
+    }
+
+    // Probe the attachment of a segment: the X server cannot attach it if it is remote
+    XSync(this->_display, False);
+    PROBE_ERROR = false;
+    XErrorHandler previousErrorHandler = XSetErrorHandler(WebXShmImagePool::ProbeErrorHandler);
+
+    WebXShmSegment * segment = this->createSegment(MIN_SEGMENT_SIZE);
+    XSync(this->_display, False);
+
+    if (segment != NULL && PROBE_ERROR) {
+        this->destroySegment(segment);
+        XSync(this->_display, False);
+        segment = NULL;
+    }
+
+    XSetErrorHandler(previousErrorHandler);
+
+    if (segment == NULL) {
+        spdlog::info("Failed to attach MIT-SHM segment: using XGetImage for window capture");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(this->_segmentsMutex);
+    this->_segments.push_back(segment);
+    this->_available = true;
+
+    spdlog::info("Using MIT-SHM for window capture");
+    return true;
+}
+
+XImage * WebXShmImagePool::getImage(Drawable drawable, Visual * visual, int depth, int x, int y, unsigned int width, unsigned int height) {
+    if (!this->_available) {
+        return NULL;
+    }
+
+    // Image structure only: the data and segment info are set from the pooled segment
+    XImage * image = XShmCreateImage(this->_display, visual, depth, ZPixmap, NULL, NULL, width, height);
+    if (image == NULL) {
+        this->onAllocationFailure(0);
+        return NULL;
+    }
+
+    // Segments of this size class are known to fail
+    size_t imageSize = (size_t)image->bytes_per_line * image->height;
+    if (this->_maxSegmentSize > 0 && SizeClass(imageSize) > this->_maxSegmentSize) {
+        XDestroyImage(image);
+        return NULL;
+    }
+
+    WebXShmSegment * segment = this->acquireSegment(imageSize);
+    if (segment == NULL) {
+        XDestroyImage(image);
+        this->onAllocationFailure(imageSize);
+        return NULL;
+    }
+    this->_allocationFailures = 0;
+
+    image->data = segment->shmInfo.shmaddr;
+    image->obdata = (char *)&segment->shmInfo;
+
+    if (!XShmGetImage(this->_display, drawable, image, x, y, AllPlanes)) {
+        this->releaseImage(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+void WebXShmImagePool::releaseImage(XImage * image) {
+    if (image == NULL) {
+        return;
+    }
+
+    XShmSegmentInfo * shmInfo = (XShmSegmentInfo *)image->obdata;
+
+    // Only frees the image structure (data is owned by the segment)
+    XDestroyImage(image);
+
+    std::lock_guard<std::mutex> lock(this->_segmentsMutex);
+    auto it = std::find_if(this->_segments.begin(), this->_segments.end(), [shmInfo](const WebXShmSegment * segment) {
+        return &segment->shmInfo == shmInfo;
+    });
+
+    if (it != this->_segments.end()) {
+        WebXShmSegment * segment = *it;
+        segment->inUse = false;
+
+        // Limit the number of idle segments of the same size
+        size_t segmentSize = segment->size;
+        int numberIdle = std::count_if(this->_segments.begin(), this->_segments.end(), [segmentSize](const WebXShmSegment * aSegment) {
+            return !aSegment->inUse && aSegment->size == segmentSize;
+        });
+
+        if (numberIdle > MAX_IDLE_SEGMENTS_PER_SIZE_CLASS) {
+            this->_segments.erase(it);
+            this->destroySegment(segment);
+        }
+    }
+}
+
+WebXShmImagePool::WebXShmSegment * WebXShmImagePool::acquireSegment(size_t size) {
+    size_t sizeClass = SizeClass(size);
+
+    std::lock_guard<std::mutex> lock(this->_segmentsMutex);
+    auto it = std::find_if(this->_segments.begin(), this->_segments.end(), [sizeClass](const WebXShmSegment * segment) {
+        return !segment->inUse && segment->size == sizeClass;
+    });
+
+    WebXShmSegment * segment = NULL;
+    if (it != this->_segments.end()) {
+        segment = *it;
+
+    } else {
+        segment = this->createSegment(sizeClass);
+        if (segment == NULL) {
+            return NULL;
+        }
+        this->_segments.push_back(segment);
+    }
+
+    segment->inUse = true;
+    return segment;
+}
+
+WebXShmImagePool::WebXShmSegment * WebXShmImagePool::createSegment(size_t size) {
+    WebXShmSegment * segment = new WebXShmSegment();
+    segment->size = size;
+
+    segment->shmInfo.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (segment->shmInfo.shmid < 0) {
+        spdlog::error("Failed to create shared memory segment of {:d} bytes", size);
+        delete segment;
+        return NULL;
+    }
+
+    segment->shmInfo.shmaddr = (char *)shmat(segment->shmInfo.shmid, NULL, 0);
+    if (segment->shmInfo.shmaddr == (char *)-1) {
+        spdlog::error("Failed to attach shared memory segment of {:d} bytes", size);
+        shmctl(segment->shmInfo.shmid, IPC_RMID, NULL);
+        delete segment;
+        return NULL;
+    }
+
+    segment->shmInfo.readOnly = False;
+    if (!XShmAttach(this->_display, &segment->shmInfo)) {
+        spdlog::error("Failed to attach shared memory segment to the X server");
+        shmdt(segment->shmInfo.shmaddr);
+        shmctl(segment->shmInfo.shmid, IPC_RMID, NULL);
+        delete segment;
+        return NULL;
+    }
+
+    // Ensure the server has attached the segment before marking it for removal (freed when both sides have detached)
+    XSync(this->_display, False);
+    shmctl(segment->shmInfo.shmid, IPC_RMID, NULL);
+
+    spdlog::debug("Created shared memory segment of {:d} bytes", size);
+
+    return segment;
+}
+
+void WebXShmImagePool::onAllocationFailure(size_t size) {
+    this->_allocationFailures++;
+    if (this->_allocationFailures >= MAX_ALLOCATION_FAILURES) {
+        spdlog::warn("Failed to allocate {:d} consecutive MIT-SHM images: using XGetImage for window capture", this->_allocationFailures);
+        this->_available = false;
+        return;
+    }
+
+    size_t sizeClass = SizeClass(size);
+    if (size > 0 && sizeClass > MIN_SEGMENT_SIZE && (this->_maxSegmentSize == 0 || sizeClass <= this->_maxSegmentSize)) {
+        this->_maxSegmentSize = sizeClass / 2;
+        spdlog::warn("Failed to allocate a MIT-SHM segment of {:d} bytes: using XGetImage for larger window captures", sizeClass);
+    }
+}
+
+void WebXShmImagePool::destroySegment(WebXShmSegment * segment) {
+    XShmDetach(this->_display, &segment->shmInfo);
+    XSync(this->_display, False);
+    shmdt(segment->shmInfo.shmaddr);
+
+    delete segment;
+}
@@ -0,0 +1,151 @@
+#ifndef WEBX_SHM_IMAGE_POOL_H
+#define WEBX_SHM_IMAGE_POOL_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <vector>
+#include <mutex>
+
+/**
+ * @class WebXShmImagePool
+ * @brief Provides XImages backed by reusable MIT-SHM shared memory segments.
+ *
+ * Grabbing window pixels with XShmGetImage avoids the copy of the image data through the X11
+ * socket and the allocation of a new buffer for every grab. Segments are grouped into power-of-two
+ * size classes so that a segment can be reused by any window whose image fits in it. A segment is
+ * leased for the lifetime of an XImage and returned to the pool when the image is released.
+ *
+ * Segments may fail to be allocated (system shared memory limits): the size classes from the first one that failed are
+ * no longer requested and the pool is disabled after repeated failures. The caller then grabs the images with XGetImage.
+ */
+class WebXShmImagePool {
+private:
+    const static size_t MIN_SEGMENT_SIZE = 256 * 1024;
+    const static int MAX_IDLE_SEGMENTS_PER_SIZE_CLASS = 2;
+    const static int MAX_ALLOCATION_FAILURES = 8;
+
+    struct WebXShmSegment {
+        WebXShmSegment() :
+            size(0),
+            inUse(false) {
+            shmInfo.shmid = -1;
+            shmInfo.shmaddr = (char *)-1;
+            shmInfo.readOnly = False;
+            shmInfo.shmseg = 0;
+        }
+
+        XShmSegmentInfo shmInfo;
+        size_t size;
+        bool inUse;
+    };
+
+public:
+    /**
+     * @brief Constructs a WebXShmImagePool instance.
+     * @param display Pointer to the X11 display.
+     */
+    WebXShmImagePool(Display * display);
+
+    /**
+     * @brief Destructor. Detaches and removes all shared memory segments.
+     */
+    virtual ~WebXShmImagePool();
+
+    /**
+     * @brief Verifies that the MIT-SHM extension is available and that segments can be attached by the X server
+     * (eg fails when the X server is remote).
+     * @return True if the pool can be used, false otherwise.
+     */
+    bool init();
+
+    /**
+     * @brief Checks if the pool is usable.
+     * @return True if MIT-SHM is available.
+     */
+    bool isAvailable() const {
+        return this->_available;
+    }
+
+    /**
+     * @brief Grabs the pixels of a drawable into an XImage backed by a pooled shared memory segment.
+     * @param drawable The X11 drawable (window) to grab.
+     * @param visual The visual of the drawable.
+     * @param depth The depth of the drawable.
+     * @param x X-coordinate of the area to grab.
+     * @param y Y-coordinate of the area to grab.
+     * @param width Width of the area to grab.
+     * @param height Height of the area to grab.
+     * @return The XImage or NULL if the image could not be allocated or the grab failed (an X11 error is only recorded
+     * for a failed grab). The image must be released with releaseImage.
+     */
+    XImage * getImage(Drawable drawable, Visual * visual, int depth, int x, int y, unsigned int width, unsigned int height);
+
+    /**
+     * @brief Destroys an XImage obtained from getImage and returns its segment to the pool.
+     * @param image The XImage to release.
+     */
+    void releaseImage(XImage * image);
+
+private:
+    /**
+     * @brief Obtains an unused segment able to hold the given number of bytes, creating one if necessary.
+     * @param size The required size in bytes.
+     * @return Pointer to the segment or NULL if it could not be created.
+     */
+    WebXShmSegment * acquireSegment(size_t size);
+
+    /**
+     * @brief Creates and attaches a new shared memory segment.
+     * @param size The size of the segment in bytes.
+     * @return Pointer to the segment or NULL if it could not be created.
+     */
+    WebXShmSegment * createSegment(size_t size);
+
+    /**
+     * @brief Records the failure to allocate a shared memory image: the size classes from the one that failed are no
+     * longer requested and the pool is disabled after repeated failures.
+     * @param size The size in bytes of the image that could not be allocated.
+     */
+    void onAllocationFailure(size_t size);
+
+    /**
+     * @brief Detaches and removes a shared memory segment.
+     * @param segment The segment to destroy.
+     */
+    void destroySegment(WebXShmSegment * segment);
+
+    /**
+     * @brief Calculates the size class (a power of two) of a number of bytes.
+     * @param size The size in bytes.
+     * @return The size of the smallest class able to hold the bytes.
+     */
+    static size_t SizeClass(size_t size) {
+        size_t sizeClass = MIN_SEGMENT_SIZE;
+        while (sizeClass < size) {
+            sizeClass <<= 1;
+        }
+        return sizeClass;
+    }
+
+    /**
+     * @brief Temporary X11 error handler used when probing the MIT-SHM attachment.
+     */
+    static int ProbeErrorHandler(Display * display, XErrorEvent * error) {
+        PROBE_ERROR = true;
+        return 0;
+    }
+
+private:
+    static bool PROBE_ERROR;
+
+    Display * _display;
+    bool _available;
+    int _allocationFailures;
+    size_t _maxSegmentSize;
+
+    std::vector<WebXShmSegment *> _segments;
+    std::mutex _segmentsMutex;
+};
+
+#endif /* WEBX_SHM_IMAGE_POOL_H */
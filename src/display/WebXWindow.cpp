@@ -1,5 +1,7 @@
 #include "WebXWindow.h"
 #include "WebXErrorHandler.h"
+#include "WebXShmImagePool.h"
+#include "WebXWindowCapture.h"
 #include <image/WebXImage.h>
 #include "events/WebXDamageOverride.h"
 #include <models/WebXQuality.h>
@@ -8,11 +10,16 @@
 #include <X11/Xutil.h>
 #include <spdlog/spdlog.h>
 
-WebXWindow::WebXWindow(Display * display, Window x11Window, bool isRoot, int x, int y, int width, int height, bool isViewable) :
+WebXWindow::WebXWindow(Display * display, Window x11Window, bool isRoot, int x, int y, int width, int height, bool isViewable, int damageReportLevel) :
     _display(display),
     _x11Window(x11Window),
     _damage(0),
+    _damageReportLevel(damageReportLevel),
     _isRoot(isRoot),
+    _visual(NULL),
+    _depth(0),
+    _attributesValid(false),
+    _encodeSkipCount(0),
     _parent(NULL),
     _visibility(x11Window, WebXRectangle(x, y, width, height), isViewable),
     _shape(display, x11Window, width, height) {
@@ -30,7 +37,12 @@ WebXWindow::~WebXWindow() {
 
 void WebXWindow::enableDamage() {
     std::lock_guard<std::mutex> lock(this->_damageMutex);
-    if (this->_damage == 0) {
+    if (this->_damage == 0 && this->_damageReportLevel == XDamageReportNonEmpty) {
+        // A single event is sent when the damage becomes non-empty (it must not be ignored: no other event is sent until
+        // the damage is subtracted)
+        this->_damage = XDamageCreate(this->_display, this->_x11Window, XDamageReportNonEmpty);
+
+    } else if (this->_damage == 0) {
         // Flush all pending events
         XSync(this->_display, false);
 
@@ -48,6 +60,15 @@ void WebXWindow::enableDamage() {
     }
 }
 
+bool WebXWindow::createDamage() {
+    std::lock_guard<std::mutex> lock(this->_damageMutex);
+    if (this->_damage == 0) {
+        this->_damage = XDamageCreate(this->_display, this->_x11Window, this->_damageReportLevel);
+        return true;
+    }
+    return false;
+}
+
 void WebXWindow::disableDamage() {
     std::lock_guard<std::mutex> lock(this->_damageMutex);
     if (this->_damage != 0 && this->isViewable()) {
@@ -59,20 +80,46 @@ void WebXWindow::disableDamage() {
 Status WebXWindow::updateAttributes() {
     XWindowAttributes attr;
     Status status = XGetWindowAttributes(this->_display, this->_x11Window, &attr);
-    this->_visibility.setRectangle(WebXRectangle(attr.x, attr.y, attr.width, attr.height));
-    this->_visibility.setViewable(attr.map_state == IsViewable && attr.c_class == InputOutput);
+    if (status) {
+        this->setAttributes(attr);
+
+    } else {
+        this->_attributesValid = false;
+    }
 
     return status;
 }
 
+void WebXWindow::setAttributes(const XWindowAttributes & attributes) {
+    this->_visibility.setRectangle(WebXRectangle(attributes.x, attributes.y, attributes.width, attributes.height));
+    this->_visibility.setViewable(attributes.map_state == IsViewable && attributes.c_class == InputOutput);
+    this->_visual = attributes.visual;
+    this->_depth = attributes.depth;
+    this->_attributesValid = true;
+}
+
 void WebXWindow::printInfo() const {
     printf("WebXWindow = 0x%08lx [(%d, %d), %dx%d]\n", this->_x11Window, this->getRectangle().x(), this->getRectangle().y(), this->getRectangle().size().width(), this->getRectangle().size().height());
 }
 
-std::shared_ptr<WebXImage> WebXWindow::getImage(const WebXRectangle * imageRectangle, WebXImageConverter * imageConverter, const WebXQuality & quality) {
+std::shared_ptr<WebXImage> WebXWindow::getImage(const WebXRectangle * imageRectangle, WebXImageConverter * imageConverter, const WebXQuality & quality, WebXShmImagePool * shmImagePool, bool calculatePixelChecksum, uint64_t previousPixelChecksum) {
+    std::shared_ptr<WebXWindowCapture> capture = this->captureImage(imageRectangle, shmImagePool, calculatePixelChecksum);
+    if (capture == nullptr) {
+        return nullptr;
+    }
 
-    // Update window attributes to ensure we can grab the pixels and the size is coherent
-    Status status = this->updateAttributes();
+    // Avoid encoding pixels that haven't changed
+    if (this->isPixelChecksumUnchanged(capture->getPixelChecksum(), previousPixelChecksum)) {
+        return nullptr;
+    }
+
+    return capture->encode(imageConverter, quality, false);
+}
+
+std::shared_ptr<WebXWindowCapture> WebXWindow::captureImage(const WebXRectangle * imageRectangle, WebXShmImagePool * shmImagePool, bool calculatePixelChecksum) {
+
+    // Window attributes are only requested if the cached ones (maintained from the X11 events) have been invalidated
+    Status status = this->refreshAttributes();
     if (status == False) {
         spdlog::trace("WebXWindow 0x{:x} has been removed before getting an image", this->_x11Window);
         return nullptr;
@@ -102,8 +149,25 @@ std::shared_ptr<WebXImage> WebXWindow::getImage(const WebXRectangle * imageRecta
     this->disableDamage();
 #endif
 
-    XImage * image = XGetImage(this->_display, this->_x11Window, rectangle.x(), rectangle.y(), rectangle.size().width(), rectangle.size().height(), AllPlanes, ZPixmap);
-    std::shared_ptr<WebXImage> webXImage = nullptr;
+    // Errors caused by the grab are attributed to this window using the request serial
+    unsigned long requestSerial = WebXErrorHandler::getNextRequestSerial(this->_display);
+
+    // Use shared memory if available, otherwise copy the image through the X11 connection
+    XImage * image = NULL;
+    bool isShm = shmImagePool != NULL && shmImagePool->isAvailable();
+    if (isShm) {
+        image = shmImagePool->getImage(this->_x11Window, this->_visual, this->_depth, rectangle.x(), rectangle.y(), rectangle.size().width(), rectangle.size().height());
+
+        // Without an X11 error the shared memory image could not be allocated (eg shared memory limits): copy it instead
+        XErrorEvent error;
+        if (image == NULL && !WebXErrorHandler::getError(requestSerial, this->_x11Window, error)) {
+            isShm = false;
+        }
+    }
+
+    if (!isShm) {
+        image = XGetImage(this->_display, this->_x11Window, rectangle.x(), rectangle.y(), rectangle.size().width(), rectangle.size().height(), AllPlanes, ZPixmap);
+    }
 
 #ifdef ENABLE_DAMAGE_FIX
     this->enableDamage();
@@ -117,35 +181,50 @@ std::shared_ptr<WebXImage> WebXWindow::getImage(const WebXRectangle * imageRecta
         bool hasTransparency = checkTransparent(image);
         image->depth = hasTransparency ? 32 : 24;
 
-        webXImage = std::shared_ptr<WebXImage>(imageConverter->convert(image, quality));
+        uint64_t pixelChecksum = 0;
+        if (calculatePixelChecksum) {
+            std::chrono::high_resolution_clock::time_point checksumStart = std::chrono::high_resolution_clock::now();
 
-        XDestroyImage(image);
+            pixelChecksum = webx_calculatePixelChecksum((const unsigned char *)image->data, (size_t)image->bytes_per_line * image->height);
 
-        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double, std::milli> encodeDuration = end - grab;
-        std::chrono::duration<double, std::milli> duration = end - start;
+            std::chrono::high_resolution_clock::time_point checksumEnd = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double, std::micro> checksumDuration = checksumEnd - checksumStart;
+            spdlog::trace("Pixel checksum for WebXWindow 0x{:x} {:d} x {:d} in {:f}us", this->_x11Window, rectangle.size().width(), rectangle.size().height(), checksumDuration.count());
+        }
 
-        spdlog::trace("Grabbed WebXWindow 0x{:x} ({:d}, {:d}), {:d} x {:d} ({:s}) in {:.2f}ms (grab = {:.2f}ms, encoding = {:.2f}ms)", this->_x11Window, rectangle.x(), rectangle.y(), rectangle.size().width(), rectangle.size().height(), (isFull ? "full window" : "sub window"), duration.count(), grabDuration.count(), encodeDuration.count());
+        return std::make_shared<WebXWindowCapture>(this->_x11Window, image, rectangle, isFull, grabDuration.count(), isShm ? shmImagePool : NULL, pixelChecksum);
 
     } else {
-        // See if ErrorHandler has this window as it's last error source and determine exact error
-        if (WebXErrorHandler::getLastErrorWindow()) {
-            unsigned char lastError = WebXErrorHandler::getLastErrorCode();
-            if (lastError == BadWindow || lastError == BadDrawable) {
+        // See if the ErrorHandler has received an error for the grab of this window and determine exact error
+        XErrorEvent error;
+        if (WebXErrorHandler::getError(requestSerial, this->_x11Window, error)) {
+            if (error.error_code == BadWindow || error.error_code == BadDrawable) {
                 spdlog::warn("WebXWindow 0x{:x} has been removed while getting an image", this->_x11Window);
                 return nullptr;
 
-            } else if (lastError == BadMatch) {
+            } else if (error.error_code == BadMatch) {
                 spdlog::warn("Failed to get image for window 0x{:x}: requested rectangle is outside window bounds", this->_x11Window);
+
+                // The cached geometry is out of date: request it again for the next grab
+                this->invalidateAttributes();
                 return nullptr;
 
             } else {
-                spdlog::warn("Failed to get image for window 0x{:x}: error 0x{:02x}", this->_x11Window, lastError);
+                spdlog::warn("Failed to get image for window 0x{:x}: error 0x{:02x}", this->_x11Window, error.error_code);
             }
         }
     }
 
-    return webXImage;
+    return nullptr;
+}
+
+bool WebXWindow::isPixelChecksumUnchanged(uint64_t pixelChecksum, uint64_t previousPixelChecksum) {
+    if (previousPixelChecksum != 0 && pixelChecksum == previousPixelChecksum) {
+        this->_encodeSkipCount++;
+        spdlog::trace("Pixels unchanged for WebXWindow 0x{:x}: skipped encoding ({:d} skipped in total)", this->_x11Window, this->_encodeSkipCount);
+        return true;
+    }
+    return false;
 }
 
 void WebXWindow::addChild(WebXWindow * child) {
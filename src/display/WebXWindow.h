@@ -17,6 +17,8 @@
 #include "WebXWindowShape.h"
 
 class WebXWindowShape;
+class WebXShmImagePool;
+class WebXWindowCapture;
 
 /**
  * @class WebXWindow
@@ -38,8 +40,9 @@ public:
      * @param width Width of the window.
      * @param height Height of the window.
      * @param isViewable Indicates if the window is viewable.
+     * @param damageReportLevel The XDamage report level used when damage tracking is enabled.
      */
-    WebXWindow(Display * display, Window window, bool isRoot, int x, int y, int width, int height, bool isViewable);
+    WebXWindow(Display * display, Window window, bool isRoot, int x, int y, int width, int height, bool isViewable, int damageReportLevel);
 
     /**
      * @brief Destructor.
@@ -78,11 +81,34 @@ public:
     }
 
     /**
-     * @brief Updates the window's attributes.
+     * @brief Updates the window's attributes with a request to the X server.
      * @return Status of the update operation.
      */
     Status updateAttributes();
 
+    /**
+     * @brief Updates the window's attributes only if they have been invalidated: the geometry and map state are
+     * otherwise maintained from the X11 events.
+     * @return Status of the update operation (True if the cached attributes are valid).
+     */
+    Status refreshAttributes() {
+        return this->_attributesValid ? True : this->updateAttributes();
+    }
+
+    /**
+     * @brief Sets the window's attributes (obtained from the X server) and marks them as valid.
+     * @param attributes The X11 window attributes.
+     */
+    void setAttributes(const XWindowAttributes & attributes);
+
+    /**
+     * @brief Invalidates the window's attributes: they will be requested from the X server when next needed (eg when
+     * the window is reparented or the geometry of the root window changes).
+     */
+    void invalidateAttributes() {
+        this->_attributesValid = false;
+    }
+
     /**
      * @brief Prints information about the window.
      */
@@ -93,9 +119,37 @@ public:
      * @param imageRectangle Rectangle representing the area of the window to capture.
      * @param imageConverter Pointer to the image converter.
      * @param requestedQuality Requested quality of the image.
-     * @return Shared pointer to the captured image.
+     * @param shmImagePool Pointer to the shared memory image pool (NULL to capture using XGetImage).
+     * @param calculatePixelChecksum If true a hash of the raw pixels is calculated before encoding.
+     * @param previousPixelChecksum Pixel checksum of the previous image: the encoding is skipped if the pixels are unchanged (0 to always encode).
+     * @return Shared pointer to the captured image (nullptr if the pixels are unchanged).
+     */
+    std::shared_ptr<WebXImage> getImage(const WebXRectangle * imageRectangle, WebXImageConverter * imageConverter, const WebXQuality & requestedQuality, WebXShmImagePool * shmImagePool = NULL, bool calculatePixelChecksum = false, uint64_t previousPixelChecksum = 0);
+
+    /**
+     * @brief Grabs the raw pixels of the window (without encoding them).
+     * @param imageRectangle Rectangle representing the area of the window to capture (NULL for the full window).
+     * @param shmImagePool Pointer to the shared memory image pool (NULL to capture using XGetImage).
+     * @param calculatePixelChecksum If true a hash of the raw pixels is calculated.
+     * @return Shared pointer to the capture or nullptr if the window could not be grabbed.
+     */
+    std::shared_ptr<WebXWindowCapture> captureImage(const WebXRectangle * imageRectangle, WebXShmImagePool * shmImagePool = NULL, bool calculatePixelChecksum = false);
+
+    /**
+     * @brief Compares the checksum of grabbed pixels with the one of the previous image, counting the encodings that can be skipped.
+     * @param pixelChecksum The checksum of the grabbed pixels.
+     * @param previousPixelChecksum The checksum of the previous image (0 if unknown).
+     * @return True if the pixels are unchanged and the encoding can be skipped.
+     */
+    bool isPixelChecksumUnchanged(uint64_t pixelChecksum, uint64_t previousPixelChecksum);
+
+    /**
+     * @brief Retrieves the number of image encodings skipped because the raw pixels were unchanged.
+     * @return The number of skipped encodings.
      */
-    std::shared_ptr<WebXImage> getImage(const WebXRectangle * imageRectangle, WebXImageConverter * imageConverter, const WebXQuality & requestedQuality);
+    uint64_t getEncodeSkipCount() const {
+        return this->_encodeSkipCount;
+    }
 
     /**
      * Updates the WindowShape: takes into account that the window may not be rectangular
@@ -191,6 +245,14 @@ public:
         this->_visibility.setCoverage(coverage);
     }
 
+    /**
+     * @brief Sets the pixels of the window that are not hidden by the windows above it.
+     * @param visibleRegion The visible region in window coordinates.
+     */
+    void setVisibleRegion(const WebXRegion & visibleRegion) {
+        this->_visibility.setVisibleRegion(visibleRegion);
+    }
+
     /**
      * @brief Retrieves the visibility properties of the window.
      * @return Visibility properties of the window.
@@ -209,11 +271,40 @@ public:
      */
     void disableDamage();
 
+    /**
+     * @brief Checks if damage tracking has been enabled for the window.
+     * @return True if the window has a damage object.
+     */
+    bool hasDamage() {
+        std::lock_guard<std::mutex> lock(this->_damageMutex);
+        return this->_damage != 0;
+    }
+
+    /**
+     * @brief Requests the creation of the damage object of the window without waiting for the X server: used
+     * to enable damage tracking for a batch of windows with a single sync point (errors are only received after it).
+     * @return True if the damage object has been requested, false if damage tracking was already enabled.
+     */
+    bool createDamage();
+
+    /**
+     * @brief Forgets the damage object of the window, without destroying it: used when its creation has failed.
+     */
+    void resetDamage() {
+        std::lock_guard<std::mutex> lock(this->_damageMutex);
+        this->_damage = 0;
+    }
+
 private:
     Display * _display;
     Window _x11Window;
     Damage _damage;
+    int _damageReportLevel;
     bool _isRoot;
+    Visual * _visual;
+    int _depth;
+    bool _attributesValid;
+    uint64_t _encodeSkipCount;
 
     WebXWindow * _parent;
     std::vector<WebXWindow *> _children;
@@ -0,0 +1,95 @@
+#include "WebXWindowCapture.h"
+#include "WebXShmImagePool.h"
+#include <image/WebXImage.h>
+#include <image/WebXImageConverter.h>
+#include <utils/WebXImageUtils.h>
+#include <X11/Xutil.h>
+#include <vector>
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+WebXWindowCapture::~WebXWindowCapture() {
+    if (this->_shmImagePool) {
+        this->_shmImagePool->releaseImage(this->_image);
+
+    } else {
+        XDestroyImage(this->_image);
+    }
+}
+
+std::shared_ptr<WebXImage> WebXWindowCapture::encode(WebXImageConverter * imageConverter, const WebXQuality & quality, bool preserveCapture) const {
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    XImage * image = this->_image;
+    std::shared_ptr<WebXImage> webXImage = nullptr;
+
+    if (preserveCapture && image->depth == 32) {
+        // The alpha map is generated in place: encode a copy so that the capture can be encoded again
+        size_t dataSize = (size_t)image->bytes_per_line * image->height;
+        std::vector<unsigned char> data((unsigned char *)image->data, (unsigned char *)image->data + dataSize);
+        webXImage = std::shared_ptr<WebXImage>(imageConverter->convert(data.data(), image->width, image->height, image->bytes_per_line, image->depth, quality));
+
+    } else {
+        webXImage = std::shared_ptr<WebXImage>(imageConverter->convert(image, quality));
+    }
+
+    if (webXImage) {
+        webXImage->setPixelChecksum(this->_pixelChecksum);
+    }
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> encodeDuration = end - start;
+    double durationMs = this->_grabDurationMs + encodeDuration.count();
+
+    spdlog::trace("Grabbed WebXWindow 0x{:x} with {:s} ({:d}, {:d}), {:d} x {:d} ({:s}) in {:.2f}ms (grab = {:.2f}ms, encoding = {:.2f}ms)", this->_x11Window, (this->isShm() ? "XShmGetImage" : "XGetImage"), this->_rectangle.x(), this->_rectangle.y(), this->_rectangle.size().width(), this->_rectangle.size().height(), (this->_isFull ? "full window" : "sub window"), durationMs, this->_grabDurationMs, encodeDuration.count());
+
+    return webXImage;
+}
+
+
+uint64_t WebXWindowCapture::calculateAreaChecksum(const WebXRectangle & area) const {
+    XImage * image = this->_image;
+    return webx_calculateAreaChecksum((const unsigned char *)image->data, image->bytes_per_line, image->bits_per_pixel / 8,
+        area.x() - this->_rectangle.x(), area.y() - this->_rectangle.y(), area.size().width(), area.size().height());
+}
+
+std::shared_ptr<WebXWindowCapture> WebXWindowCapture::crop(const WebXRectangle & area) const {
+    XImage * image = this->_image;
+    if (image->format != ZPixmap || image->bits_per_pixel % 8 != 0) {
+        return nullptr;
+    }
+
+    int bytesPerPixel = image->bits_per_pixel / 8;
+    int width = area.size().width();
+    int height = area.size().height();
+    int bytesPerLine = width * bytesPerPixel;
+
+    // Allocated with malloc so that the image can be released with XDestroyImage
+    XImage * croppedImage = (XImage *)malloc(sizeof(XImage));
+    char * data = (char *)malloc((size_t)bytesPerLine * height);
+    if (croppedImage == NULL || data == NULL) {
+        free(croppedImage);
+        free(data);
+        return nullptr;
+    }
+
+    const char * source = image->data + (size_t)(area.y() - this->_rectangle.y()) * image->bytes_per_line + (size_t)(area.x() - this->_rectangle.x()) * bytesPerPixel;
+    for (int i = 0; i < height; i++) {
+        memcpy(data + (size_t)i * bytesPerLine, source + (size_t)i * image->bytes_per_line, bytesPerLine);
+    }
+
+    *croppedImage = *image;
+    croppedImage->width = width;
+    croppedImage->height = height;
+    croppedImage->xoffset = 0;
+    croppedImage->bytes_per_line = bytesPerLine;
+    croppedImage->data = data;
+    croppedImage->obdata = NULL;
+    if (XInitImage(croppedImage) == 0) {
+        free(croppedImage);
+        free(data);
+        return nullptr;
+    }
+
+    return std::make_shared<WebXWindowCapture>(this->_x11Window, croppedImage, area, false, 0.0, (WebXShmImagePool *)NULL, 0);
+}
@@ -0,0 +1,140 @@
+#ifndef WEBX_WINDOW_CAPTURE_H
+#define WEBX_WINDOW_CAPTURE_H
+
+#include <X11/Xlib.h>
+#include <memory>
+#include <models/WebXRectangle.h>
+#include <models/WebXQuality.h>
+
+class WebXShmImagePool;
+class WebXImageConverter;
+class WebXImage;
+
+/**
+ * @class WebXWindowCapture
+ * @brief Holds the raw pixels grabbed from a window (or an area of a window) before they are encoded.
+ *
+ * The XImage is owned by the capture and destroyed (or returned to the shared memory pool) when the
+ * capture is deleted. A capture makes no X11 calls once created so it can be encoded from any thread.
+ */
+class WebXWindowCapture {
+public:
+    /**
+     * @brief Constructs a WebXWindowCapture instance.
+     * @param x11Window The X11 window that has been grabbed.
+     * @param image The grabbed XImage.
+     * @param rectangle The area of the window that has been grabbed.
+     * @param isFull True if the full window has been grabbed.
+     * @param grabDurationMs Time taken to grab the pixels in milliseconds.
+     * @param shmImagePool The shared memory pool the image belongs to (NULL if obtained with XGetImage).
+     * @param pixelChecksum Hash of the raw pixels (0 if not calculated).
+     */
+    WebXWindowCapture(Window x11Window, XImage * image, const WebXRectangle & rectangle, bool isFull, double grabDurationMs, WebXShmImagePool * shmImagePool, uint64_t pixelChecksum) :
+        _x11Window(x11Window),
+        _image(image),
+        _rectangle(rectangle),
+        _isFull(isFull),
+        _grabDurationMs(grabDurationMs),
+        _shmImagePool(shmImagePool),
+        _pixelChecksum(pixelChecksum) {
+    }
+
+    /**
+     * @brief Destructor. Releases the XImage.
+     */
+    virtual ~WebXWindowCapture();
+
+    /**
+     * @brief Encodes the raw pixels of the capture.
+     * @param imageConverter Pointer to the image converter.
+     * @param quality Requested quality of the image.
+     * @param preserveCapture If true the pixels are left unmodified so that the capture can be encoded again.
+     * @return Shared pointer to the encoded image.
+     */
+    std::shared_ptr<WebXImage> encode(WebXImageConverter * imageConverter, const WebXQuality & quality, bool preserveCapture) const;
+
+    /**
+     * @brief Calculates the hash of the raw pixels of an area of the capture.
+     * @param area The area in window coordinates (must be contained in the captured rectangle).
+     * @return The hash of the area pixels.
+     */
+    uint64_t calculateAreaChecksum(const WebXRectangle & area) const;
+
+    /**
+     * @brief Creates a new capture containing a copy of the pixels of an area of this capture.
+     * @param area The area in window coordinates (must be contained in the captured rectangle).
+     * @return The cropped capture or nullptr if the pixel format is not supported.
+     */
+    std::shared_ptr<WebXWindowCapture> crop(const WebXRectangle & area) const;
+
+    /**
+     * @brief Retrieves the X11 window that has been grabbed.
+     * @return X11 window handle.
+     */
+    Window getX11Window() const {
+        return this->_x11Window;
+    }
+
+    /**
+     * @brief Retrieves the grabbed XImage.
+     * @return Pointer to the XImage.
+     */
+    XImage * getImage() const {
+        return this->_image;
+    }
+
+    /**
+     * @brief Retrieves the area of the window that has been grabbed.
+     * @return The grabbed rectangle (relative to the window).
+     */
+    const WebXRectangle & getRectangle() const {
+        return this->_rectangle;
+    }
+
+    /**
+     * @brief Checks if the full window has been grabbed.
+     * @return True if the full window has been grabbed, false if it is a sub window.
+     */
+    bool isFull() const {
+        return this->_isFull;
+    }
+
+    /**
+     * @brief Retrieves the time taken to grab the pixels.
+     * @return Grab duration in milliseconds.
+     */
+    double getGrabDurationMs() const {
+        return this->_grabDurationMs;
+    }
+
+    /**
+     * @brief Checks if the pixels were grabbed using shared memory.
+     * @return True if XShmGetImage was used.
+     */
+    bool isShm() const {
+        return this->_shmImagePool != NULL;
+    }
+
+    /**
+     * @brief Retrieves the hash of the raw pixels.
+     * @return The pixel checksum or 0 if it has not been calculated.
+     */
+    uint64_t getPixelChecksum() const {
+        return this->_pixelChecksum;
+    }
+
+private:
+    WebXWindowCapture(const WebXWindowCapture &) = delete;
+    WebXWindowCapture & operator=(const WebXWindowCapture &) = delete;
+
+private:
+    Window _x11Window;
+    XImage * _image;
+    WebXRectangle _rectangle;
+    bool _isFull;
+    double _grabDurationMs;
+    WebXShmImagePool * _shmImagePool;
+    uint64_t _pixelChecksum;
+};
+
+#endif /* WEBX_WINDOW_CAPTURE_H */
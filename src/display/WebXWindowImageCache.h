@@ -0,0 +1,219 @@
+#ifndef WEBX_WINDOW_IMAGE_CACHE_H
+#define WEBX_WINDOW_IMAGE_CACHE_H
+
+#include <X11/Xlib.h>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <future>
+#include <image/WebXImage.h>
+#include <models/WebXQuality.h>
+#include <models/WebXRectangle.h>
+#include "WebXWindowCapture.h"
+
+/**
+ * @class WebXWindowImageCache
+ * @brief Short-lived cache of window captures and encoded images.
+ *
+ * The cache is active for the duration of a single controller update: client groups requesting the same
+ * area of the same window share the capture of the pixels, and share the encoded image when their
+ * rgb and alpha qualities are identical.
+ */
+class WebXWindowImageCache {
+private:
+    /**
+     * @brief Identifies the captured area of a window (the rectangle is ignored for full window captures).
+     */
+    struct CaptureKey {
+        CaptureKey(Window window, const WebXRectangle * rectangle) :
+            window(window),
+            isFull(rectangle == NULL),
+            x(rectangle ? rectangle->x() : 0),
+            y(rectangle ? rectangle->y() : 0),
+            width(rectangle ? rectangle->size().width() : 0),
+            height(rectangle ? rectangle->size().height() : 0) {}
+
+        bool operator<(const CaptureKey & key) const {
+            return std::tie(window, isFull, x, y, width, height) < std::tie(key.window, key.isFull, key.x, key.y, key.width, key.height);
+        }
+
+        Window window;
+        bool isFull;
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    /**
+     * @brief Identifies an encoded capture.
+     */
+    struct ImageKey {
+        ImageKey(const CaptureKey & captureKey, const WebXQuality & quality) :
+            captureKey(captureKey),
+            rgbQuality(quality.rgbQuality),
+            alphaQuality(quality.alphaQuality) {}
+
+        bool operator<(const ImageKey & key) const {
+            return std::tie(captureKey, rgbQuality, alphaQuality) < std::tie(key.captureKey, key.rgbQuality, key.alphaQuality);
+        }
+
+        CaptureKey captureKey;
+        float rgbQuality;
+        float alphaQuality;
+    };
+
+    /**
+     * @brief An encoded image (possibly still being encoded) and the checksum of the pixels it is encoded from.
+     */
+    struct ImageEntry {
+        std::shared_future<std::shared_ptr<WebXImage>> image;
+        uint64_t pixelChecksum;
+    };
+
+public:
+    /**
+     * @brief Constructs an (inactive) WebXWindowImageCache instance.
+     */
+    WebXWindowImageCache() :
+        _active(false),
+        _captureHits(0),
+        _captureMisses(0),
+        _imageHits(0),
+        _imageMisses(0) {}
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~WebXWindowImageCache() {}
+
+    /**
+     * @brief Activates the cache and resets the hit and miss counters.
+     */
+    void activate() {
+        this->_active = true;
+        this->_captureHits = 0;
+        this->_captureMisses = 0;
+        this->_imageHits = 0;
+        this->_imageMisses = 0;
+    }
+
+    /**
+     * @brief Deactivates the cache and releases all captures and images.
+     */
+    void deactivate() {
+        this->_active = false;
+        this->_captures.clear();
+        this->_images.clear();
+    }
+
+    /**
+     * @brief Checks if the cache is active.
+     * @return True if the cache is active.
+     */
+    bool isActive() const {
+        return this->_active;
+    }
+
+    /**
+     * @brief Searches for a capture of a window area.
+     * @param window The X11 window.
+     * @param rectangle The area of the window (NULL for the full window).
+     * @param capture Set to the cached capture if found (can be nullptr if the capture previously failed).
+     * @return True if the capture is in the cache.
+     */
+    bool findCapture(Window window, const WebXRectangle * rectangle, std::shared_ptr<WebXWindowCapture> & capture) {
+        auto it = this->_captures.find(CaptureKey(window, rectangle));
+        if (it != this->_captures.end()) {
+            this->_captureHits++;
+            capture = it->second;
+            return true;
+        }
+        this->_captureMisses++;
+        return false;
+    }
+
+    /**
+     * @brief Stores the capture of a window area.
+     * @param window The X11 window.
+     * @param rectangle The area of the window (NULL for the full window).
+     * @param capture The capture (nullptr if the capture failed).
+     */
+    void putCapture(Window window, const WebXRectangle * rectangle, std::shared_ptr<WebXWindowCapture> capture) {
+        this->_captures[CaptureKey(window, rectangle)] = capture;
+    }
+
+    /**
+     * @brief Searches for an encoded image of a window area.
+     * @param window The X11 window.
+     * @param rectangle The area of the window (NULL for the full window).
+     * @param quality The quality of the encoding.
+     * @param image Set to the (future) cached image if found.
+     * @param pixelChecksum Set to the checksum of the pixels the image is encoded from.
+     * @return True if the image is in the cache.
+     */
+    bool findImage(Window window, const WebXRectangle * rectangle, const WebXQuality & quality, std::shared_future<std::shared_ptr<WebXImage>> & image, uint64_t & pixelChecksum) {
+        auto it = this->_images.find(ImageKey(CaptureKey(window, rectangle), quality));
+        if (it != this->_images.end()) {
+            this->_imageHits++;
+            image = it->second.image;
+            pixelChecksum = it->second.pixelChecksum;
+            return true;
+        }
+        this->_imageMisses++;
+        return false;
+    }
+
+    /**
+     * @brief Stores an encoded image of a window area.
+     * @param window The X11 window.
+     * @param rectangle The area of the window (NULL for the full window).
+     * @param quality The quality of the encoding.
+     * @param image The (future) encoded image.
+     * @param pixelChecksum The checksum of the pixels the image is encoded from.
+     */
+    void putImage(Window window, const WebXRectangle * rectangle, const WebXQuality & quality, std::shared_future<std::shared_ptr<WebXImage>> image, uint64_t pixelChecksum) {
+        this->_images[ImageKey(CaptureKey(window, rectangle), quality)] = ImageEntry{image, pixelChecksum};
+    }
+
+    /**
+     * @brief Number of captures obtained from the cache since activation.
+     */
+    unsigned int getCaptureHits() const {
+        return this->_captureHits;
+    }
+
+    /**
+     * @brief Number of captures made since activation.
+     */
+    unsigned int getCaptureMisses() const {
+        return this->_captureMisses;
+    }
+
+    /**
+     * @brief Number of encoded images obtained from the cache since activation.
+     */
+    unsigned int getImageHits() const {
+        return this->_imageHits;
+    }
+
+    /**
+     * @brief Number of images encoded since activation.
+     */
+    unsigned int getImageMisses() const {
+        return this->_imageMisses;
+    }
+
+private:
+    bool _active;
+
+    std::map<CaptureKey, std::shared_ptr<WebXWindowCapture>> _captures;
+    std::map<ImageKey, ImageEntry> _images;
+
+    unsigned int _captureHits;
+    unsigned int _captureMisses;
+    unsigned int _imageHits;
+    unsigned int _imageMisses;
+};
+
+#endif /* WEBX_WINDOW_IMAGE_CACHE_H */
@@ -79,6 +79,9 @@ void WebXWindowShape::create(WebXImageConverter * imageConverter, const WebXQual
 
     // spdlog::info("Window 0x{:x} with size {:d}x{:d} has shape with {:d} rectangles", this->_x11Window, this->_width, this->_height, count);
 
+    // Errors caused by the creation of the mask (window or pixmap) are attributed to this window using the request serial
+    unsigned long requestSerial = WebXErrorHandler::getNextRequestSerial(this->_display);
+
     // Create an 8-bit Pixmap with the same size as the window
     Pixmap pixmap = XCreatePixmap(this->_display, this->_x11Window, this->_width, this->_height, 8);
     GC gc = XCreateGC(this->_display, pixmap, 0, NULL);
@@ -109,17 +112,17 @@ void WebXWindowShape::create(WebXImageConverter * imageConverter, const WebXQual
         this->_isBuilt = true;
 
     } else {
-        // See if ErrorHandler has this window as it's last error source and determine exact error
-        if (WebXErrorHandler::getLastErrorWindow()) {
-            unsigned char lastError = WebXErrorHandler::getLastErrorCode();
-            if (lastError == BadWindow || lastError == BadDrawable) {
+        // See if the ErrorHandler has received an error for the requests creating the mask and determine exact error
+        XErrorEvent error;
+        if (WebXErrorHandler::getError(requestSerial, 0, error)) {
+            if (error.error_code == BadWindow || error.error_code == BadDrawable) {
                 spdlog::warn("WebXWindow 0x{:x} has been removed while getting shape mask", this->_x11Window);
 
-            } else if (lastError == BadMatch) {
+            } else if (error.error_code == BadMatch) {
                 spdlog::warn("Failed to get shape mask for window 0x{:x}: requested rectangle is outside window bounds", this->_x11Window);
 
             } else {
-                spdlog::warn("Failed to get shape mask for window 0x{:x}: error 0x{:02x}", this->_x11Window, lastError);
+                spdlog::warn("Failed to get shape mask for window 0x{:x}: error 0x{:02x}", this->_x11Window, error.error_code);
             }
         }
 
@@ -0,0 +1,50 @@
+#ifndef WEBX_CIRCULATE_EVENT_H
+#define WEBX_CIRCULATE_EVENT_H
+
+#include <X11/Xlib.h>
+
+class WebXCirculateEvent {
+public:
+    /** 
+     * Constructor of the WebXCirculateEvent
+     * @param xCirculateEvent The original XCirculateEvent event
+     */
+    WebXCirculateEvent(const XCirculateEvent & xCirculateEvent) :
+        _xCirculateEvent(xCirculateEvent) {
+    }
+
+    /**
+     * Destructor for the WebXCirculateEvent class.
+     */
+    virtual ~WebXCirculateEvent() {
+    }
+
+    /**
+     * Gets the X11 window associated with the event.
+     * @return The X11 window.
+     */
+    Window getWindow() const {
+        return this->_xCirculateEvent.window;
+    }
+
+    /**
+     * Returns the serial associated with the event.
+     * @return the serial of the event
+     */
+    int getSerial() const {
+        return this->_xCirculateEvent.serial;
+    }
+
+    /**
+     * Checks if the window has been placed on top of its siblings (otherwise it has been placed at the bottom).
+     * @return True if the window is now on top of the stack.
+     */
+    bool isPlacedOnTop() const {
+        return this->_xCirculateEvent.place == PlaceOnTop;
+    }
+
+private:
+    const XCirculateEvent _xCirculateEvent;
+};
+
+#endif /* WEBX_CIRCULATE_EVENT_H */
@@ -67,6 +67,14 @@ public:
         return this->_xConfigureEvent.height;
     }
 
+    /**
+     * Gets the sibling window directly below the window in the stacking order
+     * @return The sibling window (None if the window is at the bottom of the stack).
+     */
+    Window getAboveWindow() const {
+        return this->_xConfigureEvent.above;
+    }
+
 private:
     const XConfigureEvent _xConfigureEvent;
 };
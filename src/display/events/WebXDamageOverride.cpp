@@ -3,17 +3,17 @@
 #include <X11/Xlibint.h>
 
 WireToEventType WebXDamageOverride::ORIGINAL_WIRE_TO_EVENT_HANDLER = 0;
-Window WebXDamageOverride:: WINDOW_TO_IGNORE = 0;
+std::set<Window> WebXDamageOverride::WINDOWS_TO_IGNORE;
 
 int WebXDamageOverride::WIRE_TO_EVENT_WRAPPER(Display * dpy, XEvent * event, xEvent *wire) {
     
     // Verify that 
     if (ORIGINAL_WIRE_TO_EVENT_HANDLER) {
         Bool originalReturnValue = ORIGINAL_WIRE_TO_EVENT_HANDLER(dpy, event, wire);
-        if (originalReturnValue == True && WINDOW_TO_IGNORE != 0) {
+        if (originalReturnValue == True && !WINDOWS_TO_IGNORE.empty()) {
             XDamageNotifyEvent * damageEvent = (XDamageNotifyEvent *) event;
 
-            return (damageEvent->drawable != WINDOW_TO_IGNORE);
+            return WINDOWS_TO_IGNORE.find(damageEvent->drawable) == WINDOWS_TO_IGNORE.end();
       
         } else {
             return originalReturnValue;
@@ -3,6 +3,7 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xproto.h>
+#include <set>
 
 typedef int (* WireToEventType) (Display * display, XEvent * event, xEvent *	wire);
 
@@ -48,12 +49,23 @@ public:
      * @param windowToIgnore The X11 window to ignore.
      */
     static void setWindowToIgnore(Window windowToIgnore) {
-      WINDOW_TO_IGNORE = windowToIgnore;
+      WINDOWS_TO_IGNORE.clear();
+      if (windowToIgnore != 0) {
+        WINDOWS_TO_IGNORE.insert(windowToIgnore);
+      }
+    }
+
+    /**
+     * Sets the windows to ignore for damage events (used when damage is enabled for a batch of windows).
+     * @param windowsToIgnore The X11 windows to ignore (empty to stop ignoring).
+     */
+    static void setWindowsToIgnore(const std::set<Window> & windowsToIgnore) {
+      WINDOWS_TO_IGNORE = windowsToIgnore;
     }
 
 private:
     static WireToEventType ORIGINAL_WIRE_TO_EVENT_HANDLER;
-    static Window WINDOW_TO_IGNORE;
+    static std::set<Window> WINDOWS_TO_IGNORE;
 
     /**
      * Custom wire-to-event handler to filter out damage events for the ignored window.
@@ -0,0 +1,34 @@
+#ifndef WEBX_DESTROY_EVENT_H
+#define WEBX_DESTROY_EVENT_H
+
+#include <X11/Xlib.h>
+
+class WebXDestroyEvent {
+public:
+    /** 
+     * Constructor of the WebXDestroyEvent
+     * @param xDestroyWindowEvent The original XDestroyWindowEvent event
+     */
+    WebXDestroyEvent(const XDestroyWindowEvent & xDestroyWindowEvent) :
+        _xDestroyWindowEvent(xDestroyWindowEvent) {
+    }
+
+    /**
+     * Destructor for the WebXDestroyEvent class.
+     */
+    virtual ~WebXDestroyEvent() {
+    }
+
+    /**
+     * Gets the X11 window associated with the event.
+     * @return The X11 window.
+     */
+    Window getWindow() const {
+        return this->_xDestroyWindowEvent.window;
+    }
+
+private:
+    const XDestroyWindowEvent _xDestroyWindowEvent;
+};
+
+#endif /* WEBX_DESTROY_EVENT_H */
\ No newline at end of file
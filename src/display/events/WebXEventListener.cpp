@@ -16,11 +16,13 @@ WebXEventListener::WebXEventListener(const WebXSettings & settings, Display * di
     _rootWindow(rootWindow),
     _mapEventHandler([](const WebXMapEvent &) {}),
     _unmapEventHandler([](const WebXUnmapEvent &) {}),
+    _destroyEventHandler([](const WebXDestroyEvent &) {}),
     _reparentEventHandler([](const WebXReparentEvent &) {}),
     _configureEventHandler([](const WebXConfigureEvent &) {}),
+    _circulateEventHandler([](const WebXCirculateEvent &) {}),
     _selectionEventHandler([](const WebXSelectionEvent &) {}),
     _selectionRequestEventHandler([](const WebXSelectionRequestEvent &) {}),
-    _damageEventHandler([](const WebXDamageEvent &) {}),
+    _damageEventHandler([](const std::vector<WebXWindowDamage> &) {}),
     _cursorEventHandler([](const WebXCursorEvent &) {}),
     _shapeEventHandler([](const WebXShapeEvent &) {}),
     _damageEventBase(0),
@@ -30,7 +32,9 @@ WebXEventListener::WebXEventListener(const WebXSettings & settings, Display * di
     _xshapeEventBase(0),
     _xshapeErrorBase(0),
     _xrandrEventBase(0),
-    _xrandrErrorBase(0) {
+    _xrandrErrorBase(0),
+    _damageRegionModeEnabled(settings.display.damageReportMode == WebXDisplaySettings::Region),
+    _damageRegion(0) {
 
     XSelectInput(this->_x11Display, this->_rootWindow, SubstructureNotifyMask);
 
@@ -55,7 +59,14 @@ WebXEventListener::WebXEventListener(const WebXSettings & settings, Display * di
         spdlog::info("No X11 xrandr extension detected");
     }
 
-    if (settings.event.filterDamageAfterConfigureNotify) {
+    if (this->_damageRegionModeEnabled) {
+        // Region used to fetch the damage of each window
+        this->_damageRegion = XFixesCreateRegion(this->_x11Display, NULL, 0);
+        spdlog::info("Using damage region mode");
+    }
+
+    // Damage events can't be filtered in region mode (a single event is sent until the damage is fetched)
+    if (settings.event.filterDamageAfterConfigureNotify && !this->_damageRegionModeEnabled) {
         // Set up the filter function to filter damage events after configure notify
         this->_filterFunction = [this](const XEvent * event) { return this->filter(event); };
 
@@ -70,6 +81,11 @@ WebXEventListener::WebXEventListener(const WebXSettings & settings, Display * di
 }
 
 WebXEventListener::~WebXEventListener() {
+    if (this->_damageRegion) {
+        XFixesDestroyRegion(this->_x11Display, this->_damageRegion);
+        this->_damageRegion = 0;
+    }
+
     if (this->_damageOverride) {
         this->_damageOverride->disable();
         delete this->_damageOverride;
@@ -80,8 +96,8 @@ WebXEventListener::~WebXEventListener() {
 void WebXEventListener::flushQueuedEvents() {
     XEvent x11Event;
 
-    XFlush(this->_x11Display);
-    int qLength = QLength(this->_x11Display);
+    // Flush requests and read any events available on the connection without blocking
+    int qLength = XEventsQueued(this->_x11Display, QueuedAfterFlush);
 
     // Loop through all events in the queue. Filter them using the filter function (removes excesss damage events created when the ConfigureNotify event is received)
     for (int i = 0; i < qLength; i++) {
@@ -91,12 +107,64 @@ void WebXEventListener::flushQueuedEvents() {
         }
     }
 
+    // Deliver the damage of all the events in a single batch
+    this->fetchDamageRegions();
+    this->sendPendingDamage();
+
     // Remove old damage filters (older than 1 second)
     auto now = std::chrono::high_resolution_clock::now();
-    this->_damageFilters.erase(std::remove_if(this->_damageFilters.begin(), this->_damageFilters.end(),
-        [&now](const std::unique_ptr<WebXDamageFilter> & damageFilter) {
-            return (now - damageFilter->timestamp) > std::chrono::seconds(1);
-        }), this->_damageFilters.end());
+    for (auto it = this->_damageFilters.begin(); it != this->_damageFilters.end();) {
+        if ((now - it->second) > std::chrono::seconds(1)) {
+            it = this->_damageFilters.erase(it);
+
+        } else {
+            it++;
+        }
+    }
+}
+
+void WebXEventListener::addWindowDamage(const WebXWindowDamage & damage) {
+    auto it = this->_pendingDamage.find(damage.getX11Window());
+    if (it == this->_pendingDamage.end()) {
+        this->_pendingDamage.insert(std::make_pair(damage.getX11Window(), damage));
+
+    } else {
+        it->second += damage;
+    }
+}
+
+void WebXEventListener::fetchDamageRegions() {
+    for (const auto & damagedWindow : this->_damagedWindows) {
+        // Move the damage of the window into the region: a new event is sent when the window is damaged again
+        XDamageSubtract(this->_x11Display, damagedWindow.second, None, this->_damageRegion);
+
+        int numberOfRectangles = 0;
+        XRectangle * rectangles = XFixesFetchRegion(this->_x11Display, this->_damageRegion, &numberOfRectangles);
+        if (rectangles) {
+            for (int i = 0; i < numberOfRectangles; i++) {
+                const XRectangle & rectangle = rectangles[i];
+                this->addWindowDamage(WebXWindowDamage(damagedWindow.first, WebXRectangle(rectangle.x, rectangle.y, rectangle.width, rectangle.height)));
+            }
+            XFree(rectangles);
+        }
+    }
+    this->_damagedWindows.clear();
+}
+
+void WebXEventListener::sendPendingDamage() {
+    if (this->_pendingDamage.empty()) {
+        return;
+    }
+
+    std::vector<WebXWindowDamage> damages;
+    damages.reserve(this->_pendingDamage.size());
+    for (const auto & pendingDamage : this->_pendingDamage) {
+        damages.push_back(pendingDamage.second);
+    }
+    this->_pendingDamage.clear();
+
+    spdlog::trace("Sending damage for {:d} windows", damages.size());
+    this->_damageEventHandler(damages);
 }
 
 void WebXEventListener::handleXEvent(const XEvent * event) {
@@ -106,12 +174,18 @@ void WebXEventListener::handleXEvent(const XEvent * event) {
     } else if (event->type == UnmapNotify) {
         this->_unmapEventHandler(WebXUnmapEvent(event->xunmap));
 
+    } else if (event->type == DestroyNotify) {
+        this->_destroyEventHandler(WebXDestroyEvent(event->xdestroywindow));
+
     } else if (event->type == ReparentNotify) {
         this->_reparentEventHandler(WebXReparentEvent(event->xreparent));
 
     } else if (event->type == ConfigureNotify) {
         this->_configureEventHandler(WebXConfigureEvent(event->xconfigure));
 
+    } else if (event->type == CirculateNotify) {
+        this->_circulateEventHandler(WebXCirculateEvent(event->xcirculate));
+
     } else if (event->type == SelectionNotify) {
         this->_selectionEventHandler(WebXSelectionEvent(event->xselection));
 
@@ -120,7 +194,15 @@ void WebXEventListener::handleXEvent(const XEvent * event) {
 
     } else if (event->type == this->_damageEventBase + XDamageNotify) {
         XDamageNotifyEvent * damageEvent = (XDamageNotifyEvent *)event;
-        this->_damageEventHandler(WebXDamageEvent(*damageEvent));
+        if (this->_damageRegionModeEnabled) {
+            // The damaged region of the window is fetched at the end of the flush
+            this->_damagedWindows[damageEvent->drawable] = damageEvent->damage;
+
+        } else {
+            // Accumulate the damage of the window (sent at the end of the flush)
+            WebXDamageEvent webXDamageEvent(*damageEvent);
+            this->addWindowDamage(WebXWindowDamage(webXDamageEvent.getWindow(), webXDamageEvent.getRectangle()));
+        }
 
     } else if (event->type == this->_xfixesEventBase + XFixesCursorNotify) {
         this->_cursorEventHandler(WebXCursorEvent());
@@ -141,11 +223,12 @@ void WebXEventListener::handleXEvent(const XEvent * event) {
 bool WebXEventListener::filter(const XEvent * event) {
     if (event->type == this->_damageEventBase + XDamageNotify) {
         // Handle damage event
+        if (this->_damageFilters.empty()) {
+            return true;
+        }
+
         XDamageNotifyEvent * damageEvent = (XDamageNotifyEvent *) event;
-        auto it = std::find_if(this->_damageFilters.begin(), this->_damageFilters.end(), 
-        [&damageEvent](const std::unique_ptr<WebXDamageFilter> & damageFilter) {
-            return damageFilter->window == damageEvent->drawable && damageFilter->serial == damageEvent->serial;
-        });
+        auto it = this->_damageFilters.find(WebXDamageFilterKey(damageEvent->drawable, damageEvent->serial));
 
         // Damage event is not associated to a configure notify
         if (it == this->_damageFilters.end()) {
@@ -162,7 +245,7 @@ bool WebXEventListener::filter(const XEvent * event) {
     } else if (event->type == ConfigureNotify) {
         // Handle configure event
         XConfigureEvent * configureEvent = (XConfigureEvent *) event;
-        this->_damageFilters.push_back(std::unique_ptr<WebXDamageFilter>(new WebXDamageFilter(configureEvent->window, configureEvent->serial)));
+        this->_damageFilters[WebXDamageFilterKey(configureEvent->window, configureEvent->serial)] = std::chrono::high_resolution_clock::now();
 
         return true;
     
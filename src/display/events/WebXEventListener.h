@@ -2,14 +2,19 @@
 #define WEBX_EVENT_LISTENER_H
 
 #include <X11/Xlib.h>
+#include <X11/extensions/Xdamage.h>
 #include <map>
+#include <vector>
 #include <functional>
 #include <models/WebXSettings.h>
+#include <models/WebXWindowDamage.h>
 
 #include "WebXMapEvent.h"
 #include "WebXUnmapEvent.h"
+#include "WebXDestroyEvent.h"
 #include "WebXReparentEvent.h"
 #include "WebXConfigureEvent.h"
+#include "WebXCirculateEvent.h"
 #include "WebXSelectionEvent.h"
 #include "WebXSelectionRequestEvent.h"
 #include "WebXDamageEvent.h"
@@ -39,10 +44,17 @@ public:
     virtual ~WebXEventListener();
 
     /**
-     * Flushes any queued events that need to be processed.
+     * Flushes any queued events that need to be processed. Damage events are accumulated per window and the merged
+     * damage of all windows is delivered once, as a single batch, after all the queued events have been handled.
      */
     void flushQueuedEvents();
 
+    /**
+     * Adds damage to the batch delivered at the end of the current flush (eg full window damage after a resize)
+     * @param damage The window damage to add
+     */
+    void addWindowDamage(const WebXWindowDamage & damage);
+
     /**
      * Sets the event handler for the map event
      * @param handler The handler for the map event
@@ -59,6 +71,14 @@ public:
         this->_unmapEventHandler = handler;
     }
 
+    /**
+     * Sets the event handler for the destroy event
+     * @param handler The handler for the destroy event
+     */
+    void setDestroyEventHandler(std::function<void(const WebXDestroyEvent &)> handler) {
+        this->_destroyEventHandler = handler;
+    }
+
     /**
      * Sets the event handler for the reparent event
      * @param handler The handler for the reparent event
@@ -75,6 +95,14 @@ public:
         this->_configureEventHandler = handler;
     }
 
+    /**
+     * Sets the event handler for the circulate event
+     * @param handler The handler for the circulate event
+     */
+    void setCirculateEventHandler(std::function<void(const WebXCirculateEvent &)> handler) {
+        this->_circulateEventHandler = handler;
+    }
+
     /**
      * Sets the event handler for the selection event
      * @param handler The handler for the selection event
@@ -92,10 +120,10 @@ public:
     }
 
     /**
-     * Sets the event handler for the damage event
-     * @param handler The handler for the damage event
+     * Sets the event handler for the merged damage of each flush of the queued events
+     * @param handler The handler for the damage of all the damaged windows
      */
-    void setDamageEventHandler(std::function<void(const WebXDamageEvent &)> handler) {
+    void setDamageEventHandler(std::function<void(const std::vector<WebXWindowDamage> &)> handler) {
         this->_damageEventHandler = handler;
     }
 
@@ -142,18 +170,22 @@ private:
      */
     bool filter(const XEvent * event);
 
+    /**
+     * In region mode, fetches the damaged region of each window that has reported damage (emptying the damage so that
+     * new damage is reported) and adds the region rectangles to the pending damage: one round trip per damaged window
+     */
+    void fetchDamageRegions();
+
+    /**
+     * Delivers the damage accumulated during the flush to the damage event handler
+     */
+    void sendPendingDamage();
+
 private:
-    class WebXDamageFilter {
-    public:
-        WebXDamageFilter(const XID window, const unsigned long serial) :
-            timestamp(std::chrono::high_resolution_clock::now()),
-            window(window), 
-            serial(serial) {}
-            
-        const std::chrono::high_resolution_clock::time_point timestamp;
-        const XID window;
-        const unsigned long serial;
-    };
+    /**
+     * Damage filters are indexed by window and serial of the ConfigureNotify event, the value being the creation time of the filter
+     */
+    typedef std::pair<XID, unsigned long> WebXDamageFilterKey;
 
 private:
     Display * _x11Display;
@@ -161,11 +193,13 @@ private:
 
     std::function<void(const WebXMapEvent &)> _mapEventHandler;
     std::function<void(const WebXUnmapEvent &)> _unmapEventHandler;
+    std::function<void(const WebXDestroyEvent &)> _destroyEventHandler;
     std::function<void(const WebXReparentEvent &)> _reparentEventHandler;
     std::function<void(const WebXConfigureEvent &)> _configureEventHandler;
+    std::function<void(const WebXCirculateEvent &)> _circulateEventHandler;
     std::function<void(const WebXSelectionEvent &)> _selectionEventHandler;
     std::function<void(const WebXSelectionRequestEvent &)> _selectionRequestEventHandler;
-    std::function<void(const WebXDamageEvent &)> _damageEventHandler;
+    std::function<void(const std::vector<WebXWindowDamage> &)> _damageEventHandler;
     std::function<void(const WebXCursorEvent &)> _cursorEventHandler;
     std::function<void(const WebXShapeEvent &)> _shapeEventHandler;
     std::function<void(const WebXRandREvent &)> _randrEventHandler;
@@ -181,7 +215,12 @@ private:
     int _xrandrEventBase;
     int _xrandrErrorBase;
 
-    std::vector<std::unique_ptr<WebXDamageFilter>> _damageFilters;
+    std::map<WebXDamageFilterKey, std::chrono::high_resolution_clock::time_point> _damageFilters;
+    std::map<Window, WebXWindowDamage> _pendingDamage;
+
+    bool _damageRegionModeEnabled;
+    XserverRegion _damageRegion;
+    std::map<Window, Damage> _damagedWindows;
     std::function<bool(const XEvent * event)> _filterFunction;
 };
 
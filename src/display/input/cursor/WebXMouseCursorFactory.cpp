@@ -1,6 +1,7 @@
 #include "WebXMouseCursorFactory.h"
 #include <models/WebXQuality.h>
 #include <crc32/Crc32.h>
+#include <utils/WebXPixelKernels.h>
 #include <spdlog/spdlog.h>
 
 WebXMouseCursorFactory::WebXMouseCursorFactory(Display * x11Display) :
@@ -57,28 +58,7 @@ std::shared_ptr<WebXImage> WebXMouseCursorFactory::convertCursorImage(XFixesCurs
     // Convert raw image data to WebXImage
     unsigned int imageByteLength = cursorImage->width * cursorImage->height * 4;
     unsigned char * imageData = (unsigned char *)malloc(imageByteLength);
-    unsigned long * src = cursorImage->pixels;
-    unsigned int offset = 0;
-    while (offset < imageByteLength) {
-        uint32_t p = *src++;
-        uint8_t r = p >> 0;
-        uint8_t g = p >> 8;
-        uint8_t b = p >> 16;
-        uint8_t a = p >> 24;
-
-        if (a > 0x00 && a < 0xff) {
-            r = (r * 0xff + a / 2) / a;
-            g = (g * 0xff + a / 2) / a;
-            b = (b * 0xff + a / 2) / a;
-        }
-
-        imageData[offset + 0] = b;
-        imageData[offset + 1] = g;
-        imageData[offset + 2] = r;
-        imageData[offset + 3] = a;
-
-        offset += 4;
-    }
+    WebXPixelKernels::Get().convertCursorPixels(cursorImage->pixels, imageData, cursorImage->width * cursorImage->height);
 
     WebXImage * image = this->_imageConverter.convert(imageData, (int)cursorImage->width, (int)cursorImage->height, (int)cursorImage->width * 4, 32, WebXQuality::MaxQuality());
     free(imageData);
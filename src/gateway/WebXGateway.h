@@ -3,8 +3,11 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 #include <utils/WebXResult.h>
 #include <models/WebXVersion.h>
+#include <models/WebXClientIndexMask.h>
+#include <models/WebXMessageLaneMetrics.h>
 
 class WebXMessage;
 class WebXInstruction;
@@ -23,6 +26,7 @@ public:
      */
     WebXGateway() : 
         _messagePublisherFunc(nullptr),
+        _messageLaneMetricsFunc(nullptr),
         _instructionHandlerFunc(nullptr) 
         {}
 
@@ -41,6 +45,17 @@ public:
         }
     }
 
+    /**
+     * @brief Gets the metrics of the lanes of the message publisher queue using the provided function.
+     * @return The metrics of the message lanes (empty if the transport is not running).
+     */
+    std::vector<WebXMessageLaneMetrics> getMessageLaneMetrics() const {
+        if (this->_messageLaneMetricsFunc) {
+            return this->_messageLaneMetricsFunc();
+        }
+        return std::vector<WebXMessageLaneMetrics>();
+    }
+
     /**
      * @brief Handles an instruction using the provided instruction handler function.
      * @param instruction A shared pointer to the WebXInstruction to be handled.
@@ -54,14 +69,14 @@ public:
     /**
      * @brief Handles client connection events.
      * @param clientVersion The version of the client connecting.
-     * @return A WebXResult containing a pair of client ID and timestamp, or an error message.
+     * @return A WebXResult containing a pair of client ID and client index mask, or an error message.
      */
-    const WebXResult<std::pair<uint32_t, uint64_t>> onClientConnect(const WebXVersion & clientVersion) {
+    const WebXResult<std::pair<uint32_t, WebXClientIndexMask>> onClientConnect(const WebXVersion & clientVersion) {
         if (this->_clientConnectFunc) {
             return this->_clientConnectFunc(clientVersion);
         }
 
-        return WebXResult<std::pair<uint32_t, uint64_t>>::Err("engine configuration error");
+        return WebXResult<std::pair<uint32_t, WebXClientIndexMask>>::Err("engine configuration error");
     }
 
     /**
@@ -84,6 +99,14 @@ public:
         this->_messagePublisherFunc = func;
     }
 
+    /**
+     * @brief Sets the function to get the metrics of the message lanes.
+     * @param func A function returning the metrics of the message lanes.
+     */
+    void setMessageLaneMetricsFunc(std::function<std::vector<WebXMessageLaneMetrics>()> func) {
+        this->_messageLaneMetricsFunc = func;
+    }
+
     /**
      * @brief Sets the function to handle instructions.
      * @param func A function that takes a shared pointer to WebXInstruction.
@@ -96,7 +119,7 @@ public:
      * @brief Sets the function to handle client connections.
      * @param func A function that returns a WebXResult containing a pair of client ID and timestamp.
      */
-    void setClientConnectFunc(std::function<const WebXResult<std::pair<uint32_t, uint64_t>>(const WebXVersion & clientVersion)> func) {
+    void setClientConnectFunc(std::function<const WebXResult<std::pair<uint32_t, WebXClientIndexMask>>(const WebXVersion & clientVersion)> func) {
         this->_clientConnectFunc = func;
     }
 
@@ -114,6 +137,11 @@ private:
      */
     std::function<void(std::shared_ptr<WebXMessage>)> _messagePublisherFunc;
 
+    /**
+     * @brief Function to get the metrics of the message lanes.
+     */
+    std::function<std::vector<WebXMessageLaneMetrics>()> _messageLaneMetricsFunc;
+
     /**
      * @brief Function to handle instructions.
      */
@@ -122,7 +150,7 @@ private:
     /**
      * @brief Function to handle client connections.
      */
-    std::function<const WebXResult<std::pair<uint32_t, uint64_t>>(const WebXVersion & clientVersion)> _clientConnectFunc;
+    std::function<const WebXResult<std::pair<uint32_t, WebXClientIndexMask>>(const WebXVersion & clientVersion)> _clientConnectFunc;
 
     /**
      * @brief Function to handle client disconnections.
@@ -8,6 +8,7 @@ WebXImage::WebXImage(WebXImageType type, unsigned int width, unsigned int height
     _alphaData(0),
     _rawChecksum(0),
     _alphaChecksum(0),
+    _pixelChecksum(0),
     _depth(depth),
     _encodingTimeUs(encodingTimeUs) {
 }
@@ -20,6 +21,7 @@ WebXImage::WebXImage(WebXImageType type, unsigned int width, unsigned int height
     _alphaData(alphaData),
     _rawChecksum(0),
     _alphaChecksum(0),
+    _pixelChecksum(0),
     _depth(depth),
     _encodingTimeUs(encodingTimeUs) {
 }
@@ -100,7 +100,7 @@ public:
      * Returns a pointer to the alpha data buffer.
      */
     unsigned char * getAlphaData() const {
-        return this->_rawData ? this->_alphaData->getBuffer() : NULL;
+        return this->_alphaData ? this->_alphaData->getBuffer() : NULL;
     }
 
     /*
@@ -180,17 +180,17 @@ public:
     }
 
     /*
-     * Removes the alpha data from the image.
-     * 
-     * @return True if the alpha data was removed successfully, false otherwise.
+     * Returns the hash of the raw pixels the image has been encoded from (0 if unknown).
      */
-    bool removeAlpha() {
-        if (this->_alphaData) {
-            delete this->_alphaData;
-            this->_alphaData = NULL;
-            return true;
-        }
-        return false;
+    uint64_t getPixelChecksum() const {
+        return this->_pixelChecksum;
+    }
+
+    /*
+     * Sets the hash of the raw pixels the image has been encoded from.
+     */
+    void setPixelChecksum(uint64_t pixelChecksum) {
+        this->_pixelChecksum = pixelChecksum;
     }
 
 private:
@@ -212,6 +212,7 @@ private:
     WebXDataBuffer * _alphaData;
     uint32_t _rawChecksum;
     uint32_t _alphaChecksum;
+    uint64_t _pixelChecksum;
 
     unsigned int _depth;
 
@@ -0,0 +1,55 @@
+#include "WebXImageEncoderPool.h"
+#include "WebXImage.h"
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+WebXImageEncoderPool::WebXImageEncoderPool(int numberOfWorkers) {
+    for (int i = 0; i < numberOfWorkers; i++) {
+        WebXImageEncoderWorker * worker = new WebXImageEncoderWorker();
+        this->_workers.push_back(std::unique_ptr<WebXImageEncoderWorker>(worker));
+        worker->_thread = new std::thread(&WebXImageEncoderPool::workerLoop, this, worker);
+    }
+    spdlog::info("Started image encoder pool with {:d} workers", numberOfWorkers);
+}
+
+WebXImageEncoderPool::~WebXImageEncoderPool() {
+    this->_jobQueue.stop();
+
+    for (auto & worker : this->_workers) {
+        worker->_thread->join();
+        delete worker->_thread;
+        worker->_thread = NULL;
+    }
+}
+
+std::shared_future<std::shared_ptr<WebXImage>> WebXImageEncoderPool::submit(std::function<std::shared_ptr<WebXImage>()> encodeFunc) {
+    std::shared_ptr<WebXImageEncoderJob> job = std::make_shared<WebXImageEncoderJob>(encodeFunc);
+    std::shared_future<std::shared_ptr<WebXImage>> future = job->get_future().share();
+
+    this->_jobQueue.put(job);
+
+    return future;
+}
+
+std::vector<WebXImageEncoderPool::WebXImageEncoderWorkerMetrics> WebXImageEncoderPool::getWorkerMetrics() const {
+    std::vector<WebXImageEncoderWorkerMetrics> metrics;
+    for (const auto & worker : this->_workers) {
+        metrics.push_back(WebXImageEncoderWorkerMetrics{worker->_jobs.load(), (double)worker->_busyTimeUs.load()});
+    }
+    return metrics;
+}
+
+void WebXImageEncoderPool::workerLoop(WebXImageEncoderWorker * worker) {
+    std::shared_ptr<WebXImageEncoderJob> job;
+    while ((job = this->_jobQueue.get()) != nullptr) {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        (*job)();
+
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::micro> duration = end - start;
+
+        worker->_busyTimeUs += (uint64_t)duration.count();
+        worker->_jobs++;
+    }
+}
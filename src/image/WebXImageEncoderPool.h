@@ -0,0 +1,97 @@
+#ifndef WEBX_IMAGE_ENCODER_POOL_H
+#define WEBX_IMAGE_ENCODER_POOL_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <utils/WebXQueue.h>
+
+class WebXImage;
+
+/**
+ * @class WebXImageEncoderPool
+ * @brief Fixed-size pool of threads used to encode window images in parallel.
+ *
+ * Encoding jobs (typically calls to a WebXImageConverter on grabbed pixels) are queued and executed by the
+ * first available worker. The encoded image is obtained through a shared future. Each worker records the number of
+ * jobs it has executed and the time spent executing them so that its utilisation can be calculated.
+ */
+class WebXImageEncoderPool {
+public:
+    /**
+     * @struct WebXImageEncoderWorkerMetrics
+     * @brief Cumulative metrics of an encoder worker.
+     */
+    struct WebXImageEncoderWorkerMetrics {
+        uint64_t jobs;
+        double busyTimeUs;
+    };
+
+private:
+    typedef std::packaged_task<std::shared_ptr<WebXImage>()> WebXImageEncoderJob;
+
+    /**
+     * @class WebXImageEncoderWorker
+     * @brief Thread executing encoder jobs from the pool queue.
+     */
+    class WebXImageEncoderWorker {
+    public:
+        WebXImageEncoderWorker() :
+            _thread(NULL),
+            _jobs(0),
+            _busyTimeUs(0) {}
+
+        std::thread * _thread;
+        std::atomic<uint64_t> _jobs;
+        std::atomic<uint64_t> _busyTimeUs;
+    };
+
+public:
+    /**
+     * @brief Constructs a WebXImageEncoderPool instance and starts the workers.
+     * @param numberOfWorkers The number of encoder threads.
+     */
+    WebXImageEncoderPool(int numberOfWorkers);
+
+    /**
+     * @brief Destructor. Stops the workers (pending jobs are abandoned).
+     */
+    virtual ~WebXImageEncoderPool();
+
+    /**
+     * @brief Queues an encoding job.
+     * @param encodeFunc The function producing the encoded image.
+     * @return Shared future of the encoded image.
+     */
+    std::shared_future<std::shared_ptr<WebXImage>> submit(std::function<std::shared_ptr<WebXImage>()> encodeFunc);
+
+    /**
+     * @brief Gets the number of workers.
+     * @return The number of workers.
+     */
+    int getNumberOfWorkers() const {
+        return this->_workers.size();
+    }
+
+    /**
+     * @brief Gets the cumulative metrics of all the workers.
+     * @return The number of jobs and busy time of each worker.
+     */
+    std::vector<WebXImageEncoderWorkerMetrics> getWorkerMetrics() const;
+
+private:
+    /**
+     * @brief Main loop of a worker: executes jobs until the queue is stopped.
+     * @param worker The worker executing the loop.
+     */
+    void workerLoop(WebXImageEncoderWorker * worker);
+
+private:
+    std::vector<std::unique_ptr<WebXImageEncoderWorker>> _workers;
+    WebXQueue<std::shared_ptr<WebXImageEncoderJob>> _jobQueue;
+};
+
+#endif /* WEBX_IMAGE_ENCODER_POOL_H */
@@ -1,12 +1,154 @@
 #include "WebXJPGImageConverter.h"
 #include "WebXImage.h"
 #include <utils/WebXImageUtils.h>
+#include <utils/WebXDataBufferPool.h>
 #include <jpeglib.h>
+#include <jerror.h>
 #include <cstring>
+#include <vector>
 #include <chrono>
 #include <spdlog/spdlog.h>
 
-WebXJPGImageConverter::WebXJPGImageConverter() {
+namespace {
+
+/*
+ * libjpeg destination manager writing the compressed data into a block of the buffer pool
+ */
+struct WebXJPGDestination {
+    struct jpeg_destination_mgr manager;
+    WebXDataBufferPool * pool;
+    unsigned char * block;
+    size_t capacity;
+};
+
+void initDestination(j_compress_ptr cinfo) {
+    WebXJPGDestination * destination = (WebXJPGDestination *)cinfo->dest;
+    destination->manager.next_output_byte = destination->block;
+    destination->manager.free_in_buffer = destination->capacity;
+}
+
+boolean emptyOutputBuffer(j_compress_ptr cinfo) {
+    // Only called if the worst-case size has been exceeded (the full block is used): move to a larger block
+    WebXJPGDestination * destination = (WebXJPGDestination *)cinfo->dest;
+    size_t capacity;
+    unsigned char * block = destination->pool->acquire(destination->capacity * 2, capacity);
+    if (block == NULL) {
+        ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 10);
+    }
+
+    memcpy(block, destination->block, destination->capacity);
+    destination->pool->release(destination->block, destination->capacity);
+
+    destination->manager.next_output_byte = block + destination->capacity;
+    destination->manager.free_in_buffer = capacity - destination->capacity;
+    destination->block = block;
+    destination->capacity = capacity;
+
+    return TRUE;
+}
+
+void termDestination(j_compress_ptr cinfo) {
+}
+
+/*
+ * libjpeg compressor reused for all the images encoded by a thread
+ */
+class WebXJPGCompressor {
+public:
+    WebXJPGCompressor() {
+        this->_cinfo.err = jpeg_std_error(&this->_jerr);
+        jpeg_create_compress(&this->_cinfo);
+
+        this->_destination.manager.init_destination = initDestination;
+        this->_destination.manager.empty_output_buffer = emptyOutputBuffer;
+        this->_destination.manager.term_destination = termDestination;
+        this->_destination.pool = NULL;
+        this->_destination.block = NULL;
+        this->_destination.capacity = 0;
+        this->_cinfo.dest = &this->_destination.manager;
+    }
+
+    ~WebXJPGCompressor() {
+        jpeg_destroy_compress(&this->_cinfo);
+    }
+
+    WebXDataBuffer * compress(unsigned char * data, int width, int height, int bytesPerLine, int components, J_COLOR_SPACE colorSpace, float quality, const std::shared_ptr<WebXDataBufferPool> & pool) {
+        this->_cinfo.image_width = width;
+        this->_cinfo.image_height = height;
+        this->_cinfo.input_components = components;
+        this->_cinfo.in_color_space = colorSpace;
+
+        jpeg_set_defaults(&this->_cinfo);
+
+        this->_cinfo.dct_method = JDCT_IFAST;
+
+        // Max quality of 0.97
+        quality = quality < 0.0 ? 0.0 : quality > 0.97 ? 0.97 : quality;
+        jpeg_set_quality(&this->_cinfo, quality * 100, TRUE);
+
+        // Worst-case size of the JPEG data (same bound as tjBufSize: 4:2:0 MCUs of 16x16 pixels or 8x8 for grayscale)
+        size_t mcuSize = colorSpace == JCS_GRAYSCALE ? 8 : 16;
+        size_t bytesPerPixel = colorSpace == JCS_GRAYSCALE ? 2 : 3;
+        size_t paddedWidth = (width + mcuSize - 1) / mcuSize * mcuSize;
+        size_t paddedHeight = (height + mcuSize - 1) / mcuSize * mcuSize;
+        size_t maxSize = paddedWidth * paddedHeight * bytesPerPixel + 2048;
+
+        this->_destination.pool = pool.get();
+        this->_destination.block = pool->acquire(maxSize, this->_destination.capacity);
+        if (this->_destination.block == NULL) {
+            return new WebXDataBuffer();
+        }
+
+        if (this->_rowPointers.size() < (size_t)height) {
+            this->_rowPointers.resize(height);
+        }
+        for (int i = 0; i < height; i++) {
+            this->_rowPointers[i] = (JSAMPROW)&data[i * bytesPerLine];
+        }
+
+        jpeg_start_compress(&this->_cinfo, TRUE);
+        while (this->_cinfo.next_scanline < this->_cinfo.image_height) {
+            jpeg_write_scanlines(&this->_cinfo, &this->_rowPointers[this->_cinfo.next_scanline], this->_cinfo.image_height - this->_cinfo.next_scanline);
+        }
+        jpeg_finish_compress(&this->_cinfo);
+
+        unsigned char * block = this->_destination.block;
+        size_t capacity = this->_destination.capacity;
+        size_t size = capacity - this->_destination.manager.free_in_buffer;
+        this->_destination.block = NULL;
+
+        // Don't keep a worst-case block for data that is much smaller (it stays allocated until the image is sent): move
+        // the data to a smaller block so that the large one can be reused immediately
+        if (size <= capacity / 4) {
+            size_t smallCapacity;
+            unsigned char * smallBlock = pool->acquire(size, smallCapacity);
+            if (smallBlock != NULL) {
+                memcpy(smallBlock, block, size);
+                pool->release(block, capacity);
+                block = smallBlock;
+                capacity = smallCapacity;
+            }
+        }
+
+        return pool->createBuffer(block, capacity, size);
+    }
+
+private:
+    struct jpeg_compress_struct _cinfo;
+    struct jpeg_error_mgr _jerr;
+    WebXJPGDestination _destination;
+    std::vector<JSAMPROW> _rowPointers;
+};
+
+WebXJPGCompressor & getThreadCompressor() {
+    thread_local WebXJPGCompressor compressor;
+    return compressor;
+}
+
+}
+
+WebXJPGImageConverter::WebXJPGImageConverter() :
+    _bufferPool(std::make_shared<WebXDataBufferPool>(BUFFER_POOL_MAX_FREE_BYTES)) {
 }
 
 WebXJPGImageConverter::~WebXJPGImageConverter() {
@@ -68,89 +210,9 @@ WebXImage * WebXJPGImageConverter::convertMono(XImage * image, const WebXQuality
 }
 
 WebXDataBuffer * WebXJPGImageConverter::_convert(unsigned char * data, int width, int height, int bytesPerLine, float quality) const {
-
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
-    
-    unsigned char * jpegData = 0;
-    unsigned long jpegDataSize = 0;
-
-    jpeg_mem_dest(&cinfo, &jpegData, &jpegDataSize);
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-    cinfo.input_components = 4;
-    cinfo.in_color_space = JCS_EXT_BGRA;
-    
-    jpeg_set_defaults(&cinfo);
-
-	cinfo.dct_method = JDCT_IFAST;
-
-    // Max quality of 0.97
-    quality = quality < 0.0 ? 0.0 : quality > 0.97 ? 0.97 : quality;
-    jpeg_set_quality(&cinfo, quality * 100, TRUE);
-
-    JSAMPROW * row_pointer = (JSAMPROW *)malloc(sizeof(JSAMPROW) * height);
-    for (int i = 0; i < height; i++) {
-        row_pointer[i] = (JSAMPROW)&data[i * bytesPerLine];
-    }
-
-    jpeg_start_compress(&cinfo, TRUE);
-    while (cinfo.next_scanline < cinfo.image_height) {
-        jpeg_write_scanlines(&cinfo, &row_pointer[cinfo.next_scanline], cinfo.image_height - cinfo.next_scanline);
-    }
-    jpeg_finish_compress(&cinfo);
-
-    jpeg_destroy_compress(&cinfo);
-
-    free(row_pointer);
-
-    WebXDataBuffer * rawData = new WebXDataBuffer(jpegData, jpegDataSize);
-    return rawData;
+    return getThreadCompressor().compress(data, width, height, bytesPerLine, 4, JCS_EXT_BGRA, quality, this->_bufferPool);
 }
 
 WebXDataBuffer * WebXJPGImageConverter::_convertMono(unsigned char * data, int width, int height, int bytesPerLine, float quality) const {
-
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
-    
-    unsigned char * jpegData = 0;
-    unsigned long jpegDataSize = 0;
-
-    jpeg_mem_dest(&cinfo, &jpegData, &jpegDataSize);
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-    cinfo.input_components = 1;
-    cinfo.in_color_space = JCS_GRAYSCALE;
-    
-    jpeg_set_defaults(&cinfo);
-
-	cinfo.dct_method = JDCT_IFAST;
-
-    // Max quality of 0.97
-    quality = quality < 0.0 ? 0.0 : quality > 0.97 ? 0.97 : quality;
-    jpeg_set_quality(&cinfo, quality * 100, TRUE);
-
-    JSAMPROW * row_pointer = (JSAMPROW *)malloc(sizeof(JSAMPROW) * height);
-    for (int i = 0; i < height; i++) {
-        row_pointer[i] = (JSAMPROW)&data[i * bytesPerLine];
-    }
-
-    jpeg_start_compress(&cinfo, TRUE);
-    while (cinfo.next_scanline < cinfo.image_height) {
-        jpeg_write_scanlines(&cinfo, &row_pointer[cinfo.next_scanline], cinfo.image_height - cinfo.next_scanline);
-    }
-    jpeg_finish_compress(&cinfo);
-
-    jpeg_destroy_compress(&cinfo);
-
-    free(row_pointer);
-
-    WebXDataBuffer * rawData = new WebXDataBuffer(jpegData, jpegDataSize);
-    return rawData;
+    return getThreadCompressor().compress(data, width, height, bytesPerLine, 1, JCS_GRAYSCALE, quality, this->_bufferPool);
 }
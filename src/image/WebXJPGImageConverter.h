@@ -3,9 +3,11 @@
 
 #include "WebXImageConverter.h"
 #include <stdlib.h>
+#include <memory>
 
 class WebXImage;
 class WebXDataBuffer;
+class WebXDataBufferPool;
 
 /**
  * @class WebXJPGImageConverter
@@ -13,6 +15,9 @@ class WebXDataBuffer;
  * 
  * This class provides methods to convert raw image data into JPEG format
  * using the libjpeg-turbo library. It supports both color and alpha channel conversions.
+ *
+ * Each encoding thread keeps its own libjpeg compressor (created on first use) and the compressed data is written
+ * directly into blocks recycled through a buffer pool, sized from the worst-case JPEG size of the image.
  */
 class WebXJPGImageConverter : public WebXImageConverter {
 public:
@@ -81,6 +86,11 @@ private:
      * @return A pointer to the WebXDataBuffer containing the JPEG data.
      */
     WebXDataBuffer * _convertMono(unsigned char * data, int width, int height, int bytesPerLine, float quality) const;
+
+private:
+    const static size_t BUFFER_POOL_MAX_FREE_BYTES = 32 * 1024 * 1024;
+
+    std::shared_ptr<WebXDataBufferPool> _bufferPool;
 };
 
 #endif /* WEBX_JPG_IMAGE_CONVERTER_H */
\ No newline at end of file
@@ -0,0 +1,176 @@
+#ifndef WEBX_CLIENT_INDEX_MASK_H
+#define WEBX_CLIENT_INDEX_MASK_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class WebXClientIndexMask
+ * @brief Variable-length bitmap of the clients to which a message is addressed.
+ *
+ * Each client has a position in the bitmap: the first 64 positions form the first word, the 64-bit client index
+ * mask of the message header understood by all routers. The words after the last stored word all have the same
+ * fill value (all bits set or none) so that "all clients" and "all clients except one" do not depend on the number
+ * of connected clients.
+ */
+class WebXClientIndexMask {
+public:
+    const static size_t BITS_PER_WORD = 64;
+
+    /**
+     * @brief Constructs an empty mask (no clients).
+     */
+    WebXClientIndexMask() :
+        _fill(0) {}
+
+    /**
+     * @brief Constructs a mask from a 64-bit client index mask (only the first 64 positions).
+     * @param mask The client index mask.
+     */
+    explicit WebXClientIndexMask(uint64_t mask) :
+        _words(1, mask),
+        _fill(0) {
+        this->normalize();
+    }
+
+    virtual ~WebXClientIndexMask() {}
+
+    /**
+     * @brief Creates a mask containing all the clients.
+     * @return The mask.
+     */
+    static WebXClientIndexMask All() {
+        WebXClientIndexMask mask;
+        mask._fill = ~(uint64_t)0;
+        return mask;
+    }
+
+    /**
+     * @brief Creates a mask containing a single client.
+     * @param position The position of the client in the bitmap.
+     * @return The mask.
+     */
+    static WebXClientIndexMask ForPosition(size_t position) {
+        WebXClientIndexMask mask;
+        mask.set(position);
+        return mask;
+    }
+
+    /**
+     * @brief Gets a 64-bit word of the bitmap.
+     * @param wordIndex The index of the word (0 for the first 64 positions).
+     * @return The word.
+     */
+    uint64_t getWord(size_t wordIndex) const {
+        return wordIndex < this->_words.size() ? this->_words[wordIndex] : this->_fill;
+    }
+
+    /**
+     * @brief Gets the number of words that differ from the fill value (at least 1).
+     * @return The number of significant words.
+     */
+    size_t getNumberOfWords() const {
+        return this->_words.empty() ? 1 : this->_words.size();
+    }
+
+    /**
+     * @brief Determines if a position is set.
+     * @param position The position of the client.
+     * @return True if the client is in the mask.
+     */
+    bool test(size_t position) const {
+        return (this->getWord(position / BITS_PER_WORD) & ((uint64_t)1 << (position % BITS_PER_WORD))) != 0;
+    }
+
+    /**
+     * @brief Adds a client to the mask.
+     * @param position The position of the client.
+     */
+    void set(size_t position) {
+        this->expand(position / BITS_PER_WORD + 1);
+        this->_words[position / BITS_PER_WORD] |= (uint64_t)1 << (position % BITS_PER_WORD);
+        this->normalize();
+    }
+
+    /**
+     * @brief Removes a client from the mask.
+     * @param position The position of the client.
+     */
+    void reset(size_t position) {
+        this->expand(position / BITS_PER_WORD + 1);
+        this->_words[position / BITS_PER_WORD] &= ~((uint64_t)1 << (position % BITS_PER_WORD));
+        this->normalize();
+    }
+
+    /**
+     * @brief Determines if the mask contains no clients.
+     * @return True if no position is set.
+     */
+    bool isEmpty() const {
+        return this->_fill == 0 && this->_words.empty();
+    }
+
+    WebXClientIndexMask operator~() const {
+        WebXClientIndexMask mask;
+        mask._fill = ~this->_fill;
+        for (uint64_t word : this->_words) {
+            mask._words.push_back(~word);
+        }
+        return mask;
+    }
+
+    WebXClientIndexMask & operator|=(const WebXClientIndexMask & mask) {
+        this->expand(mask._words.size());
+        for (size_t i = 0; i < this->_words.size(); i++) {
+            this->_words[i] |= mask.getWord(i);
+        }
+        this->_fill |= mask._fill;
+        this->normalize();
+        return *this;
+    }
+
+    WebXClientIndexMask & operator&=(const WebXClientIndexMask & mask) {
+        this->expand(mask._words.size());
+        for (size_t i = 0; i < this->_words.size(); i++) {
+            this->_words[i] &= mask.getWord(i);
+        }
+        this->_fill &= mask._fill;
+        this->normalize();
+        return *this;
+    }
+
+    bool operator==(const WebXClientIndexMask & mask) const {
+        return this->_fill == mask._fill && this->_words == mask._words;
+    }
+
+    bool operator!=(const WebXClientIndexMask & mask) const {
+        return !operator==(mask);
+    }
+
+private:
+    /**
+     * @brief Stores at least a number of words (the added words have the fill value).
+     * @param numberOfWords The number of words.
+     */
+    void expand(size_t numberOfWords) {
+        if (this->_words.size() < numberOfWords) {
+            this->_words.resize(numberOfWords, this->_fill);
+        }
+    }
+
+    /**
+     * @brief Removes the trailing words equal to the fill value (a mask has a single representation).
+     */
+    void normalize() {
+        while (!this->_words.empty() && this->_words.back() == this->_fill) {
+            this->_words.pop_back();
+        }
+    }
+
+private:
+    std::vector<uint64_t> _words;
+    uint64_t _fill;
+};
+
+#endif /* WEBX_CLIENT_INDEX_MASK_H */
@@ -0,0 +1,22 @@
+#ifndef WEBX_MESSAGE_LANE_METRICS_H
+#define WEBX_MESSAGE_LANE_METRICS_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @struct WebXMessageLaneMetrics
+ * @brief Metrics of a lane of the client message publisher queue: current depth and cumulative counters (the dropped
+ * messages have been superseded by newer ones before being sent).
+ */
+struct WebXMessageLaneMetrics {
+    std::string name;
+    size_t depth;
+    uint64_t messages;
+    uint64_t waitTimeUs;
+    uint64_t droppedMessages;
+    uint64_t droppedBytes;
+};
+
+#endif /* WEBX_MESSAGE_LANE_METRICS_H */
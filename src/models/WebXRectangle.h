@@ -127,6 +127,14 @@ public:
             this->_bottom <= rectangle._bottom);
     }
 
+    bool contains(int x, int y) const {
+        return (
+            x >= this->_left &&
+            x < this->_right &&
+            y >= this->_bottom &&
+            y < this->_top);
+    }
+
     int area() const {
         return this->_size.area();
     }
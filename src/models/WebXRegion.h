@@ -0,0 +1,406 @@
+#ifndef WEBX_REGION_H
+#define WEBX_REGION_H
+
+#include <vector>
+#include <algorithm>
+#include "WebXRectangle.h"
+
+/**
+ * @class WebXRegion
+ * @brief Represents an arbitrary area as a set of non-overlapping rectangles, stored in y-bands.
+ *
+ * Each band covers a range of rows and contains a sorted list of disjoint horizontal spans (the same for every row of the
+ * band). Bands are sorted, do not overlap and adjacent bands with identical spans are coalesced: the representation of
+ * an area is unique. Unions, intersections and subtractions are calculated band by band in linear time.
+ */
+class WebXRegion {
+private:
+    struct Span {
+        int x1;
+        int x2;
+
+        bool operator==(const Span & span) const {
+            return this->x1 == span.x1 && this->x2 == span.x2;
+        }
+    };
+
+    struct Band {
+        int y1;
+        int y2;
+        std::vector<Span> spans;
+    };
+
+    enum Operation {
+        Union = 0,
+        Intersection,
+        Subtraction,
+    };
+
+public:
+    /**
+     * @brief Constructs an empty region.
+     */
+    WebXRegion() {}
+
+    /**
+     * @brief Constructs a region covering a rectangle.
+     * @param rectangle The rectangle (the region is empty if it has no area).
+     */
+    WebXRegion(const WebXRectangle & rectangle) {
+        if (rectangle.size().width() > 0 && rectangle.size().height() > 0) {
+            this->_bands.push_back(Band{rectangle.y(), rectangle.y() + rectangle.size().height(), {Span{rectangle.x(), rectangle.x() + rectangle.size().width()}}});
+        }
+    }
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~WebXRegion() {}
+
+    /**
+     * @brief Adds a region to this one.
+     * @param region The region to add.
+     * @return A reference to the updated region.
+     */
+    WebXRegion & operator+=(const WebXRegion & region) {
+        if (this->_bands.empty()) {
+            this->_bands = region._bands;
+
+        } else if (!region._bands.empty()) {
+            this->_bands = WebXRegion::Combine(this->_bands, region._bands, Union);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Removes a region from this one.
+     * @param region The region to remove.
+     * @return A reference to the updated region.
+     */
+    WebXRegion & operator-=(const WebXRegion & region) {
+        if (!this->_bands.empty() && !region._bands.empty()) {
+            this->_bands = WebXRegion::Combine(this->_bands, region._bands, Subtraction);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Keeps only the part of this region that is also covered by another one.
+     * @param region The region to intersect with.
+     * @return A reference to the updated region.
+     */
+    WebXRegion & operator&=(const WebXRegion & region) {
+        if (region._bands.empty()) {
+            this->_bands.clear();
+
+        } else if (!this->_bands.empty()) {
+            this->_bands = WebXRegion::Combine(this->_bands, region._bands, Intersection);
+        }
+        return *this;
+    }
+
+    bool operator==(const WebXRegion & region) const {
+        if (this->_bands.size() != region._bands.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < this->_bands.size(); i++) {
+            const Band & band = this->_bands[i];
+            const Band & otherBand = region._bands[i];
+            if (band.y1 != otherBand.y1 || band.y2 != otherBand.y2 || band.spans != otherBand.spans) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const WebXRegion & region) const {
+        return !operator==(region);
+    }
+
+    /**
+     * @brief Checks if the region covers no pixels.
+     * @return True if the region is empty.
+     */
+    bool isEmpty() const {
+        return this->_bands.empty();
+    }
+
+    /**
+     * @brief Empties the region.
+     */
+    void clear() {
+        this->_bands.clear();
+    }
+
+    /**
+     * @brief Moves the region.
+     * @param dx The horizontal offset.
+     * @param dy The vertical offset.
+     */
+    void translate(int dx, int dy) {
+        for (Band & band : this->_bands) {
+            band.y1 += dy;
+            band.y2 += dy;
+            for (Span & span : band.spans) {
+                span.x1 += dx;
+                span.x2 += dx;
+            }
+        }
+    }
+
+    /**
+     * @brief Checks if a pixel is inside the region.
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return True if the pixel is covered by the region.
+     */
+    bool contains(int x, int y) const {
+        auto bandIt = std::upper_bound(this->_bands.begin(), this->_bands.end(), y, [](int value, const Band & band) { return value < band.y2; });
+        if (bandIt == this->_bands.end() || bandIt->y1 > y) {
+            return false;
+        }
+        auto spanIt = std::upper_bound(bandIt->spans.begin(), bandIt->spans.end(), x, [](int value, const Span & span) { return value < span.x2; });
+        return spanIt != bandIt->spans.end() && spanIt->x1 <= x;
+    }
+
+    /**
+     * @brief Calculates the number of pixels covered by the region.
+     * @return The area of the region.
+     */
+    int area() const {
+        int area = 0;
+        for (const Band & band : this->_bands) {
+            for (const Span & span : band.spans) {
+                area += (span.x2 - span.x1) * (band.y2 - band.y1);
+            }
+        }
+        return area;
+    }
+
+    /**
+     * @brief Calculates the bounding box of the region.
+     * @return The smallest rectangle containing the region (empty if the region is empty).
+     */
+    WebXRectangle getExtents() const {
+        if (this->_bands.empty()) {
+            return WebXRectangle();
+        }
+
+        int x1 = this->_bands.front().spans.front().x1;
+        int x2 = this->_bands.front().spans.back().x2;
+        for (const Band & band : this->_bands) {
+            x1 = std::min(x1, band.spans.front().x1);
+            x2 = std::max(x2, band.spans.back().x2);
+        }
+        int y1 = this->_bands.front().y1;
+        int y2 = this->_bands.back().y2;
+        return WebXRectangle(x1, y1, x2 - x1, y2 - y1);
+    }
+
+    /**
+     * @brief Gets the number of rectangles of the banded representation of the region.
+     * @return The number of rectangles.
+     */
+    size_t getNumberOfRectangles() const {
+        size_t numberOfRectangles = 0;
+        for (const Band & band : this->_bands) {
+            numberOfRectangles += band.spans.size();
+        }
+        return numberOfRectangles;
+    }
+
+    /**
+     * @brief Gets the non-overlapping rectangles of the banded representation of the region, sorted by row then column.
+     * @return The rectangles covering exactly the region.
+     */
+    std::vector<WebXRectangle> getRectangles() const {
+        std::vector<WebXRectangle> rectangles;
+        rectangles.reserve(this->getNumberOfRectangles());
+        for (const Band & band : this->_bands) {
+            for (const Span & span : band.spans) {
+                rectangles.push_back(WebXRectangle(span.x1, band.y1, span.x2 - span.x1, band.y2 - band.y1));
+            }
+        }
+        return rectangles;
+    }
+
+    /**
+     * @brief Calculates a small set of rectangles covering the region at the lowest estimated encoding cost.
+     *
+     * Every sub image costs its area in pixels plus a fixed overhead (encoder setup, image headers and message metadata).
+     * Starting from the banded rectangles, the two rectangles whose bounding box saves the most cost are merged until no
+     * merge reduces the total cost: close fragments become one image while distant ones are kept apart to avoid sending
+     * the pixels between them. Rectangles are first merged pairwise (in band order) while there are more than maxRectangles.
+     * @param imageOverheadPixels The fixed cost of an image expressed as a number of pixels.
+     * @param maxRectangles The maximum number of rectangles evaluated by the cost-based merging.
+     * @return The rectangles covering (at least) the region.
+     */
+    std::vector<WebXRectangle> simplify(int imageOverheadPixels, size_t maxRectangles) const {
+        std::vector<WebXRectangle> rectangles = this->getRectangles();
+
+        // Bound the quadratic search by merging neighbours
+        while (rectangles.size() > std::max(maxRectangles, (size_t)1)) {
+            std::vector<WebXRectangle> mergedRectangles;
+            mergedRectangles.reserve((rectangles.size() + 1) / 2);
+            for (size_t i = 0; i < rectangles.size(); i += 2) {
+                mergedRectangles.push_back(rectangles[i]);
+                if (i + 1 < rectangles.size()) {
+                    mergedRectangles.back() += rectangles[i + 1];
+                }
+            }
+            rectangles.swap(mergedRectangles);
+        }
+
+        while (rectangles.size() > 1) {
+            int bestSaving = 0;
+            size_t bestI = 0;
+            size_t bestJ = 0;
+            for (size_t i = 0; i < rectangles.size(); i++) {
+                for (size_t j = i + 1; j < rectangles.size(); j++) {
+                    WebXRectangle bounds = rectangles[i];
+                    bounds += rectangles[j];
+                    int saving = rectangles[i].area() + rectangles[j].area() - WebXRegion::IntersectionArea(rectangles[i], rectangles[j]) + imageOverheadPixels - bounds.area();
+                    if (saving > bestSaving) {
+                        bestSaving = saving;
+                        bestI = i;
+                        bestJ = j;
+                    }
+                }
+            }
+
+            if (bestSaving <= 0) {
+                break;
+            }
+
+            // Replace the pair by its bounding box and remove the rectangles it now contains
+            WebXRectangle bounds = rectangles[bestI];
+            bounds += rectangles[bestJ];
+            rectangles.erase(std::remove_if(rectangles.begin(), rectangles.end(), [&bounds](const WebXRectangle & rectangle) {
+                return bounds.contains(rectangle);
+            }), rectangles.end());
+            rectangles.push_back(bounds);
+        }
+
+        return rectangles;
+    }
+
+private:
+    /**
+     * @brief Calculates the area common to two rectangles.
+     * @param rectangle1 The first rectangle.
+     * @param rectangle2 The second rectangle.
+     * @return The area of the intersection.
+     */
+    static int IntersectionArea(const WebXRectangle & rectangle1, const WebXRectangle & rectangle2) {
+        int width = std::min(rectangle1.right(), rectangle2.right()) - std::max(rectangle1.left(), rectangle2.left());
+        int height = std::min(rectangle1.top(), rectangle2.top()) - std::max(rectangle1.bottom(), rectangle2.bottom());
+        return width > 0 && height > 0 ? width * height : 0;
+    }
+
+    /**
+     * @brief Applies an operation to the bands of two regions. The rows are split at every band boundary of both
+     * regions so that each resulting row range is either inside or outside of any band.
+     * @param bands1 The bands of the first region.
+     * @param bands2 The bands of the second region.
+     * @param operation The operation to apply.
+     * @return The (coalesced) bands of the result.
+     */
+    static std::vector<Band> Combine(const std::vector<Band> & bands1, const std::vector<Band> & bands2, Operation operation) {
+        std::vector<int> rows;
+        rows.reserve(2 * (bands1.size() + bands2.size()));
+        for (const Band & band : bands1) {
+            rows.push_back(band.y1);
+            rows.push_back(band.y2);
+        }
+        size_t middle = rows.size();
+        for (const Band & band : bands2) {
+            rows.push_back(band.y1);
+            rows.push_back(band.y2);
+        }
+        std::inplace_merge(rows.begin(), rows.begin() + middle, rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+        static const std::vector<Span> noSpans;
+        std::vector<Band> bands;
+        size_t index1 = 0;
+        size_t index2 = 0;
+        for (size_t i = 0; i + 1 < rows.size(); i++) {
+            int y1 = rows[i];
+            int y2 = rows[i + 1];
+
+            while (index1 < bands1.size() && bands1[index1].y2 <= y1) {
+                index1++;
+            }
+            while (index2 < bands2.size() && bands2[index2].y2 <= y1) {
+                index2++;
+            }
+            const std::vector<Span> & spans1 = index1 < bands1.size() && bands1[index1].y1 <= y1 ? bands1[index1].spans : noSpans;
+            const std::vector<Span> & spans2 = index2 < bands2.size() && bands2[index2].y1 <= y1 ? bands2[index2].spans : noSpans;
+
+            std::vector<Span> spans = WebXRegion::CombineSpans(spans1, spans2, operation);
+            if (spans.empty()) {
+                continue;
+            }
+
+            // Coalesce with the previous band if it is adjacent and identical
+            if (!bands.empty() && bands.back().y2 == y1 && bands.back().spans == spans) {
+                bands.back().y2 = y2;
+
+            } else {
+                bands.push_back(Band{y1, y2, std::move(spans)});
+            }
+        }
+
+        return bands;
+    }
+
+    /**
+     * @brief Applies an operation to two sorted lists of disjoint spans.
+     * @param spans1 The spans of the first region.
+     * @param spans2 The spans of the second region.
+     * @param operation The operation to apply.
+     * @return The sorted, disjoint and non-touching spans of the result.
+     */
+    static std::vector<Span> CombineSpans(const std::vector<Span> & spans1, const std::vector<Span> & spans2, Operation operation) {
+        std::vector<Span> spans;
+        if ((spans1.empty() && spans2.empty()) || (operation == Intersection && (spans1.empty() || spans2.empty())) || (operation == Subtraction && spans1.empty())) {
+            return spans;
+        }
+
+        size_t index1 = 0;
+        size_t index2 = 0;
+        int x = std::min(spans1.empty() ? spans2.front().x1 : spans1.front().x1, spans2.empty() ? spans1.front().x1 : spans2.front().x1);
+        while (index1 < spans1.size() || index2 < spans2.size()) {
+            // Determine the coverage at x and the next position where it changes
+            bool inside1 = index1 < spans1.size() && spans1[index1].x1 <= x;
+            bool inside2 = index2 < spans2.size() && spans2[index2].x1 <= x;
+            int next1 = index1 < spans1.size() ? (inside1 ? spans1[index1].x2 : spans1[index1].x1) : x;
+            int next2 = index2 < spans2.size() ? (inside2 ? spans2[index2].x2 : spans2[index2].x1) : x;
+            int next = index1 >= spans1.size() ? next2 : index2 >= spans2.size() ? next1 : std::min(next1, next2);
+
+            bool inside = operation == Union ? inside1 || inside2 : operation == Intersection ? inside1 && inside2 : inside1 && !inside2;
+            if (inside) {
+                if (!spans.empty() && spans.back().x2 == x) {
+                    spans.back().x2 = next;
+                } else {
+                    spans.push_back(Span{x, next});
+                }
+            }
+
+            x = next;
+            if (index1 < spans1.size() && spans1[index1].x2 <= x) {
+                index1++;
+            }
+            if (index2 < spans2.size() && spans2[index2].x2 <= x) {
+                index2++;
+            }
+        }
+
+        return spans;
+    }
+
+private:
+    std::vector<Band> _bands;
+};
+
+#endif /* WEBX_REGION_H */
@@ -3,6 +3,7 @@
 
 #include <cstdlib>
 #include <string>
+#include <thread>
 #include <spdlog/spdlog.h>
 #include <models/WebXQuality.h>
 
@@ -115,7 +116,9 @@ public:
         ipcSessionConnectorPath(webx_settings_env_or_default("WEBX_ENGINE_IPC_SESSION_CONNECTOR_PATH", "/tmp/webx-engine-session-connector.ipc")),
         inprocEventBusAddress(webx_settings_env_or_default("WEBX_ENGINE_INPROC_EVENT_BUS_ADDRESS", "inproc://webx-engine/event-bus")),
         sessionId(convertSessionIdStringToBytes(webx_settings_env_or_default("WEBX_ENGINE_SESSION_ID", "00000000000000000000000000000000"))),
-        sessionIdString(webx_settings_env_or_default("WEBX_ENGINE_SESSION_ID", "00000000000000000000000000000000")) {
+        sessionIdString(webx_settings_env_or_default("WEBX_ENGINE_SESSION_ID", "00000000000000000000000000000000")),
+        multipartImageMessages(webx_settings_env_or_default("WEBX_ENGINE_MULTIPART_IMAGE_MESSAGES", false)),
+        maxClients(webx_settings_env_or_default("WEBX_ENGINE_MAX_CLIENTS", 64)) {
     }
 
     /* 
@@ -150,11 +153,19 @@ public:
 
     const std::array<unsigned char, 16> sessionId;
     const std::string sessionIdString;
+
+    // Image data is sent without copy in separate frames of a multipart message (the concatenated frames have the
+    // layout of the single-frame message: the router must support multipart messages)
+    const bool multipartImageMessages;
+
+    // Clients beyond the first 64 are addressed with a recipient bitmap sent in an additional frame after each message
+    // (extended client addressing: the router must support it)
+    const int maxClients;
 };
 
 /**
  * Class to manage controller-related settings for WebX.
- * Includes configuration for image checksum verification.
+ * Includes configuration for image checksum verification, the tile-based shadow framebuffers and the window refresh budget.
  */
 class WebXControllerSettings {
 public:
@@ -163,10 +174,26 @@ public:
      */
     WebXControllerSettings(bool defaultImageCheckumEnabled) : 
         imageChecksumEnabled(webx_settings_env_or_default("WEBX_ENGINE_IMAGE_CHECKSUM_ENABLED", defaultImageCheckumEnabled)),
-        clientPingResponseTimeoutMs(webx_settings_env_or_default("WEBX_ENGINE_CLIENT_PING_RESPONSE_TIMEOUT_MS", 15000)) {}
+        clientPingResponseTimeoutMs(webx_settings_env_or_default("WEBX_ENGINE_CLIENT_PING_RESPONSE_TIMEOUT_MS", 15000)),
+        shadowFramebufferEnabled(webx_settings_env_or_default("WEBX_ENGINE_SHADOW_FRAMEBUFFER_ENABLED", false)),
+        shadowFramebufferTileSize(webx_settings_env_or_default("WEBX_ENGINE_SHADOW_FRAMEBUFFER_TILE_SIZE", 64)),
+        shadowFramebufferMaxMemoryKB(webx_settings_env_or_default("WEBX_ENGINE_SHADOW_FRAMEBUFFER_MAX_MEMORY_KB", 1024)),
+        windowRefreshBudgetMs(webx_settings_env_or_default("WEBX_ENGINE_WINDOW_REFRESH_BUDGET_MS", 25)),
+        windowRefreshMaxDeferrals(webx_settings_env_or_default("WEBX_ENGINE_WINDOW_REFRESH_MAX_DEFERRALS", 4)),
+        overloadTickBudgetMs(webx_settings_env_or_default("WEBX_ENGINE_OVERLOAD_TICK_BUDGET_MS", 40)),
+        overloadMaxQueueDepth(webx_settings_env_or_default("WEBX_ENGINE_OVERLOAD_MAX_QUEUE_DEPTH", 64)),
+        overloadRecoveryTimeMs(webx_settings_env_or_default("WEBX_ENGINE_OVERLOAD_RECOVERY_TIME_MS", 5000)) {}
 
     const bool imageChecksumEnabled;
     const int clientPingResponseTimeoutMs;
+    const bool shadowFramebufferEnabled;
+    const int shadowFramebufferTileSize;
+    const int shadowFramebufferMaxMemoryKB;
+    const int windowRefreshBudgetMs;
+    const int windowRefreshMaxDeferrals;
+    const int overloadTickBudgetMs;
+    const int overloadMaxQueueDepth;
+    const int overloadRecoveryTimeMs;
 };
 
 /**
@@ -184,6 +211,62 @@ public:
     const bool filterDamageAfterConfigureNotify;
 };
 
+/**
+ * Class to manage display-related settings for WebX.
+ * Includes configuration for the window capture mode, raw pixel change detection, image encoding threads, X11 requests, damage reporting
+ * and window layout updates.
+ */
+class WebXDisplaySettings {
+public:
+    /* 
+     * Enum to define how the X server reports window damage.
+     */
+    enum DamageReportMode {
+        RawRectangles = 0,  /* An event for each damaged rectangle (XDamageReportRawRectangles) */
+        Region,             /* An event when the damage becomes non-empty, the damaged region being fetched once per update (XDamageReportNonEmpty) */
+    };
+
+public:
+    /* 
+     * Constructor initializes settings from environment variables or defaults.
+     */
+    WebXDisplaySettings() : 
+        shmCaptureEnabled(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_SHM_CAPTURE_ENABLED", true)),
+        pixelChecksumEnabled(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_PIXEL_CHECKSUM_ENABLED", true)),
+        encoderThreads(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_ENCODER_THREADS", defaultEncoderThreads())),
+        asyncRequestsEnabled(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_ASYNC_REQUESTS_ENABLED", false)),
+        damageReportMode(convertDamageReportModeString(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_DAMAGE_REPORT_MODE", "raw"))),
+        stackingOrderCheckIntervalMs(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_STACKING_ORDER_CHECK_INTERVAL_MS", 1000)),
+        layoutUpdateIntervalMs(webx_settings_env_or_default("WEBX_ENGINE_DISPLAY_LAYOUT_UPDATE_INTERVAL_MS", 20)) {}
+
+    const bool shmCaptureEnabled;
+    const bool pixelChecksumEnabled;
+    const int encoderThreads;
+    const bool asyncRequestsEnabled;
+    const DamageReportMode damageReportMode;
+    const int stackingOrderCheckIntervalMs;
+    const int layoutUpdateIntervalMs;
+
+private:
+    /* 
+     * Helper function to convert a string to a DamageReportMode enum.
+     */
+    static DamageReportMode convertDamageReportModeString(const std::string & damageReportModeString) {
+        if (damageReportModeString == "region") {
+            return Region;
+        }
+        return RawRectangles;
+    }
+
+    /* 
+     * Default number of image encoding threads: one per core, up to 4.
+     */
+    static int defaultEncoderThreads() {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores == 0 ? 1 : cores > 4 ? 4 : cores;
+    }
+};
+
 /* 
  * Class to manage overall settings for WebX.
  * Includes logging configuration, transport settings, and quality settings.
@@ -204,6 +287,7 @@ public:
     const WebXControllerSettings controller;
     const WebXTransportSettings transport;
     const WebXQualitySettings quality;
+    const WebXDisplaySettings display;
 
 };
 
@@ -4,12 +4,20 @@
 #include <X11/Xlib.h>
 #include <vector>
 #include "WebXRectangle.h"
+#include "WebXRegion.h"
 
 /**
  * @class WebXWindowDamage
  * @brief Represents damage (changes) to an X11 window, including damaged areas and full-window damage state.
+ *
+ * The damaged areas are accumulated exactly in a region. They are only converted into the rectangles of the sub images
+ * to send when requested, merging rectangles when the pixels between them cost less than the overhead of an extra image.
  */
 class WebXWindowDamage {
+private:
+    const static int IMAGE_OVERHEAD_PIXELS = 4096;
+    const static size_t MAX_SIMPLIFIED_RECTANGLES = 64;
+
 public:
     /**
      * @brief Constructs a WebXWindowDamage object for a specific X11 window.
@@ -28,8 +36,19 @@ public:
      */
     WebXWindowDamage(Window x11Window, const WebXRectangle & damageArea, bool fullWindow = false) :
         _x11Window(x11Window),
+        _damageRegion(damageArea),
         _isFullWindow(fullWindow) {
-        this->_damageAreas.push_back(damageArea);
+    }
+
+    /**
+     * @brief Constructs a WebXWindowDamage object with a damaged region.
+     * @param x11Window The X11 window handle.
+     * @param damageRegion The damaged region.
+     */
+    WebXWindowDamage(Window x11Window, const WebXRegion & damageRegion) :
+        _x11Window(x11Window),
+        _damageRegion(damageRegion),
+        _isFullWindow(false) {
     }
 
     /**
@@ -38,7 +57,7 @@ public:
      */
     WebXWindowDamage(const WebXWindowDamage & windowDamage) :
         _x11Window(windowDamage._x11Window),
-        _damageAreas(windowDamage._damageAreas),
+        _damageRegion(windowDamage._damageRegion),
         _isFullWindow(windowDamage._isFullWindow) {
     }
 
@@ -56,7 +75,7 @@ public:
     WebXWindowDamage & operator=(const WebXWindowDamage & windowDamage) {
         if (this != &windowDamage) {
             this->_x11Window = windowDamage._x11Window;
-            this->_damageAreas = windowDamage._damageAreas;
+            this->_damageRegion = windowDamage._damageRegion;
             this->_isFullWindow = windowDamage._isFullWindow;
         }
         return *this;
@@ -73,15 +92,12 @@ public:
 
         } else if (windowDamage._isFullWindow) {
             // If window data to be added is full then set this one to full
-            this->_damageAreas.clear();
+            this->_damageRegion.clear();
             this->_isFullWindow = true;
 
         } else {
             // Add all new damaged areas to this one
-            for (const WebXRectangle & rect : windowDamage._damageAreas) {
-                this->addDamageRecange(rect);
-            }
-
+            this->_damageRegion += windowDamage._damageRegion;
         }
         return *this;
     }
@@ -111,19 +127,27 @@ public:
         if (this->_isFullWindow) {
             return true;
         }
-        if (this->_damageAreas.size() != 1) {
+        if (this->_damageRegion.getNumberOfRectangles() != 1) {
             return false;
         }
-        const WebXRectangle & damageArea = this->_damageAreas[0];
+        WebXRectangle damageArea = this->_damageRegion.getExtents();
         return damageArea.size().width() == windowSize.width() && damageArea.size().height() == windowSize.height();
     }
 
     /**
-     * @brief Gets the list of damaged areas.
-     * @return A reference to a vector of WebXRectangle objects representing damaged areas.
+     * @brief Gets the rectangles of the sub images covering the damaged areas at the lowest estimated encoding cost.
+     * @return A vector of WebXRectangle objects covering the damaged areas.
      */
-    const std::vector<WebXRectangle> & getDamagedAreas() const {
-        return this->_damageAreas;
+    std::vector<WebXRectangle> getDamagedAreas() const {
+        return this->_damageRegion.simplify(IMAGE_OVERHEAD_PIXELS, MAX_SIMPLIFIED_RECTANGLES);
+    }
+
+    /**
+     * @brief Gets the exact damaged region.
+     * @return A reference to the damaged region.
+     */
+    const WebXRegion & getDamagedRegion() const {
+        return this->_damageRegion;
     }
 
     /**
@@ -131,11 +155,7 @@ public:
      * @return The total damaged area in pixels.
      */
     int getDamagedArea() const {
-        int area = 0;
-        for (const WebXRectangle & damageArea : this->_damageAreas) {
-            area += damageArea.area();
-        }
-        return area;
+        return this->_damageRegion.area();
     }
 
     /**
@@ -143,47 +163,31 @@ public:
      * @return True if there is damage, false otherwise.
      */
     bool hasDamage() const {
-        return this->_isFullWindow || this->_damageAreas.size() > 0;
+        return this->_isFullWindow || !this->_damageRegion.isEmpty();
     }
 
     /**
-     * @brief Resets the damage state, clearing all damaged areas.
+     * @brief Removes the damaged areas outside of a region (eg the pixels hidden by other windows). Full window damage
+     * is kept as is: the full window image is needed by the clients.
+     * @param region The region to keep.
      */
-    void reset() {
-        this->_isFullWindow = false;
-        this->_damageAreas.clear();
+    void clip(const WebXRegion & region) {
+        if (!this->_isFullWindow) {
+            this->_damageRegion &= region;
+        }
     }
 
-private:
     /**
-     * @brief Adds a damaged rectangle, merging it with existing damaged areas if they overlap or touch.
-     * @param damageArea The rectangle representing the damaged area to add.
+     * @brief Resets the damage state, clearing all damaged areas.
      */
-    void addDamageRecange(const WebXRectangle & damageArea) {
-        if (this->_isFullWindow) {
-            return;
-        }
-
-        WebXRectangle combinedDamageArea = damageArea;
-
-        auto it = this->_damageAreas.begin();
-        while (it != this->_damageAreas.end()) {
-            WebXRectangle & existingDamageArea = *it;
-            if (existingDamageArea.overlapOrTouching(combinedDamageArea)) {
-                combinedDamageArea += existingDamageArea;
-                it = this->_damageAreas.erase(it);
-            
-            } else {
-                it++;
-            }
-        }
-
-        this->_damageAreas.push_back(combinedDamageArea);
-    }    
+    void reset() {
+        this->_isFullWindow = false;
+        this->_damageRegion.clear();
+    }
 
 private:
     Window _x11Window;
-    std::vector<WebXRectangle> _damageAreas;
+    WebXRegion _damageRegion;
     bool _isFullWindow;
 };
 
@@ -4,6 +4,9 @@
 #include <X11/Xlib.h>
 #include <memory>
 #include <chrono>
+#include <vector>
+#include <utility>
+#include "WebXRectangle.h"
 
 /**
  * @class WebXWindowImageTransferData
@@ -25,27 +28,35 @@ public:
      * @brief Constructs a WebXWindowImageTransferData object with a status.
      * @param x11Window The X11 window handle.
      * @param status The image transfer status.
+     * @param refreshCostUs The processing time of the refresh in microseconds.
      */
-    WebXWindowImageTransferData(Window x11Window, WebXWindowImageTransferStatus status) :
+    WebXWindowImageTransferData(Window x11Window, WebXWindowImageTransferStatus status, float refreshCostUs) :
         x11Window(x11Window),
         timestamp(std::chrono::high_resolution_clock::now()),
         imageSizeKB(0),
         rgbChecksum(0),
         alphaChecksum(0),
-        status(status) {}
+        pixelChecksum(0),
+        status(status),
+        refreshCostUs(refreshCostUs) {}
 
     /**
      * @brief Constructs a WebXWindowImageTransferData object with image size.
      * @param x11Window The X11 window handle.
      * @param imageSizeKB The size of the image in kilobytes.
+     * @param subImagePixelChecksums The areas of the sub images and the checksums of their raw pixels.
+     * @param refreshCostUs The processing time of the refresh in microseconds.
      */
-    WebXWindowImageTransferData(Window x11Window, float imageSizeKB) :
+    WebXWindowImageTransferData(Window x11Window, float imageSizeKB, const std::vector<std::pair<WebXRectangle, uint64_t>> & subImagePixelChecksums, float refreshCostUs) :
         x11Window(x11Window),
         timestamp(std::chrono::high_resolution_clock::now()),
         imageSizeKB(imageSizeKB),
         rgbChecksum(0),
         alphaChecksum(0),
-        status(SubWindow) {}
+        pixelChecksum(0),
+        subImagePixelChecksums(subImagePixelChecksums),
+        status(SubWindow),
+        refreshCostUs(refreshCostUs) {}
 
     /**
      * @brief Constructs a WebXWindowImageTransferData object with image size and checksums.
@@ -53,14 +64,18 @@ public:
      * @param imageSizeKB The size of the image in kilobytes.
      * @param rgbChecksum The RGB checksum of the image.
      * @param alphaChecksum The alpha checksum of the image.
+     * @param pixelChecksum The checksum of the raw pixels of the image (0 if unknown).
+     * @param refreshCostUs The processing time of the refresh in microseconds.
      */
-    WebXWindowImageTransferData(Window x11Window, float imageSizeKB, uint32_t rgbChecksum, uint32_t alphaChecksum) :
+    WebXWindowImageTransferData(Window x11Window, float imageSizeKB, uint32_t rgbChecksum, uint32_t alphaChecksum, uint64_t pixelChecksum, float refreshCostUs) :
         x11Window(x11Window),
         timestamp(std::chrono::high_resolution_clock::now()),
         imageSizeKB(imageSizeKB),
         rgbChecksum(rgbChecksum),
         alphaChecksum(alphaChecksum),
-        status(FullWindow) {}
+        pixelChecksum(pixelChecksum),
+        status(FullWindow),
+        refreshCostUs(refreshCostUs) {}
 
     /**
      * @brief Copy constructor for WebXWindowImageTransferData.
@@ -72,7 +87,10 @@ public:
         imageSizeKB(transferData.imageSizeKB),
         rgbChecksum(transferData.rgbChecksum),
         alphaChecksum(transferData.alphaChecksum),
-        status(transferData.status) {}
+        pixelChecksum(transferData.pixelChecksum),
+        subImagePixelChecksums(transferData.subImagePixelChecksums),
+        status(transferData.status),
+        refreshCostUs(transferData.refreshCostUs) {}
 
     /**
      * @brief Destructor for WebXWindowImageTransferData.
@@ -85,7 +103,12 @@ public:
     const float imageSizeKB;
     const uint32_t rgbChecksum;
     const uint32_t alphaChecksum;
+    const uint64_t pixelChecksum;
+    const std::vector<std::pair<WebXRectangle, uint64_t>> subImagePixelChecksums;
     const WebXWindowImageTransferStatus status;
+
+    // Capture time on the controller thread plus the encoding time of the images in the encoder workers
+    const float refreshCostUs;
 };
 
 #endif /* WEBX_WINDOW_IMAGE_TRANSFER_H */
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <X11/Xlib.h>
 #include "WebXWindowCoverage.h"
+#include "WebXRegion.h"
 
 /**
  * @class WebXWindowVisibility
@@ -19,6 +20,7 @@ public:
     WebXWindowVisibility(Window x11Window, const WebXRectangle & rectangle, bool isViewable) :
         _x11Window(x11Window),
         _rectangle(rectangle),
+        _visibleRegion(WebXRectangle(0, 0, rectangle.size().width(), rectangle.size().height())),
         _isViewable(isViewable),
         _shapeMaskChecksum(0) {}
     
@@ -92,6 +94,23 @@ public:
         this->_rectangle = rectangle;
     }
 
+    /**
+     * @brief Gets the pixels of the window that are not hidden by the windows above it (in window coordinates). Until
+     * the coverage of the window is calculated all the pixels are considered visible.
+     * @return A reference to the visible region.
+     */
+    const WebXRegion & getVisibleRegion() const {
+        return this->_visibleRegion;
+    }
+
+    /**
+     * @brief Sets the pixels of the window that are not hidden by the windows above it.
+     * @param visibleRegion The visible region in window coordinates.
+     */
+    void setVisibleRegion(const WebXRegion & visibleRegion) {
+        this->_visibleRegion = visibleRegion;
+    }
+
     /**
      * @brief Gets the window's shape mask checksum
      * @return the window's shape mask checksum.
@@ -112,6 +131,7 @@ private:
     Window _x11Window;
     WebXWindowCoverage _coverage;
     WebXRectangle _rectangle;
+    WebXRegion _visibleRegion;
     bool _isViewable;
     uint32_t _shapeMaskChecksum;
 
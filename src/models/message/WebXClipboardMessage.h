@@ -7,7 +7,7 @@
 
 class WebXClipboardMessage : public WebXMessage {
 public:
-WebXClipboardMessage(uint64_t clientIndexMask, const std::string & clipboardContent) :
+WebXClipboardMessage(const WebXClientIndexMask & clientIndexMask, const std::string & clipboardContent) :
         WebXMessage(Type::Clipboard, clientIndexMask),
         clipboardContent(clipboardContent) {}
     virtual ~WebXClipboardMessage() {}
@@ -27,7 +27,7 @@ public:
      * @param cursorId The ID of the cursor.
      * @param mouseCursorImage A shared pointer to the cursor image data.
      */
-    WebXCursorImageMessage(uint64_t clientIndexMask, uint32_t commandId, int x, int y, int xhot, int yhot, uint32_t cursorId, std::shared_ptr<WebXImage> mouseCursorImage) :
+    WebXCursorImageMessage(const WebXClientIndexMask & clientIndexMask, uint32_t commandId, int x, int y, int xhot, int yhot, uint32_t cursorId, std::shared_ptr<WebXImage> mouseCursorImage) :
         WebXMessage(Type::CursorImage, clientIndexMask, commandId),
         x(x),
         y(y),
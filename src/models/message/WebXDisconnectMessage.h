@@ -17,7 +17,7 @@ public:
      * 
      * @param clientIndexMask The client index mask.
      */
-    WebXDisconnectMessage(uint64_t clientIndexMask) :
+    WebXDisconnectMessage(const WebXClientIndexMask & clientIndexMask) :
         WebXMessage(Type::Disconnect, clientIndexMask) {}
 
     /**
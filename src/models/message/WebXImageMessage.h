@@ -4,14 +4,15 @@
 #include <vector>
 #include <memory>
 #include "WebXMessage.h"
-
-class WebXImage;
+#include <image/WebXImage.h>
 
 /**
  * @class WebXImageMessage
  * @brief Represents a message containing image data.
  * 
  * This class is used to encapsulate image data associated with a specific window (including color map and image map).
+ * The image can be shared with the messages of other client groups (and with the image cache) so it is never modified:
+ * the alpha data is omitted from a message when the clients already have it.
  */
 class WebXImageMessage : public WebXMessage {
 public:
@@ -21,11 +22,13 @@ public:
      * @param clientIndexMask The client index mask.
      * @param windowId The ID of the window associated with the image.
      * @param image A shared pointer to the image data.
+     * @param alphaIncluded Whether the alpha data of the image is sent (false if unchanged since the previous image).
      */
-    WebXImageMessage(uint64_t clientIndexMask, uint32_t windowId, std::shared_ptr<WebXImage> image) :
+    WebXImageMessage(const WebXClientIndexMask & clientIndexMask, uint32_t windowId, std::shared_ptr<WebXImage> image, bool alphaIncluded = true) :
         WebXMessage(Type::Image, clientIndexMask),
         windowId(windowId),
-        image(image) {}
+        image(image),
+        alphaIncluded(alphaIncluded) {}
 
     /**
      * @brief Constructs a WebXImageMessage with a command ID.
@@ -35,18 +38,36 @@ public:
      * @param windowId The ID of the window associated with the image.
      * @param image A shared pointer to the image data.
      */
-    WebXImageMessage(uint64_t clientIndexMask, uint32_t commandId, uint32_t windowId, std::shared_ptr<WebXImage> image) :
+    WebXImageMessage(const WebXClientIndexMask & clientIndexMask, uint32_t commandId, uint32_t windowId, std::shared_ptr<WebXImage> image) :
         WebXMessage(Type::Image, clientIndexMask, commandId),
         windowId(windowId),
-        image(image) {}
+        image(image),
+        alphaIncluded(true) {}
 
     /**
      * @brief Destructor for WebXImageMessage.
      */
     virtual ~WebXImageMessage() {}
 
+    /**
+     * @brief Gets the size of the alpha data sent with the image.
+     * @return The size of the alpha data (0 if the alpha data is not included).
+     */
+    size_t getAlphaDataSize() const {
+        return (this->image && this->alphaIncluded) ? this->image->getAlphaDataSize() : 0;
+    }
+
+    /**
+     * @brief Gets the size of the image data sent with the message.
+     * @return The size of the raw and included alpha data.
+     */
+    size_t getImageDataSize() const {
+        return (this->image ? this->image->getRawDataSize() : 0) + this->getAlphaDataSize();
+    }
+
     const uint32_t windowId;
     const std::shared_ptr<WebXImage> image;
+    const bool alphaIncluded;
 };
 
 #endif /* WEBX_IMAGE_MESSAGE_H*/
\ No newline at end of file
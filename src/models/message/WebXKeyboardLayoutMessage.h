@@ -6,7 +6,7 @@
 
 class WebXKeyboardLayoutMessage : public WebXMessage {
 public:
-WebXKeyboardLayoutMessage(uint64_t clientIndexMask, const std::string & keyboardLayoutName) :
+WebXKeyboardLayoutMessage(const WebXClientIndexMask & clientIndexMask, const std::string & keyboardLayoutName) :
         WebXMessage(Type::KeyboardLayout, clientIndexMask),
         keyboardLayoutName(keyboardLayoutName) {}
     virtual ~WebXKeyboardLayoutMessage() {}
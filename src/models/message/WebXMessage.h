@@ -3,6 +3,7 @@
 
 #include <string>
 #include <cstdint>
+#include <models/WebXClientIndexMask.h>
 
 /**
  * @class WebXMessage
@@ -30,12 +31,12 @@ public:
         KeyboardLayout,
     };
 
-    WebXMessage(Type type, uint64_t clientIndexMask) :
+    WebXMessage(Type type, const WebXClientIndexMask & clientIndexMask) :
         type(type),
         clientIndexMask(clientIndexMask),
         commandId(-1) {}
 
-    WebXMessage(Type type, uint64_t clientIndexMask, uint32_t commandId) :
+    WebXMessage(Type type, const WebXClientIndexMask & clientIndexMask, uint32_t commandId) :
         type(type),
         clientIndexMask(clientIndexMask),
         commandId(commandId) {}
@@ -43,7 +44,7 @@ public:
     virtual ~WebXMessage() {}
 
     const Type type;
-    const uint64_t clientIndexMask;
+    const WebXClientIndexMask clientIndexMask;
     const uint32_t commandId;
 };
 
@@ -20,7 +20,7 @@ public:
      * @param y The y-coordinate of the mouse event.
      * @param cursorId The ID of the cursor.
      */
-    WebXMouseMessage(uint64_t clientIndexMask, int x, int y, uint32_t cursorId) :
+    WebXMouseMessage(const WebXClientIndexMask & clientIndexMask, int x, int y, uint32_t cursorId) :
         WebXMessage(Type::Mouse, clientIndexMask),
         x(x),
         y(y),
@@ -17,7 +17,7 @@ public:
      * 
      * @param clientIndexMask The client index mask.
      */
-    WebXPingMessage(uint64_t clientIndexMask) :
+    WebXPingMessage(const WebXClientIndexMask & clientIndexMask) :
         WebXMessage(Type::Ping, clientIndexMask) {}
 
     /**
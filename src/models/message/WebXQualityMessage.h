@@ -18,7 +18,7 @@ public:
      * @param clientIndexMask The client index mask.
      * @param quality The quality settings.
      */
-    WebXQualityMessage(uint64_t clientIndexMask, const WebXQuality & quality) :
+    WebXQualityMessage(const WebXClientIndexMask & clientIndexMask, const WebXQuality & quality) :
         WebXMessage(Type::Quality, clientIndexMask),
         quality(quality) {}
 
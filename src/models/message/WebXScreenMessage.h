@@ -25,7 +25,7 @@ public:
      * @param canResizeScreen Whether the screen can be resized or not
      * @param keyboardLayoutName The current keyboard layout name
      */
-    WebXScreenMessage(uint64_t clientIndexMask, uint32_t commandId, WebXSize screenSize, int maxQualityIndex, const WebXVersion & engineVersion, bool canResizeScreen, const std::string & keyboardLayoutName) :
+    WebXScreenMessage(const WebXClientIndexMask & clientIndexMask, uint32_t commandId, WebXSize screenSize, int maxQualityIndex, const WebXVersion & engineVersion, bool canResizeScreen, const std::string & keyboardLayoutName) :
         WebXMessage(Type::Screen, clientIndexMask, commandId),
         screenSize(screenSize),
         maxQualityIndex(maxQualityIndex),
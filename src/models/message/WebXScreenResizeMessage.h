@@ -18,7 +18,7 @@ public:
      * @param clientIndexMask The client index mask.
      * @param screenSize The size of the screen.
      */
-    WebXScreenResizeMessage(uint64_t clientIndexMask, WebXSize screenSize) :
+    WebXScreenResizeMessage(const WebXClientIndexMask & clientIndexMask, WebXSize screenSize) :
         WebXMessage(Type::ScreenResize, clientIndexMask),
         screenSize(screenSize) {}
     
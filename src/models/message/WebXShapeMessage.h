@@ -22,7 +22,7 @@ public:
      * @param windowId The ID of the window associated with the shape.
      * @param shape A shared pointer to the shape image data.
      */
-    WebXShapeMessage(uint64_t clientIndexMask, uint32_t windowId, std::shared_ptr<WebXImage> shape) :
+    WebXShapeMessage(const WebXClientIndexMask & clientIndexMask, uint32_t windowId, std::shared_ptr<WebXImage> shape) :
         WebXMessage(Type::Shape, clientIndexMask),
         windowId(windowId),
         shape(shape) {}
@@ -35,7 +35,7 @@ public:
      * @param windowId The ID of the window associated with the shape.
      * @param shape A shared pointer to the shape image data.
      */
-    WebXShapeMessage(uint64_t clientIndexMask, uint32_t commandId, uint32_t windowId, std::shared_ptr<WebXImage> shape) :
+    WebXShapeMessage(const WebXClientIndexMask & clientIndexMask, uint32_t commandId, uint32_t windowId, std::shared_ptr<WebXImage> shape) :
         WebXMessage(Type::Shape, clientIndexMask, commandId),
         windowId(windowId),
         shape(shape) {}
@@ -21,7 +21,7 @@ public:
      * @param windowId The ID of the window associated with the sub-images.
      * @param images A vector of sub-image data.
      */
-    WebXSubImagesMessage(uint64_t clientIndexMask, uint32_t windowId, const std::vector<WebXSubImage> & images) :
+    WebXSubImagesMessage(const WebXClientIndexMask & clientIndexMask, uint32_t windowId, const std::vector<WebXSubImage> & images) :
         WebXMessage(Type::Subimages, clientIndexMask),
         windowId(windowId),
         images(images) {}
@@ -21,7 +21,7 @@ public:
      * @param commandId The command ID associated with the message.
      * @param windows A vector of window properties.
      */
-    WebXWindowsMessage(uint64_t clientIndexMask, uint32_t commandId, const std::vector<WebXWindowProperties> & windows) :
+    WebXWindowsMessage(const WebXClientIndexMask & clientIndexMask, uint32_t commandId, const std::vector<WebXWindowProperties> & windows) :
         WebXMessage(Type::Windows, clientIndexMask, commandId),
         windows(windows) {}
 
@@ -31,7 +31,7 @@ public:
      * @param clientIndexMask The client index mask.
      * @param windows A vector of window properties.
      */
-    WebXWindowsMessage(uint64_t clientIndexMask, const std::vector<WebXWindowProperties> & windows) :
+    WebXWindowsMessage(const WebXClientIndexMask & clientIndexMask, const std::vector<WebXWindowProperties> & windows) :
         WebXMessage(Type::Windows, clientIndexMask),
         windows(windows) {}
 
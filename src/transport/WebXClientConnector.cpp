@@ -180,10 +180,17 @@ void WebXClientConnector::mainLoop() {
 
 std::string WebXClientConnector::connectClient(const std::string & sessionId, const WebXVersion & clientVersion) {
     if (sessionId == this->_sessionId) {
-        const WebXResult<std::pair<uint32_t, uint64_t>> result = this->_gateway.onClientConnect(clientVersion);
+        const WebXResult<std::pair<uint32_t, WebXClientIndexMask>> result = this->_gateway.onClientConnect(clientVersion);
         if (result.ok()) {
-            const std::string response = fmt::format("{:08x},{:016x}", result.data().first, result.data().second);
-            return response;
+            // The word of the client index is only sent for clients beyond the first 64 (extended client addressing)
+            const WebXClientIndexMask & clientIndexMask = result.data().second;
+            size_t clientIndexWord = clientIndexMask.getNumberOfWords() - 1;
+            if (clientIndexWord == 0) {
+                return fmt::format("{:08x},{:016x}", result.data().first, clientIndexMask.getWord(0));
+
+            } else {
+                return fmt::format("{:08x},{:016x},{:d}", result.data().first, clientIndexMask.getWord(clientIndexWord), clientIndexWord);
+            }
 
         } else {
             spdlog::warn("Failed to register client: {:s}", result.error());
@@ -5,8 +5,7 @@
 WebXClientMessagePublisher::WebXClientMessagePublisher(const WebXTransportSettings & settings) :
     _thread(NULL),
     _running(false),
-    _messageQueue(),
-    _encoder(settings.sessionId),
+    _encoder(settings.sessionId, settings.multipartImageMessages, settings.maxClients),
     _eventBusAddr(settings.inprocEventBusAddress) {
 }
 
@@ -47,13 +46,19 @@ void WebXClientMessagePublisher::mainLoop() {
            auto message = this->_messageQueue.get();
             if (message != NULL && this->_running) {
 
-                zmq::message_t * replyMessage = this->_encoder.encode(message);
+                // Image messages can be composed of several frames referencing the image data
+                std::vector<zmq::message_t *> replyFrames = this->_encoder.encodeFrames(message);
+                for (size_t i = 0; i < replyFrames.size(); i++) {
+                    bool hasMore = i < replyFrames.size() - 1;
 #ifdef COMPILE_FOR_CPPZMQ_BEFORE_4_3_1
-                messagePublisher.send(*replyMessage);
+                    messagePublisher.send(*replyFrames[i], hasMore ? ZMQ_SNDMORE : 0);
 #else
-                messagePublisher.send(*replyMessage, zmq::send_flags::none);
+                    messagePublisher.send(*replyFrames[i], hasMore ? zmq::send_flags::sndmore : zmq::send_flags::none);
 #endif
-                delete replyMessage;
+                }
+                for (zmq::message_t * replyFrame : replyFrames) {
+                    delete replyFrame;
+                }
             }
 
         } catch(zmq::error_t& e) {
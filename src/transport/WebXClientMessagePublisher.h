@@ -2,7 +2,7 @@
 #define WEBX_CLIENT_MESSAGE_PUBLISHER_H
 
 #include "serializer/WebXMessageEncoder.h"
-#include <utils/WebXQueue.h>
+#include "WebXMessageLaneQueue.h"
 #include <models/WebXSettings.h>
 #include <thread>
 #include <mutex>
@@ -19,7 +19,7 @@ class socket_t;
  * @brief Publishes messages to a client using ZeroMQ.
  * 
  * This class is responsible for managing the lifecycle of a message publisher
- * that sends messages to a client. It uses a queue to handle incoming messages
+ * that sends messages to a client. It uses a queue of prioritised lanes to handle incoming messages
  * and a separate thread to process and publish them.
  */
 class WebXClientMessagePublisher {
@@ -58,6 +58,14 @@ public:
         }
     }
 
+    /**
+     * @brief Gets the depth and cumulative counters of the lanes of the message queue.
+     * @return The metrics of the message lanes.
+     */
+    std::vector<WebXMessageLaneMetrics> getMessageLaneMetrics() const {
+        return this->_messageQueue.getMetrics();
+    }
+
 private:
     /**
      * @brief The main loop that processes and publishes messages.
@@ -73,7 +81,7 @@ private:
 private:
     std::thread * _thread;
     bool _running;
-    WebXQueue<std::shared_ptr<WebXMessage>> _messageQueue;
+    WebXMessageLaneQueue _messageQueue;
 
     const WebXMessageEncoder _encoder;
     zmq::context_t * _context;
@@ -0,0 +1,198 @@
+#include "WebXMessageLaneQueue.h"
+#include <models/message/WebXImageMessage.h>
+#include <models/message/WebXSubImagesMessage.h>
+#include <models/message/WebXMouseMessage.h>
+#include <models/message/WebXWindowsMessage.h>
+#include <image/WebXImage.h>
+#include <poll.h>
+
+WebXMessageLaneQueue::WebXMessageLaneQueue() :
+    _waiting(false),
+    _stopped(false) {
+}
+
+WebXMessageLaneQueue::~WebXMessageLaneQueue() {
+}
+
+void WebXMessageLaneQueue::put(std::shared_ptr<WebXMessage> message) {
+    if (this->_stopped) {
+        return;
+    }
+
+    WebXMessageLane & lane = this->_lanes[GetLane(message->type)];
+    lane.depth++;
+    lane.queue.push(WebXMessageLaneEntry{message, std::chrono::high_resolution_clock::now()});
+
+    // The consumer sets the waiting flag before verifying the depths: either it sees the new message or it is notified
+    if (this->_waiting) {
+        this->_notifier.notify();
+    }
+}
+
+std::shared_ptr<WebXMessage> WebXMessageLaneQueue::get() {
+    std::shared_ptr<WebXMessage> message;
+    while (!this->_stopped) {
+        this->transferMessages();
+        if (this->pop(message)) {
+            return message;
+        }
+
+        this->_waiting = true;
+        if (!this->hasMessages() && !this->_stopped) {
+            struct pollfd pollFd = { this->_notifier.getFd(), POLLIN, 0 };
+            poll(&pollFd, 1, -1);
+            this->_notifier.reset();
+        }
+        this->_waiting = false;
+    }
+
+    return nullptr;
+}
+
+void WebXMessageLaneQueue::stop() {
+    this->_stopped = true;
+    this->_notifier.notify();
+}
+
+std::vector<WebXMessageLaneMetrics> WebXMessageLaneQueue::getMetrics() const {
+    static const char * laneNames[NUMBER_OF_LANES] = { "input", "control", "bulk" };
+
+    std::vector<WebXMessageLaneMetrics> metrics;
+    for (int i = 0; i < NUMBER_OF_LANES; i++) {
+        const WebXMessageLane & lane = this->_lanes[i];
+        metrics.push_back(WebXMessageLaneMetrics{laneNames[i], lane.depth, lane.messages, lane.waitTimeUs, lane.droppedMessages, lane.droppedBytes});
+    }
+    return metrics;
+}
+
+WebXMessageLaneQueue::Lane WebXMessageLaneQueue::GetLane(WebXMessage::Type type) {
+    switch (type) {
+        case WebXMessage::Mouse:
+        case WebXMessage::CursorImage:
+            return InputLane;
+
+        case WebXMessage::Image:
+        case WebXMessage::Subimages:
+        case WebXMessage::Shape:
+            return BulkLane;
+
+        default:
+            return ControlLane;
+    }
+}
+
+bool WebXMessageLaneQueue::Supersedes(const std::shared_ptr<WebXMessage> & newer, const std::shared_ptr<WebXMessage> & older) {
+    // Replies to instructions are always sent
+    if (older->commandId != (uint32_t)-1 || older->clientIndexMask != newer->clientIndexMask) {
+        return false;
+    }
+
+    if (newer->type == WebXMessage::Image) {
+        auto newerImageMessage = std::static_pointer_cast<WebXImageMessage>(newer);
+
+        // An image with transparency but without alpha data uses the alpha of the previous image of the window
+        const std::shared_ptr<WebXImage> & image = newerImageMessage->image;
+        if (image == nullptr || (image->getDepth() == 32 && newerImageMessage->getAlphaDataSize() == 0)) {
+            return false;
+        }
+
+        if (older->type == WebXMessage::Image) {
+            return std::static_pointer_cast<WebXImageMessage>(older)->windowId == newerImageMessage->windowId;
+
+        } else if (older->type == WebXMessage::Subimages) {
+            return std::static_pointer_cast<WebXSubImagesMessage>(older)->windowId == newerImageMessage->windowId;
+        }
+
+    } else if (newer->type == WebXMessage::Mouse && older->type == WebXMessage::Mouse) {
+        // A message without position (only the cursor) does not replace the position of the older one
+        auto newerMouseMessage = std::static_pointer_cast<WebXMouseMessage>(newer);
+        auto olderMouseMessage = std::static_pointer_cast<WebXMouseMessage>(older);
+        bool newerHasPosition = newerMouseMessage->x != -1 || newerMouseMessage->y != -1;
+        bool olderHasPosition = olderMouseMessage->x != -1 || olderMouseMessage->y != -1;
+        return newerHasPosition || !olderHasPosition;
+
+    } else if (newer->type == WebXMessage::Windows && older->type == WebXMessage::Windows) {
+        return true;
+    }
+
+    return false;
+}
+
+size_t WebXMessageLaneQueue::GetEncodedSize(const std::shared_ptr<WebXMessage> & message) {
+    const size_t headerSize = 48;
+    switch (message->type) {
+        case WebXMessage::Image: {
+            auto imageMessage = std::static_pointer_cast<WebXImageMessage>(message);
+            return headerSize + 24 + imageMessage->getImageDataSize();
+        }
+        case WebXMessage::Subimages: {
+            auto subImagesMessage = std::static_pointer_cast<WebXSubImagesMessage>(message);
+            size_t size = headerSize + 12;
+            for (const WebXSubImage & subImage : subImagesMessage->images) {
+                size += 32 + subImage.image->getFullDataSize();
+            }
+            return size;
+        }
+        case WebXMessage::Mouse:
+            return headerSize + 16;
+
+        case WebXMessage::Windows: {
+            auto windowsMessage = std::static_pointer_cast<WebXWindowsMessage>(message);
+            size_t size = headerSize + 12 + windowsMessage->windows.size() * 20;
+            for (const WebXWindowProperties & window : windowsMessage->windows) {
+                size += window.hasShape ? 4 : 0;
+            }
+            return size;
+        }
+        default:
+            return headerSize;
+    }
+}
+
+void WebXMessageLaneQueue::transferMessages() {
+    for (int i = 0; i < NUMBER_OF_LANES; i++) {
+        WebXMessageLane & lane = this->_lanes[i];
+        WebXMessageLaneEntry entry;
+        while (lane.queue.pop(entry)) {
+            // Superseded messages are marked as dropped (they are removed when reaching the front of the list)
+            for (WebXMessageLaneEntry & pendingEntry : lane.pending) {
+                if (pendingEntry.message && Supersedes(entry.message, pendingEntry.message)) {
+                    lane.depth--;
+                    lane.droppedMessages++;
+                    lane.droppedBytes += GetEncodedSize(pendingEntry.message);
+                    pendingEntry.message = nullptr;
+                }
+            }
+            lane.pending.push_back(entry);
+        }
+    }
+}
+
+bool WebXMessageLaneQueue::pop(std::shared_ptr<WebXMessage> & message) {
+    for (int i = 0; i < NUMBER_OF_LANES; i++) {
+        WebXMessageLane & lane = this->_lanes[i];
+        while (!lane.pending.empty()) {
+            WebXMessageLaneEntry entry = lane.pending.front();
+            lane.pending.pop_front();
+            if (entry.message) {
+                std::chrono::duration<double, std::micro> waitTime = std::chrono::high_resolution_clock::now() - entry.enqueueTime;
+                lane.depth--;
+                lane.messages++;
+                lane.waitTimeUs += (uint64_t)waitTime.count();
+
+                message = entry.message;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WebXMessageLaneQueue::hasMessages() const {
+    for (int i = 0; i < NUMBER_OF_LANES; i++) {
+        if (this->_lanes[i].depth > 0) {
+            return true;
+        }
+    }
+    return false;
+}
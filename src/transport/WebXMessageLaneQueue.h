@@ -0,0 +1,148 @@
+#ifndef WEBX_MESSAGE_LANE_QUEUE_H
+#define WEBX_MESSAGE_LANE_QUEUE_H
+
+#include <utils/WebXLockFreeQueue.h>
+#include <utils/WebXEventNotifier.h>
+#include <models/WebXMessageLaneMetrics.h>
+#include <models/message/WebXMessage.h>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @class WebXMessageLaneQueue
+ * @brief Queue of the client message publisher composed of separate lock-free lanes by latency sensitivity.
+ *
+ * Messages are put in the input lane (mouse position and cursor), the control lane (pings, quality, layout, screen
+ * and clipboard) or the bulk lane (window images and shapes). The consumer always drains the input lane first, then
+ * the control lane: a mouse message never waits behind queued images. The order of the messages of a lane is
+ * preserved. Producers never block: the consumer is only woken (through an eventfd) when it is waiting for messages.
+ *
+ * When the consumer falls behind, queued messages that are superseded by a newer message of the same lane are dropped
+ * before being sent: a full-window image replaces the older images and subimages of the window, and mouse and windows
+ * messages collapse to the latest one. Only messages for the same clients and not replying to an instruction are
+ * dropped.
+ */
+class WebXMessageLaneQueue {
+public:
+    /**
+     * @brief The lanes of the queue, in drain order.
+     */
+    enum Lane {
+        InputLane = 0,
+        ControlLane,
+        BulkLane,
+        NUMBER_OF_LANES
+    };
+
+private:
+    struct WebXMessageLaneEntry {
+        std::shared_ptr<WebXMessage> message;
+        std::chrono::high_resolution_clock::time_point enqueueTime;
+    };
+
+    struct WebXMessageLane {
+        WebXMessageLane() :
+            depth(0),
+            messages(0),
+            waitTimeUs(0),
+            droppedMessages(0),
+            droppedBytes(0) {}
+
+        WebXLockFreeQueue<WebXMessageLaneEntry> queue;
+        std::deque<WebXMessageLaneEntry> pending;
+        std::atomic<size_t> depth;
+        std::atomic<uint64_t> messages;
+        std::atomic<uint64_t> waitTimeUs;
+        std::atomic<uint64_t> droppedMessages;
+        std::atomic<uint64_t> droppedBytes;
+    };
+
+public:
+    /**
+     * @brief Constructs an empty WebXMessageLaneQueue.
+     */
+    WebXMessageLaneQueue();
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~WebXMessageLaneQueue();
+
+    /**
+     * @brief Puts a message in the lane corresponding to its type. Never blocks. Can be called from any thread.
+     * @param message The message to queue.
+     */
+    void put(std::shared_ptr<WebXMessage> message);
+
+    /**
+     * @brief Gets the next message from the most latency-sensitive non-empty lane. Blocks while all the lanes are
+     * empty. Must only be called by the consumer thread.
+     * @return The message, or NULL if the queue has been stopped.
+     */
+    std::shared_ptr<WebXMessage> get();
+
+    /**
+     * @brief Stops the queue: the consumer is woken and get returns NULL.
+     */
+    void stop();
+
+    /**
+     * @brief Gets the current depth and cumulative counters of each lane. Can be called from any thread.
+     * @return The metrics of the lanes, in drain order.
+     */
+    std::vector<WebXMessageLaneMetrics> getMetrics() const;
+
+    /**
+     * @brief Gets the lane of a message type.
+     * @param type The message type.
+     * @return The lane in which messages of the type are queued.
+     */
+    static Lane GetLane(WebXMessage::Type type);
+
+    /**
+     * @brief Determines if a queued message is made obsolete by a newer message (the newer one contains all the
+     * information of the older one that the clients need).
+     * @param newer The newer message.
+     * @param older The older message, queued in the same lane.
+     * @return True if the older message can be dropped.
+     */
+    static bool Supersedes(const std::shared_ptr<WebXMessage> & newer, const std::shared_ptr<WebXMessage> & older);
+
+    /**
+     * @brief Gets the (approximate) number of bytes of a message once encoded.
+     * @param message The message.
+     * @return The encoded size of the message.
+     */
+    static size_t GetEncodedSize(const std::shared_ptr<WebXMessage> & message);
+
+private:
+    /**
+     * @brief Moves the messages of the lock-free lanes to the pending lists of the consumer, dropping the pending
+     * messages that they supersede.
+     */
+    void transferMessages();
+
+    /**
+     * @brief Removes the next pending message from the lanes, in drain order.
+     * @param message Set to the removed message.
+     * @return True if a message has been removed.
+     */
+    bool pop(std::shared_ptr<WebXMessage> & message);
+
+    /**
+     * @brief Determines if any of the lanes contains messages (possibly still being pushed).
+     * @return True if a message has been put and not yet removed.
+     */
+    bool hasMessages() const;
+
+private:
+    WebXMessageLane _lanes[NUMBER_OF_LANES];
+    std::atomic<bool> _waiting;
+    std::atomic<bool> _stopped;
+    WebXEventNotifier _notifier;
+};
+
+#endif /* WEBX_MESSAGE_LANE_QUEUE_H */
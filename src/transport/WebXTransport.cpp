@@ -52,11 +52,17 @@ void WebXTransport::start() {
     this->_gateway.setMessagePublisherFunc([this](std::shared_ptr<WebXMessage> message) {
         this->_publisher->onMessage(message);
     });
+
+    // Set the message lane metrics function in the gateway
+    this->_gateway.setMessageLaneMetricsFunc([this]() {
+        return this->_publisher->getMessageLaneMetrics();
+    });
 }
 
 void WebXTransport::stop() {
     // Remove the message publisher function in the gateway
     this->_gateway.setMessagePublisherFunc(nullptr);
+    this->_gateway.setMessageLaneMetricsFunc(nullptr);
 
     // Send shutdown message
     std::string messageString = "shutdown";
@@ -18,6 +18,34 @@
 #include <models/WebXSettings.h>
 #include <zmq.hpp>
 
+static void webx_releaseImageData(void * data, void * hint) {
+    // The frame holds a reference to the image owning the data
+    delete (std::shared_ptr<WebXImage> *)hint;
+}
+
+std::vector<zmq::message_t *> WebXMessageEncoder::encodeFrames(std::shared_ptr<WebXMessage> message) const {
+    std::vector<zmq::message_t *> frames;
+    if (this->_multipartImageMessages && message->type == WebXMessage::Image) {
+        auto imageMessage = std::static_pointer_cast<WebXImageMessage>(message);
+        frames = this->createImageMessageFrames(imageMessage);
+
+    } else if (this->_multipartImageMessages && message->type == WebXMessage::Subimages) {
+        auto subImagesMessage = std::static_pointer_cast<WebXSubImagesMessage>(message);
+        frames = this->createSubImagesMessageFrames(subImagesMessage);
+
+    } else {
+        frames.push_back(this->encode(message));
+    }
+
+    // With extended client addressing the recipients are given by a bitmap in a last frame, after the bufferLength bytes of the message
+    if (this->_recipientMaskWords > 0 && frames[0]->size() >= MESSAGE_HEADER_LENGTH) {
+        WebXBinaryBuffer::getMessageHeader((unsigned char *)frames[0]->data())->recipientMaskWords = this->_recipientMaskWords;
+        frames.push_back(this->createRecipientMaskFrame(message->clientIndexMask));
+    }
+
+    return frames;
+}
+
 zmq::message_t * WebXMessageEncoder::encode(std::shared_ptr<WebXMessage> message) const {
     switch (message->type) {
         case WebXMessage::Windows: {
@@ -84,7 +112,7 @@ zmq::message_t * WebXMessageEncoder::createCursorImageMessage(std::shared_ptr<We
     size_t dataSize = MESSAGE_HEADER_LENGTH + 28 + mouseCursorImage->getRawDataSize();
     zmq::message_t * output= new zmq::message_t(dataSize);
 
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(message->commandId);
     buffer.write<int32_t>(message->x);
     buffer.write<int32_t>(message->y);
@@ -105,7 +133,7 @@ zmq::message_t * WebXMessageEncoder::createImageMessage(std::shared_ptr<WebXImag
     size_t alphaDataSize = 0;
     if (image) {
         imageDataSize = image->getRawDataSize();
-        alphaDataSize = image->getAlphaDataSize();
+        alphaDataSize = message->getAlphaDataSize();
         depth = image->getDepth();
         strncpy(imageType, image->getFileExtension().c_str(), 4);
     }
@@ -113,7 +141,7 @@ zmq::message_t * WebXMessageEncoder::createImageMessage(std::shared_ptr<WebXImag
     size_t dataSize = MESSAGE_HEADER_LENGTH + 24 + imageDataSize + alphaDataSize;
     zmq::message_t * output= new zmq::message_t(dataSize);
 
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(message->commandId);
     buffer.write<uint32_t>(message->windowId);
     buffer.write<uint32_t>(depth);
@@ -137,7 +165,7 @@ zmq::message_t * WebXMessageEncoder::createMouseMessage(std::shared_ptr<WebXMous
     size_t dataSize = MESSAGE_HEADER_LENGTH + 16;
     zmq::message_t * output= new zmq::message_t(dataSize);
 
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(message->commandId);
     buffer.write<int32_t>(message->x);
     buffer.write<int32_t>(message->y);
@@ -151,7 +179,7 @@ zmq::message_t * WebXMessageEncoder::createScreenMessage(std::shared_ptr<WebXScr
 
     size_t dataSize = MESSAGE_HEADER_LENGTH + 36 + keyboardLayoutName.size();
     zmq::message_t * output= new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *) output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t) message->type);
+    WebXBinaryBuffer buffer((unsigned char *) output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t) message->type);
     buffer.write<uint32_t>(message->commandId);
     buffer.write<int32_t>(message->screenSize.width());
     buffer.write<int32_t>(message->screenSize.height());
@@ -182,7 +210,7 @@ zmq::message_t * WebXMessageEncoder::createSubImagesMessage(std::shared_ptr<WebX
     size_t dataSize = MESSAGE_HEADER_LENGTH + 12 + nImages * 32 + imageDataSize + alphaDataSize;
     zmq::message_t * output = new zmq::message_t(dataSize);
 
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(message->commandId);
     buffer.write<uint32_t>(message->windowId);
     buffer.write<uint32_t>(nImages);
@@ -210,6 +238,129 @@ zmq::message_t * WebXMessageEncoder::createSubImagesMessage(std::shared_ptr<WebX
 
 }
 
+std::vector<zmq::message_t *> WebXMessageEncoder::createImageMessageFrames(std::shared_ptr<WebXImageMessage> message) const {
+    std::shared_ptr<WebXImage> image = message->image;
+    size_t imageDataSize = 0;
+    unsigned int depth = 0;
+    char imageType[4] = "";
+    size_t alphaDataSize = 0;
+    if (image) {
+        imageDataSize = image->getRawDataSize();
+        alphaDataSize = message->getAlphaDataSize();
+        depth = image->getDepth();
+        strncpy(imageType, image->getFileExtension().c_str(), 4);
+    }
+
+    size_t headerFrameSize = MESSAGE_HEADER_LENGTH + 24;
+    size_t dataSize = headerFrameSize + imageDataSize + alphaDataSize;
+    std::vector<zmq::message_t *> frames;
+    zmq::message_t * headerFrame = new zmq::message_t(headerFrameSize);
+    frames.push_back(headerFrame);
+
+    // The buffer length of the header is the length of the full message
+    WebXBinaryBuffer buffer((unsigned char *)headerFrame->data(), headerFrameSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
+    buffer.getMessageHeader()->bufferLength = dataSize;
+    buffer.write<uint32_t>(message->commandId);
+    buffer.write<uint32_t>(message->windowId);
+    buffer.write<uint32_t>(depth);
+
+    buffer.append((unsigned char *)imageType, 4);
+
+    buffer.write<uint32_t>(imageDataSize);
+    buffer.write<uint32_t>(alphaDataSize);
+
+    if (imageDataSize) {
+        frames.push_back(createImageDataFrame(image, image->getRawData(), imageDataSize));
+    }
+    if (alphaDataSize) {
+        frames.push_back(createImageDataFrame(image, image->getAlphaData(), alphaDataSize));
+    }
+
+    return frames;
+}
+
+std::vector<zmq::message_t *> WebXMessageEncoder::createSubImagesMessageFrames(std::shared_ptr<WebXSubImagesMessage> message) const {
+    unsigned int nImages = message->images.size();
+    size_t imageDataSize = 0;
+    for (const WebXSubImage & subImage : message->images) {
+        size_t fullDataSize = subImage.image->getRawDataSize() + subImage.image->getAlphaDataSize();
+        imageDataSize += fullDataSize;
+        size_t alignmentOverflow = fullDataSize % 4;
+        if (alignmentOverflow != 0) {
+            imageDataSize += 4 - alignmentOverflow;
+        }
+    }
+
+    size_t headerFrameSize = MESSAGE_HEADER_LENGTH + 12;
+    size_t dataSize = headerFrameSize + nImages * 32 + imageDataSize;
+    std::vector<zmq::message_t *> frames;
+    zmq::message_t * headerFrame = new zmq::message_t(headerFrameSize);
+    frames.push_back(headerFrame);
+
+    // The buffer length of the header is the length of the full message
+    WebXBinaryBuffer buffer((unsigned char *)headerFrame->data(), headerFrameSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
+    buffer.getMessageHeader()->bufferLength = dataSize;
+    buffer.write<uint32_t>(message->commandId);
+    buffer.write<uint32_t>(message->windowId);
+    buffer.write<uint32_t>(nImages);
+
+    size_t padding = 0;
+    for (const WebXSubImage & subImage : message->images) {
+        size_t rawDataSize = subImage.image->getRawDataSize();
+        size_t alphaDataSize = subImage.image->getAlphaDataSize();
+
+        // The alignment padding of the previous subimage precedes the fields of this one
+        zmq::message_t * subImageFrame = new zmq::message_t(padding + 32);
+        frames.push_back(subImageFrame);
+        memset(subImageFrame->data(), 0, padding);
+
+        WebXBinaryBuffer subImageBuffer((unsigned char *)subImageFrame->data() + padding, 32);
+        subImageBuffer.write<int32_t>(subImage.imageRectangle.x());
+        subImageBuffer.write<int32_t>(subImage.imageRectangle.y());
+        subImageBuffer.write<int32_t>(subImage.imageRectangle.size().width());
+        subImageBuffer.write<int32_t>(subImage.imageRectangle.size().height());
+        subImageBuffer.write<uint32_t>(subImage.image->getDepth());
+
+        char imageType[4] = "";
+        strncpy(imageType, subImage.image->getFileExtension().c_str(), 4);
+        subImageBuffer.append((unsigned char *)imageType, 4);
+
+        subImageBuffer.write<uint32_t>(rawDataSize);
+        subImageBuffer.write<uint32_t>(alphaDataSize);
+
+        if (rawDataSize) {
+            frames.push_back(createImageDataFrame(subImage.image, subImage.image->getRawData(), rawDataSize));
+        }
+        if (alphaDataSize) {
+            frames.push_back(createImageDataFrame(subImage.image, subImage.image->getAlphaData(), alphaDataSize));
+        }
+
+        size_t alignmentOverflow = (rawDataSize + alphaDataSize) % 4;
+        padding = alignmentOverflow != 0 ? 4 - alignmentOverflow : 0;
+    }
+
+    if (padding) {
+        zmq::message_t * paddingFrame = new zmq::message_t(padding);
+        memset(paddingFrame->data(), 0, padding);
+        frames.push_back(paddingFrame);
+    }
+
+    return frames;
+}
+
+zmq::message_t * WebXMessageEncoder::createImageDataFrame(const std::shared_ptr<WebXImage> & image, unsigned char * data, size_t dataSize) {
+    return new zmq::message_t(data, dataSize, webx_releaseImageData, new std::shared_ptr<WebXImage>(image));
+}
+
+zmq::message_t * WebXMessageEncoder::createRecipientMaskFrame(const WebXClientIndexMask & clientIndexMask) const {
+    zmq::message_t * recipientMaskFrame = new zmq::message_t(this->_recipientMaskWords * sizeof(uint64_t));
+    uint64_t * recipientMask = (uint64_t *)recipientMaskFrame->data();
+    for (uint32_t i = 0; i < this->_recipientMaskWords; i++) {
+        recipientMask[i] = clientIndexMask.getWord(i);
+    }
+    return recipientMaskFrame;
+}
+
 zmq::message_t * WebXMessageEncoder::createWindowsMessage(std::shared_ptr<WebXWindowsMessage> message) const {
 
     std::vector<WebXWindowProperties> shapedWindows;
@@ -218,7 +369,7 @@ zmq::message_t * WebXMessageEncoder::createWindowsMessage(std::shared_ptr<WebXWi
 
     size_t dataSize = MESSAGE_HEADER_LENGTH + 4 + (4 + message->windows.size() * 20) + (4 + shapedWindows.size() * 4);
     zmq::message_t * output = new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(message->commandId);
 
     // Standard window properties
@@ -245,7 +396,7 @@ zmq::message_t * WebXMessageEncoder::createWindowsMessage(std::shared_ptr<WebXWi
 zmq::message_t * WebXMessageEncoder::createPingMessage(std::shared_ptr<WebXPingMessage> message) const {
     size_t dataSize = MESSAGE_HEADER_LENGTH;
     zmq::message_t * output = new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
 
     return output;
 }
@@ -253,7 +404,7 @@ zmq::message_t * WebXMessageEncoder::createPingMessage(std::shared_ptr<WebXPingM
 zmq::message_t * WebXMessageEncoder::createDisconnectMessage(std::shared_ptr<WebXDisconnectMessage> message) const {
     size_t dataSize = MESSAGE_HEADER_LENGTH;
     zmq::message_t * output = new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
 
     return output;
 }
@@ -261,7 +412,7 @@ zmq::message_t * WebXMessageEncoder::createDisconnectMessage(std::shared_ptr<Web
 zmq::message_t * WebXMessageEncoder::createQualityMessage(std::shared_ptr<WebXQualityMessage> message) const {
     size_t dataSize = MESSAGE_HEADER_LENGTH + 20;
     zmq::message_t * output = new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<int32_t>(message->quality.index);
     buffer.write<float>(message->quality.imageFPS);
     buffer.write<float>(message->quality.rgbQuality);
@@ -276,7 +427,7 @@ zmq::message_t * WebXMessageEncoder::createClipboardMessage(std::shared_ptr<WebX
 
     size_t dataSize = MESSAGE_HEADER_LENGTH + 4 + clipboardContent.size();
     zmq::message_t * output = new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(clipboardContent.size());
     buffer.append((unsigned char *)clipboardContent.c_str(), clipboardContent.size());
 
@@ -295,7 +446,7 @@ zmq::message_t * WebXMessageEncoder::createShapeMessage(std::shared_ptr<WebXShap
     size_t dataSize = MESSAGE_HEADER_LENGTH + 16 + stencilDataSize;
     zmq::message_t * output= new zmq::message_t(dataSize);
 
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(message->commandId);
     buffer.write<uint32_t>(message->windowId);
 
@@ -313,7 +464,7 @@ zmq::message_t * WebXMessageEncoder::createScreenResizeMessage(std::shared_ptr<W
     size_t dataSize = MESSAGE_HEADER_LENGTH + 8;
     zmq::message_t * output= new zmq::message_t(dataSize);
 
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<int32_t>(message->screenSize.width());
     buffer.write<int32_t>(message->screenSize.height());
 
@@ -325,7 +476,7 @@ zmq::message_t * WebXMessageEncoder::createKeyboardLayoutMessage(std::shared_ptr
 
     size_t dataSize = MESSAGE_HEADER_LENGTH + 4 + keyboardLayoutName.size();
     zmq::message_t * output = new zmq::message_t(dataSize);
-    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask, (uint32_t)message->type);
+    WebXBinaryBuffer buffer((unsigned char *)output->data(), dataSize, this->_sessionId, message->clientIndexMask.getWord(0), (uint32_t)message->type);
     buffer.write<uint32_t>(keyboardLayoutName.size());
     buffer.append((unsigned char *)keyboardLayoutName.c_str(), keyboardLayoutName.size());
 
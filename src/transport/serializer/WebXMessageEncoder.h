@@ -4,6 +4,7 @@
 #include <memory>
 #include <cstring>
 #include <array>
+#include <vector>
 
 namespace zmq {
 class message_t;
@@ -29,6 +30,8 @@ class WebXClipboardMessage;
 class WebXShapeMessage;
 class WebXScreenResizeMessage;
 class WebXKeyboardLayoutMessage;
+class WebXImage;
+class WebXClientIndexMask;
 
 class WebXMessageEncoder {
     public:
@@ -36,8 +39,12 @@ class WebXMessageEncoder {
      * Constructor
      * Initializes the encoder with a session ID.
      * @param sessionId: A 16-byte array representing the session ID.
+     * @param multipartImageMessages: Whether image data is sent without copy in separate frames.
+     * @param maxClients: The maximum number of clients: above 64 the recipients are sent in a bitmap (extended client addressing).
      */
-    WebXMessageEncoder(const std::array<unsigned char, 16> & sessionId) {
+    WebXMessageEncoder(const std::array<unsigned char, 16> & sessionId, bool multipartImageMessages = false, int maxClients = 64) :
+        _multipartImageMessages(multipartImageMessages),
+        _recipientMaskWords(maxClients > 64 ? (maxClients + 63) / 64 : 0) {
         memcpy(this->_sessionId, sessionId.data(), 16);
     }
 
@@ -54,6 +61,20 @@ class WebXMessageEncoder {
      */
     zmq::message_t * encode(std::shared_ptr<WebXMessage> message) const;
 
+    /*
+     * Encodes a WebXMessage into the frames of a multipart ZeroMQ message. If multipart image messages are enabled
+     * the encoded data of images is not copied: the frames reference the image buffers (the images are kept alive until
+     * the frames are released). Other messages are encoded in a single frame.
+     * With extended client addressing, a last frame contains the bitmap of the recipients (the first word being the
+     * client index mask of the header) and the number of words of the bitmap is set in the header.
+     * Frame order: the first frame always starts with the message header. The first bufferLength bytes (given by the
+     * header) of the concatenated frames have the same byte layout as the single-frame message, the recipient bitmap
+     * (recipientMaskWords * 8 bytes) follows: consumers must split the message on bufferLength rather than on frames.
+     * @param message: A shared pointer to the WebXMessage to encode.
+     * @return The frames of the encoded message (to be deleted by the caller).
+     */
+    std::vector<zmq::message_t *> encodeFrames(std::shared_ptr<WebXMessage> message) const;
+
 private:
 
     /*
@@ -100,6 +121,12 @@ private:
      */
     zmq::message_t * createImageMessage(std::shared_ptr<WebXImageMessage> message) const;
 
+    /*
+     * Multipart version of the image message: the header and content fields are sent in the first frame followed by
+     * the image data and alpha data frames.
+     */
+    std::vector<zmq::message_t *> createImageMessageFrames(std::shared_ptr<WebXImageMessage> message) const;
+
     /*
      * Structure:
      * Header: 48 bytes
@@ -171,6 +198,22 @@ private:
      */
     zmq::message_t * createSubImagesMessage(std::shared_ptr<WebXSubImagesMessage> message) const;
 
+    /*
+     * Multipart version of the subimages message: the header and content fields are sent in the first frame, each
+     * subimage is sent as a frame containing its fields (preceded by the alignment padding of the previous subimage)
+     * followed by the image data and alpha data frames. The final alignment padding is sent in a last frame.
+     */
+    std::vector<zmq::message_t *> createSubImagesMessageFrames(std::shared_ptr<WebXSubImagesMessage> message) const;
+
+    /*
+     * Creates a frame referencing encoded image data without copying it: the image is released with the frame.
+     * @param image: The image owning the data.
+     * @param data: The data of the frame.
+     * @param dataSize: The size of the data.
+     * @return The frame.
+     */
+    static zmq::message_t * createImageDataFrame(const std::shared_ptr<WebXImage> & image, unsigned char * data, size_t dataSize);
+
     /*
      * Structure:
      * Header: 48 bytes
@@ -309,9 +352,19 @@ private:
      */
     zmq::message_t * createKeyboardLayoutMessage(std::shared_ptr<WebXKeyboardLayoutMessage> message) const;
 
+    /*
+     * Creates the last frame of a message with extended client addressing (following the bufferLength bytes of the
+     * message).
+     * Structure:
+     *   recipientMask: 8 bytes for each word of the bitmap
+     */
+    zmq::message_t * createRecipientMaskFrame(const WebXClientIndexMask & clientIndexMask) const;
+
 private:
     const static int MESSAGE_HEADER_LENGTH = 48;
     unsigned char _sessionId[16];
+    bool _multipartImageMessages;
+    uint32_t _recipientMaskWords;
 };
 
 
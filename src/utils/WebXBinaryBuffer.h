@@ -43,7 +43,7 @@ public:
 		uint32_t messageTypeId;
 		uint32_t messageId;
 		uint32_t bufferLength;
-		char unused[4];
+		uint32_t recipientMaskWords; // Number of 64-bit words of the recipient bitmap frame (extended client addressing only)
 	} MessageHeader;
 
 
@@ -72,6 +72,7 @@ public:
 		messageHeader->messageTypeId = messageTypeId;
 		messageHeader->messageId = _messageCounter;
 		messageHeader->bufferLength = bufferLength;
+		messageHeader->recipientMaskWords = 0;
 	}
 
     WebXBinaryBuffer(unsigned char * buffer, size_t bufferLength) :
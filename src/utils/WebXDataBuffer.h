@@ -5,6 +5,7 @@
 #include <string>
 #include <stdio.h>
 #include <cstring>
+#include <functional>
 #include <crc32/Crc32.h>
 #include <spdlog/spdlog.h>
 
@@ -47,11 +48,31 @@ public:
     }
 
     /**
-     * Destructor. Frees the allocated buffer memory if it exists.
+     * Constructor that wraps an existing buffer whose memory is returned by a release function rather than freed.
+     * @param buffer Pointer to the existing buffer.
+     * @param capacity Capacity of the existing buffer.
+     * @param size Number of bytes stored in the buffer.
+     * @param releaseFunc Function called with the buffer and its capacity when the buffer is destroyed.
+     */
+    WebXDataBuffer(unsigned char * buffer, size_t capacity, size_t size, std::function<void(unsigned char *, size_t)> releaseFunc) :
+        _buffer(buffer),
+        _capacity(capacity),
+        _size(size),
+        _releaseFunc(releaseFunc) {
+
+    }
+
+    /**
+     * Destructor. Frees (or releases) the allocated buffer memory if it exists.
      */
     virtual ~WebXDataBuffer() {
         if (_buffer != 0) {
-            free (this->_buffer);
+            if (this->_releaseFunc) {
+                this->_releaseFunc(this->_buffer, this->_capacity);
+
+            } else {
+                free (this->_buffer);
+            }
             _buffer = 0;
         }
     }
@@ -160,6 +181,7 @@ private:
     unsigned char * _buffer;
     size_t _capacity;
     size_t _size;
+    std::function<void(unsigned char *, size_t)> _releaseFunc;
 };
 
 #endif /* WEBX_DATA_BUFFER_H */
\ No newline at end of file
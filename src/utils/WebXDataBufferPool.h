@@ -0,0 +1,129 @@
+#ifndef WEBX_DATA_BUFFER_POOL_H
+#define WEBX_DATA_BUFFER_POOL_H
+
+#include <stdlib.h>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include "WebXDataBuffer.h"
+
+/**
+ * @class WebXDataBufferPool
+ * @brief Thread-safe pool of memory blocks recycled between the buffers of encoded images.
+ *
+ * Blocks have a power-of-two capacity and are kept in one free list per capacity. Buffers created by the pool return
+ * their block to it when they are destroyed (possibly on another thread, once the image has been sent). The total
+ * capacity of the free blocks is limited: blocks released beyond the limit are freed.
+ */
+class WebXDataBufferPool : public std::enable_shared_from_this<WebXDataBufferPool> {
+private:
+    const static size_t MIN_CAPACITY_BITS = 12;
+    const static size_t MAX_CAPACITY_BITS = 40;
+
+public:
+    /**
+     * @brief Constructs a WebXDataBufferPool instance.
+     * @param maxFreeBytes The maximum total capacity of the free blocks kept for reuse.
+     */
+    WebXDataBufferPool(size_t maxFreeBytes) :
+        _maxFreeBytes(maxFreeBytes),
+        _freeBytes(0),
+        _freeBlocks(MAX_CAPACITY_BITS - MIN_CAPACITY_BITS + 1) {}
+
+    /**
+     * @brief Destructor. Frees all the free blocks.
+     */
+    virtual ~WebXDataBufferPool() {
+        for (std::vector<unsigned char *> & blocks : this->_freeBlocks) {
+            for (unsigned char * block : blocks) {
+                free(block);
+            }
+        }
+    }
+
+    /**
+     * @brief Obtains a block from the pool (or allocates a new one).
+     * @param minCapacity The minimum capacity of the block.
+     * @param capacity Set to the actual capacity of the block.
+     * @return The block or NULL if it could not be allocated.
+     */
+    unsigned char * acquire(size_t minCapacity, size_t & capacity) {
+        size_t capacityBits = MIN_CAPACITY_BITS;
+        while (((size_t)1 << capacityBits) < minCapacity && capacityBits < MAX_CAPACITY_BITS) {
+            capacityBits++;
+        }
+        capacity = (size_t)1 << capacityBits;
+
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            std::vector<unsigned char *> & blocks = this->_freeBlocks[capacityBits - MIN_CAPACITY_BITS];
+            if (!blocks.empty()) {
+                unsigned char * block = blocks.back();
+                blocks.pop_back();
+                this->_freeBytes -= capacity;
+                return block;
+            }
+        }
+
+        unsigned char * block = (unsigned char *)malloc(capacity);
+        if (block == NULL) {
+            spdlog::error("Failed to allocate {:d} bytes for data buffer pool", capacity);
+        }
+        return block;
+    }
+
+    /**
+     * @brief Returns a block to the pool (it is freed if the pool is full).
+     * @param block The block obtained from acquire.
+     * @param capacity The capacity of the block.
+     */
+    void release(unsigned char * block, size_t capacity) {
+        size_t capacityBits = MIN_CAPACITY_BITS;
+        while (((size_t)1 << capacityBits) < capacity && capacityBits < MAX_CAPACITY_BITS) {
+            capacityBits++;
+        }
+
+        if (((size_t)1 << capacityBits) == capacity) {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if (this->_freeBytes + capacity <= this->_maxFreeBytes) {
+                this->_freeBlocks[capacityBits - MIN_CAPACITY_BITS].push_back(block);
+                this->_freeBytes += capacity;
+                return;
+            }
+        }
+
+        free(block);
+    }
+
+    /**
+     * @brief Creates a WebXDataBuffer owning a block of the pool: the block is released to the pool when the buffer is
+     * destroyed. The pool must be owned by a shared pointer (it is kept alive by the buffer).
+     * @param block The block obtained from acquire.
+     * @param capacity The capacity of the block.
+     * @param size The number of bytes stored in the block.
+     * @return The data buffer.
+     */
+    WebXDataBuffer * createBuffer(unsigned char * block, size_t capacity, size_t size) {
+        std::shared_ptr<WebXDataBufferPool> pool = this->shared_from_this();
+        return new WebXDataBuffer(block, capacity, size, [pool](unsigned char * buffer, size_t bufferCapacity) {
+            pool->release(buffer, bufferCapacity);
+        });
+    }
+
+    /**
+     * @brief Gets the total capacity of the free blocks.
+     * @return The number of bytes kept for reuse.
+     */
+    size_t getFreeBytes() {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_freeBytes;
+    }
+
+private:
+    size_t _maxFreeBytes;
+    size_t _freeBytes;
+    std::vector<std::vector<unsigned char *>> _freeBlocks;
+    std::mutex _mutex;
+};
+
+#endif /* WEBX_DATA_BUFFER_POOL_H */
@@ -0,0 +1,72 @@
+#ifndef WEBX_EVENT_NOTIFIER_H
+#define WEBX_EVENT_NOTIFIER_H
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <spdlog/spdlog.h>
+
+/**
+ * @class WebXEventNotifier
+ * @brief Wraps a Linux eventfd used to wake a thread blocked in poll from another thread (or a signal handler).
+ */
+class WebXEventNotifier {
+public:
+    /**
+     * @brief Constructs a WebXEventNotifier instance and creates the (non-blocking) eventfd.
+     */
+    WebXEventNotifier() :
+        _fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (this->_fd < 0) {
+            spdlog::error("Failed to create eventfd: the controller will not be woken by client instructions");
+        }
+    }
+
+    /**
+     * @brief Destructor. Closes the eventfd.
+     */
+    virtual ~WebXEventNotifier() {
+        if (this->_fd >= 0) {
+            close(this->_fd);
+        }
+    }
+
+    /**
+     * @brief Gets the file descriptor to poll: it is readable once notify has been called.
+     * @return The eventfd file descriptor (negative if it could not be created).
+     */
+    int getFd() const {
+        return this->_fd;
+    }
+
+    /**
+     * @brief Signals the eventfd, waking any thread polling it. Async-signal-safe.
+     */
+    void notify() const {
+        if (this->_fd >= 0) {
+            uint64_t value = 1;
+            ssize_t ret = write(this->_fd, &value, sizeof(value));
+            (void)ret;
+        }
+    }
+
+    /**
+     * @brief Clears all pending notifications.
+     */
+    void reset() const {
+        if (this->_fd >= 0) {
+            uint64_t value;
+            ssize_t ret = read(this->_fd, &value, sizeof(value));
+            (void)ret;
+        }
+    }
+
+private:
+    WebXEventNotifier(const WebXEventNotifier &) = delete;
+    WebXEventNotifier & operator=(const WebXEventNotifier &) = delete;
+
+private:
+    int _fd;
+};
+
+#endif /* WEBX_EVENT_NOTIFIER_H */
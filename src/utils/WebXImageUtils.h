@@ -2,6 +2,9 @@
 #define WEBX_IMAGE_UTILS_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "WebXPixelKernels.h"
 
 /**
  * Counts the number of transparent pixels in the given image data.
@@ -12,46 +15,7 @@
  * @return The number of transparent pixels.
  */
 inline int webx_countTransparentPixels(const u_int32_t * data, size_t length, bool exitOnFound = false) {
-
-    int alphaCount = 0;
-
-    const u_int32_t * current = data;
-
-    // enabling optimization (at least -O2) automatically unrolls the inner for-loop
-    const size_t Unroll = 4;
-    const size_t PixelsAtOnce = 4 * Unroll;
-    const u_int32_t mask = 0xFF000000;
-
-    size_t remaining = length;
-    bool exit = false;
-
-    while (remaining >= PixelsAtOnce && !exit) {
-        for (size_t unrolling = 0; unrolling < Unroll; unrolling++) {
-
-            u_int32_t one   = *current++;
-            u_int32_t two   = *current++;
-            u_int32_t three = *current++;
-            u_int32_t four  = *current++;
-
-            alphaCount += (one & mask) != mask;
-            alphaCount += (two & mask) != mask;
-            alphaCount += (three & mask) != mask;
-            alphaCount += (four & mask) != mask;
-
-            exit = alphaCount > 0 && exitOnFound;
-        }
-
-        remaining -= PixelsAtOnce;
-    }
-
-    // remaining 1 to 15 uint32
-    while (remaining-- != 0 && !exit) {
-        u_int32_t value  = *current++;
-        alphaCount += (value & mask) != mask;
-        exit = alphaCount > 0 && exitOnFound;
-    }
-
-    return alphaCount;
+    return WebXPixelKernels::Get().countTransparentPixels(data, length, exitOnFound);
 }
 
 /**
@@ -61,43 +25,100 @@ inline int webx_countTransparentPixels(const u_int32_t * data, size_t length, bo
  * @param length The number of pixels in the image.
  */
 inline void webx_convertToAlpha(u_int32_t * data, size_t length) {
+    // Vectorised when supported by the CPU (check testAlphaCreate)
+    WebXPixelKernels::Get().convertToAlpha(data, length);
+}
 
-    u_int32_t * src = data;
-    u_int32_t * dst = data;
+/**
+ * Calculates a fast (non-cryptographic) 64-bit hash of raw image data, used to detect unchanged pixels
+ * before encoding. Uses four independent accumulators (xxHash64 rounds) to process 32 bytes per iteration.
+ * 
+ * @param data Pointer to the image data.
+ * @param length The number of bytes of image data.
+ * @return The hash of the data (never 0, which is reserved for "no checksum").
+ */
+inline uint64_t webx_calculatePixelChecksum(const unsigned char * data, size_t length) {
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t prime3 = 0x165667B19E3779F9ULL;
+
+    auto round = [prime1, prime2](uint64_t accumulator, uint64_t value) {
+        accumulator += value * prime2;
+        accumulator = (accumulator << 31) | (accumulator >> 33);
+        return accumulator * prime1;
+    };
+
+    uint64_t lane1 = prime1 + prime2;
+    uint64_t lane2 = prime2;
+    uint64_t lane3 = 0;
+    uint64_t lane4 = -prime1;
+
+    const unsigned char * current = data;
+    size_t remaining = length;
 
-    // enabling optimization (at least -O2) automatically unrolls the inner for-loop
-    const size_t Unroll = 4;
-    const size_t PixelsAtOnce = 4 * Unroll;
-    const u_int32_t mask = 0xFF000000;
+    while (remaining >= 32) {
+        uint64_t values[4];
+        memcpy(values, current, 32);
 
-    size_t remaining = length;
+        lane1 = round(lane1, values[0]);
+        lane2 = round(lane2, values[1]);
+        lane3 = round(lane3, values[2]);
+        lane4 = round(lane4, values[3]);
 
-    while (remaining >= PixelsAtOnce) {
-        for (size_t unrolling = 0; unrolling < Unroll; unrolling++) {
+        current += 32;
+        remaining -= 32;
+    }
 
-            *dst++ = *src++ & mask;
-            *dst++ = *src++ & mask;
-            *dst++ = *src++ & mask;
-            *dst++ = *src++ & mask;
-        }
+    uint64_t hash = ((lane1 << 1) | (lane1 >> 63)) + ((lane2 << 7) | (lane2 >> 57)) + ((lane3 << 12) | (lane3 >> 52)) + ((lane4 << 18) | (lane4 >> 46));
+    hash += length;
 
-        remaining -= PixelsAtOnce;
+    // remaining 0 to 31 bytes
+    while (remaining >= 8) {
+        uint64_t value;
+        memcpy(&value, current, 8);
+        hash = round(hash, value);
+        current += 8;
+        remaining -= 8;
     }
 
-    // remaining 1 to 15 uint32
     while (remaining-- != 0) {
-        *dst++ = *src++ & mask;
+        hash = (hash ^ (*current++ * prime3)) * prime1;
     }
 
-    // slow (check testAlphaCreate)
-    // Simple pixel iteration test completed: 1000 iterations in 297582.459000ms, 297.582459us / iteration for 6890KB
-    // Loop unrolling test completed: 1000 iterations in 38340.459000ms, 38.340459us / iteration for 6890KB
-    // u_int32_t * pixel = (u_int32_t *)data;
-    // for (int i = 0; i < length; i++) {
-    //     *pixel = (*pixel & 0xFF000000);
-    //     pixel++;
-    // }
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+
+    return hash == 0 ? 1 : hash;
+}
+
+/**
+ * Calculates a 64-bit hash of a rectangular area (eg a tile) of strided image data by combining the hashes of each row.
+ * 
+ * @param data Pointer to the image data.
+ * @param bytesPerLine The number of bytes between the start of two consecutive lines of the image.
+ * @param bytesPerPixel The number of bytes of each pixel.
+ * @param x The x position of the area in the image.
+ * @param y The y position of the area in the image.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ * @return The hash of the area (never 0, which is reserved for "no checksum").
+ */
+inline uint64_t webx_calculateAreaChecksum(const unsigned char * data, int bytesPerLine, int bytesPerPixel, int x, int y, int width, int height) {
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+
+    uint64_t hash = ((uint64_t)width << 32) | (uint64_t)height;
+    const unsigned char * row = data + (size_t)y * bytesPerLine + (size_t)x * bytesPerPixel;
+    for (int i = 0; i < height; i++) {
+        hash = (hash ^ webx_calculatePixelChecksum(row, (size_t)width * bytesPerPixel)) * prime1;
+        hash = (hash << 27) | (hash >> 37);
+        row += bytesPerLine;
+    }
 
+    return hash == 0 ? 1 : hash;
 }
 
 #endif /* WEBX_IMAGE_UTILS_H */
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef WEBX_LOCK_FREE_QUEUE_H
+#define WEBX_LOCK_FREE_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+/**
+ * @class WebXLockFreeQueue
+ * @brief Unbounded lock-free FIFO queue for multiple producers and a single consumer.
+ *
+ * Producers link a new node to the head of the list with a single atomic exchange: a push never waits for another
+ * thread. The consumer removes nodes from the tail (a stub node is always present so that head and tail never
+ * share a node being modified). A pop can transiently fail while a producer is between the exchange and the link of
+ * its node: the item becomes visible once the producer completes the push.
+ */
+template<typename ItemType>
+class WebXLockFreeQueue {
+private:
+    struct Node {
+        Node() :
+            next(nullptr) {}
+        Node(const ItemType & item) :
+            next(nullptr),
+            item(item) {}
+
+        std::atomic<Node *> next;
+        ItemType item;
+    };
+
+public:
+    /**
+     * @brief Constructs an empty queue.
+     */
+    WebXLockFreeQueue() {
+        Node * stub = new Node();
+        this->_head.store(stub, std::memory_order_relaxed);
+        this->_tail = stub;
+    }
+
+    /**
+     * @brief Destructor. Deletes the remaining items. Must not be called while items are being pushed.
+     */
+    virtual ~WebXLockFreeQueue() {
+        ItemType item;
+        while (this->pop(item)) {}
+        delete this->_tail;
+    }
+
+    /**
+     * @brief Adds an item at the end of the queue. Can be called concurrently by any number of producers.
+     * @param item The item to add.
+     */
+    void push(const ItemType & item) {
+        Node * node = new Node(item);
+        Node * previous = this->_head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Removes the item at the front of the queue. Must only be called by the consumer thread.
+     * @param item Set to the removed item.
+     * @return True if an item has been removed, false if the queue is empty.
+     */
+    bool pop(ItemType & item) {
+        Node * tail = this->_tail;
+        Node * next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+
+        // The next node becomes the stub: its item is moved out to release it as soon as possible
+        item = std::move(next->item);
+        next->item = ItemType();
+        this->_tail = next;
+        delete tail;
+
+        return true;
+    }
+
+private:
+    WebXLockFreeQueue(const WebXLockFreeQueue &) = delete;
+    WebXLockFreeQueue & operator=(const WebXLockFreeQueue &) = delete;
+
+private:
+    std::atomic<Node *> _head;
+    Node * _tail;
+};
+
+#endif /* WEBX_LOCK_FREE_QUEUE_H */
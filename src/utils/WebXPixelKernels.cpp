@@ -0,0 +1,424 @@
+#include "WebXPixelKernels.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WEBX_PIXEL_KERNELS_X86
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define WEBX_PIXEL_KERNELS_NEON
+#endif
+
+namespace {
+
+const u_int32_t ALPHA_MASK = 0xFF000000;
+
+/*
+ * Scalar reference implementations
+ */
+
+int countTransparentPixelsScalar(const u_int32_t * data, size_t length, bool exitOnFound) {
+    int alphaCount = 0;
+
+    const u_int32_t * current = data;
+
+    // enabling optimization (at least -O2) automatically unrolls the inner for-loop
+    const size_t Unroll = 4;
+    const size_t PixelsAtOnce = 4 * Unroll;
+
+    size_t remaining = length;
+    bool exit = false;
+
+    while (remaining >= PixelsAtOnce && !exit) {
+        for (size_t unrolling = 0; unrolling < Unroll; unrolling++) {
+
+            u_int32_t one   = *current++;
+            u_int32_t two   = *current++;
+            u_int32_t three = *current++;
+            u_int32_t four  = *current++;
+
+            alphaCount += (one & ALPHA_MASK) != ALPHA_MASK;
+            alphaCount += (two & ALPHA_MASK) != ALPHA_MASK;
+            alphaCount += (three & ALPHA_MASK) != ALPHA_MASK;
+            alphaCount += (four & ALPHA_MASK) != ALPHA_MASK;
+
+            exit = alphaCount > 0 && exitOnFound;
+        }
+
+        remaining -= PixelsAtOnce;
+    }
+
+    // remaining 1 to 15 uint32
+    while (remaining-- != 0 && !exit) {
+        u_int32_t value  = *current++;
+        alphaCount += (value & ALPHA_MASK) != ALPHA_MASK;
+        exit = alphaCount > 0 && exitOnFound;
+    }
+
+    return alphaCount;
+}
+
+void convertToAlphaScalar(u_int32_t * data, size_t length) {
+    u_int32_t * src = data;
+    u_int32_t * dst = data;
+
+    // enabling optimization (at least -O2) automatically unrolls the inner for-loop
+    const size_t Unroll = 4;
+    const size_t PixelsAtOnce = 4 * Unroll;
+
+    size_t remaining = length;
+
+    while (remaining >= PixelsAtOnce) {
+        for (size_t unrolling = 0; unrolling < Unroll; unrolling++) {
+
+            *dst++ = *src++ & ALPHA_MASK;
+            *dst++ = *src++ & ALPHA_MASK;
+            *dst++ = *src++ & ALPHA_MASK;
+            *dst++ = *src++ & ALPHA_MASK;
+        }
+
+        remaining -= PixelsAtOnce;
+    }
+
+    // remaining 1 to 15 uint32
+    while (remaining-- != 0) {
+        *dst++ = *src++ & ALPHA_MASK;
+    }
+}
+
+void makeOpaqueScalar(u_int32_t * data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        data[i] |= ALPHA_MASK;
+    }
+}
+
+void convertCursorPixelsScalar(const unsigned long * src, unsigned char * dst, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint32_t p = src[i];
+        uint8_t r = p >> 0;
+        uint8_t g = p >> 8;
+        uint8_t b = p >> 16;
+        uint8_t a = p >> 24;
+
+        if (a > 0x00 && a < 0xff) {
+            r = (r * 0xff + a / 2) / a;
+            g = (g * 0xff + a / 2) / a;
+            b = (b * 0xff + a / 2) / a;
+        }
+
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        dst[3] = a;
+        dst += 4;
+    }
+}
+
+#ifdef WEBX_PIXEL_KERNELS_X86
+
+/*
+ * SSE2 implementations (4 pixels per register)
+ */
+
+__attribute__((target("sse2")))
+int countTransparentPixelsSSE2(const u_int32_t * data, size_t length, bool exitOnFound) {
+    const __m128i mask = _mm_set1_epi32((int)ALPHA_MASK);
+    int alphaCount = 0;
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i * src = (const __m128i *)(data + i);
+        int opaque0 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(src + 0), mask), mask)));
+        int opaque1 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(src + 1), mask), mask)));
+        int opaque2 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(src + 2), mask), mask)));
+        int opaque3 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(src + 3), mask), mask)));
+
+        alphaCount += 16 - __builtin_popcount(opaque0 | (opaque1 << 4) | (opaque2 << 8) | (opaque3 << 12));
+        if (alphaCount > 0 && exitOnFound) {
+            return alphaCount;
+        }
+    }
+
+    return alphaCount + countTransparentPixelsScalar(data + i, length - i, exitOnFound);
+}
+
+__attribute__((target("sse2")))
+void convertToAlphaSSE2(u_int32_t * data, size_t length) {
+    const __m128i mask = _mm_set1_epi32((int)ALPHA_MASK);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m128i * pixels = (__m128i *)(data + i);
+        _mm_storeu_si128(pixels + 0, _mm_and_si128(_mm_loadu_si128(pixels + 0), mask));
+        _mm_storeu_si128(pixels + 1, _mm_and_si128(_mm_loadu_si128(pixels + 1), mask));
+    }
+
+    convertToAlphaScalar(data + i, length - i);
+}
+
+__attribute__((target("sse2")))
+void makeOpaqueSSE2(u_int32_t * data, size_t length) {
+    const __m128i mask = _mm_set1_epi32((int)ALPHA_MASK);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m128i * pixels = (__m128i *)(data + i);
+        _mm_storeu_si128(pixels + 0, _mm_or_si128(_mm_loadu_si128(pixels + 0), mask));
+        _mm_storeu_si128(pixels + 1, _mm_or_si128(_mm_loadu_si128(pixels + 1), mask));
+    }
+
+    makeOpaqueScalar(data + i, length - i);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse2")))
+void convertCursorPixelsSSE2(const unsigned long * src, unsigned char * dst, size_t length) {
+    const __m128i greenAlphaMask = _mm_set1_epi32((int)0xFF00FF00);
+    const __m128i lowByteMask = _mm_set1_epi32(0x000000FF);
+    const __m128i opaqueAlpha = _mm_set1_epi32(0xFF);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        // Keep the low 32 bits of each unsigned long
+        __m128i low = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(src + i)), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i high = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(src + i + 2)), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i pixels = _mm_unpacklo_epi64(low, high);
+
+        // Translucent pixels need to be un-premultiplied (division by alpha): use the scalar version
+        __m128i alpha = _mm_srli_epi32(pixels, 24);
+        __m128i isOpaqueOrTransparent = _mm_or_si128(_mm_cmpeq_epi32(alpha, zero), _mm_cmpeq_epi32(alpha, opaqueAlpha));
+        if (_mm_movemask_epi8(isOpaqueOrTransparent) != 0xFFFF) {
+            convertCursorPixelsScalar(src + i, dst + i * 4, 4);
+            continue;
+        }
+
+        // Swap the red and blue channels
+        __m128i swapped = _mm_or_si128(_mm_and_si128(pixels, greenAlphaMask),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), lowByteMask), _mm_slli_epi32(_mm_and_si128(pixels, lowByteMask), 16)));
+        _mm_storeu_si128((__m128i *)(dst + i * 4), swapped);
+    }
+
+    convertCursorPixelsScalar(src + i, dst + i * 4, length - i);
+}
+#endif
+
+/*
+ * AVX2 implementations (8 pixels per register)
+ */
+
+__attribute__((target("avx2")))
+int countTransparentPixelsAVX2(const u_int32_t * data, size_t length, bool exitOnFound) {
+    const __m256i mask = _mm256_set1_epi32((int)ALPHA_MASK);
+    int alphaCount = 0;
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i * src = (const __m256i *)(data + i);
+        unsigned int opaque0 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256(src + 0), mask), mask)));
+        unsigned int opaque1 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256(src + 1), mask), mask)));
+        unsigned int opaque2 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256(src + 2), mask), mask)));
+        unsigned int opaque3 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256(src + 3), mask), mask)));
+
+        alphaCount += 32 - __builtin_popcount(opaque0 | (opaque1 << 8) | (opaque2 << 16) | (opaque3 << 24));
+        if (alphaCount > 0 && exitOnFound) {
+            return alphaCount;
+        }
+    }
+
+    return alphaCount + countTransparentPixelsScalar(data + i, length - i, exitOnFound);
+}
+
+__attribute__((target("avx2")))
+void convertToAlphaAVX2(u_int32_t * data, size_t length) {
+    const __m256i mask = _mm256_set1_epi32((int)ALPHA_MASK);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256i * pixels = (__m256i *)(data + i);
+        _mm256_storeu_si256(pixels + 0, _mm256_and_si256(_mm256_loadu_si256(pixels + 0), mask));
+        _mm256_storeu_si256(pixels + 1, _mm256_and_si256(_mm256_loadu_si256(pixels + 1), mask));
+    }
+
+    convertToAlphaScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+void makeOpaqueAVX2(u_int32_t * data, size_t length) {
+    const __m256i mask = _mm256_set1_epi32((int)ALPHA_MASK);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256i * pixels = (__m256i *)(data + i);
+        _mm256_storeu_si256(pixels + 0, _mm256_or_si256(_mm256_loadu_si256(pixels + 0), mask));
+        _mm256_storeu_si256(pixels + 1, _mm256_or_si256(_mm256_loadu_si256(pixels + 1), mask));
+    }
+
+    makeOpaqueScalar(data + i, length - i);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+void convertCursorPixelsAVX2(const unsigned long * src, unsigned char * dst, size_t length) {
+    const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i greenAlphaMask = _mm256_set1_epi32((int)0xFF00FF00);
+    const __m256i lowByteMask = _mm256_set1_epi32(0x000000FF);
+    const __m256i opaqueAlpha = _mm256_set1_epi32(0xFF);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        // Keep the low 32 bits of each unsigned long
+        __m256i low = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(src + i)), lowHalves);
+        __m256i high = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(src + i + 4)), lowHalves);
+        __m256i pixels = _mm256_permute2x128_si256(low, high, 0x20);
+
+        // Translucent pixels need to be un-premultiplied (division by alpha): use the scalar version
+        __m256i alpha = _mm256_srli_epi32(pixels, 24);
+        __m256i isOpaqueOrTransparent = _mm256_or_si256(_mm256_cmpeq_epi32(alpha, zero), _mm256_cmpeq_epi32(alpha, opaqueAlpha));
+        if ((unsigned int)_mm256_movemask_epi8(isOpaqueOrTransparent) != 0xFFFFFFFF) {
+            convertCursorPixelsScalar(src + i, dst + i * 4, 8);
+            continue;
+        }
+
+        // Swap the red and blue channels
+        __m256i swapped = _mm256_or_si256(_mm256_and_si256(pixels, greenAlphaMask),
+            _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), lowByteMask), _mm256_slli_epi32(_mm256_and_si256(pixels, lowByteMask), 16)));
+        _mm256_storeu_si256((__m256i *)(dst + i * 4), swapped);
+    }
+
+    convertCursorPixelsScalar(src + i, dst + i * 4, length - i);
+}
+#endif
+
+#endif /* WEBX_PIXEL_KERNELS_X86 */
+
+#ifdef WEBX_PIXEL_KERNELS_NEON
+
+/*
+ * NEON implementations (4 pixels per register)
+ */
+
+int countTransparentPixelsNEON(const u_int32_t * data, size_t length, bool exitOnFound) {
+    const uint32x4_t mask = vdupq_n_u32(ALPHA_MASK);
+    int alphaCount = 0;
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        // Opaque lanes are all ones: shifting gives 1 per opaque pixel
+        uint32x4_t opaque = vshrq_n_u32(vceqq_u32(vandq_u32(vld1q_u32(data + i + 0), mask), mask), 31);
+        opaque = vaddq_u32(opaque, vshrq_n_u32(vceqq_u32(vandq_u32(vld1q_u32(data + i + 4), mask), mask), 31));
+        opaque = vaddq_u32(opaque, vshrq_n_u32(vceqq_u32(vandq_u32(vld1q_u32(data + i + 8), mask), mask), 31));
+        opaque = vaddq_u32(opaque, vshrq_n_u32(vceqq_u32(vandq_u32(vld1q_u32(data + i + 12), mask), mask), 31));
+
+        alphaCount += 16 - vaddvq_u32(opaque);
+        if (alphaCount > 0 && exitOnFound) {
+            return alphaCount;
+        }
+    }
+
+    return alphaCount + countTransparentPixelsScalar(data + i, length - i, exitOnFound);
+}
+
+void convertToAlphaNEON(u_int32_t * data, size_t length) {
+    const uint32x4_t mask = vdupq_n_u32(ALPHA_MASK);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        vst1q_u32(data + i + 0, vandq_u32(vld1q_u32(data + i + 0), mask));
+        vst1q_u32(data + i + 4, vandq_u32(vld1q_u32(data + i + 4), mask));
+    }
+
+    convertToAlphaScalar(data + i, length - i);
+}
+
+void makeOpaqueNEON(u_int32_t * data, size_t length) {
+    const uint32x4_t mask = vdupq_n_u32(ALPHA_MASK);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        vst1q_u32(data + i + 0, vorrq_u32(vld1q_u32(data + i + 0), mask));
+        vst1q_u32(data + i + 4, vorrq_u32(vld1q_u32(data + i + 4), mask));
+    }
+
+    makeOpaqueScalar(data + i, length - i);
+}
+
+void convertCursorPixelsNEON(const unsigned long * src, unsigned char * dst, size_t length) {
+    const uint32x4_t greenAlphaMask = vdupq_n_u32(0xFF00FF00);
+    const uint32x4_t lowByteMask = vdupq_n_u32(0x000000FF);
+    const uint32x4_t opaqueAlpha = vdupq_n_u32(0xFF);
+    const uint32x4_t zero = vdupq_n_u32(0);
+
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        // Keep the low 32 bits of each unsigned long
+        const uint64_t * src64 = (const uint64_t *)(src + i);
+        uint32x4_t pixels = vcombine_u32(vmovn_u64(vld1q_u64(src64)), vmovn_u64(vld1q_u64(src64 + 2)));
+
+        // Translucent pixels need to be un-premultiplied (division by alpha): use the scalar version
+        uint32x4_t alpha = vshrq_n_u32(pixels, 24);
+        uint32x4_t isOpaqueOrTransparent = vorrq_u32(vceqq_u32(alpha, zero), vceqq_u32(alpha, opaqueAlpha));
+        if (vminvq_u32(isOpaqueOrTransparent) == 0) {
+            convertCursorPixelsScalar(src + i, dst + i * 4, 4);
+            continue;
+        }
+
+        // Swap the red and blue channels
+        uint32x4_t swapped = vorrq_u32(vandq_u32(pixels, greenAlphaMask),
+            vorrq_u32(vandq_u32(vshrq_n_u32(pixels, 16), lowByteMask), vshlq_n_u32(vandq_u32(pixels, lowByteMask), 16)));
+        vst1q_u32((uint32_t *)(dst + i * 4), swapped);
+    }
+
+    convertCursorPixelsScalar(src + i, dst + i * 4, length - i);
+}
+
+#endif /* WEBX_PIXEL_KERNELS_NEON */
+
+const WebXPixelKernels SCALAR_KERNELS = {"scalar", countTransparentPixelsScalar, convertToAlphaScalar, makeOpaqueScalar, convertCursorPixelsScalar};
+
+#ifdef WEBX_PIXEL_KERNELS_X86
+#if defined(__x86_64__)
+const WebXPixelKernels SSE2_KERNELS = {"sse2", countTransparentPixelsSSE2, convertToAlphaSSE2, makeOpaqueSSE2, convertCursorPixelsSSE2};
+const WebXPixelKernels AVX2_KERNELS = {"avx2", countTransparentPixelsAVX2, convertToAlphaAVX2, makeOpaqueAVX2, convertCursorPixelsAVX2};
+#else
+// 32-bit: cursor pixels are 4-byte unsigned longs, keep the scalar conversion
+const WebXPixelKernels SSE2_KERNELS = {"sse2", countTransparentPixelsSSE2, convertToAlphaSSE2, makeOpaqueSSE2, convertCursorPixelsScalar};
+const WebXPixelKernels AVX2_KERNELS = {"avx2", countTransparentPixelsAVX2, convertToAlphaAVX2, makeOpaqueAVX2, convertCursorPixelsScalar};
+#endif
+#endif
+
+#ifdef WEBX_PIXEL_KERNELS_NEON
+const WebXPixelKernels NEON_KERNELS = {"neon", countTransparentPixelsNEON, convertToAlphaNEON, makeOpaqueNEON, convertCursorPixelsNEON};
+#endif
+
+}
+
+std::vector<const WebXPixelKernels *> WebXPixelKernels::GetAvailable() {
+    std::vector<const WebXPixelKernels *> kernels;
+    kernels.push_back(&SCALAR_KERNELS);
+
+#ifdef WEBX_PIXEL_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back(&SSE2_KERNELS);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(&AVX2_KERNELS);
+    }
+#endif
+
+#ifdef WEBX_PIXEL_KERNELS_NEON
+    kernels.push_back(&NEON_KERNELS);
+#endif
+
+    return kernels;
+}
+
+const WebXPixelKernels & WebXPixelKernels::Get() {
+    // The last available kernels use the widest instruction set
+    static const WebXPixelKernels & kernels = *GetAvailable().back();
+    return kernels;
+}
@@ -0,0 +1,69 @@
+#ifndef WEBX_PIXEL_KERNELS_H
+#define WEBX_PIXEL_KERNELS_H
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * @class WebXPixelKernels
+ * @brief Table of the pixel processing functions applied to every grabbed frame (or cursor image), for a given instruction set.
+ *
+ * Scalar implementations are always available and are the reference for the vectorised ones (SSE2, AVX2 on x86, NEON on ARM).
+ * The best implementation supported by the CPU is selected at runtime the first time the kernels are used.
+ */
+class WebXPixelKernels {
+public:
+    /**
+     * @brief Counts the pixels (32bpp) that are not fully opaque.
+     * @param data Pointer to the pixels.
+     * @param length The number of pixels.
+     * @param exitOnFound If true, the count can stop as soon as a transparent pixel is found (the result is then only non-zero).
+     * @return The number of transparent pixels.
+     */
+    typedef int (*CountTransparentPixelsFunc)(const u_int32_t * data, size_t length, bool exitOnFound);
+
+    /**
+     * @brief Keeps only the alpha channel of the pixels (32bpp), in place.
+     * @param data Pointer to the pixels.
+     * @param length The number of pixels.
+     */
+    typedef void (*ConvertToAlphaFunc)(u_int32_t * data, size_t length);
+
+    /**
+     * @brief Sets the alpha channel of the pixels (32bpp) to fully opaque, in place.
+     * @param data Pointer to the pixels.
+     * @param length The number of pixels.
+     */
+    typedef void (*MakeOpaqueFunc)(u_int32_t * data, size_t length);
+
+    /**
+     * @brief Converts XFixes cursor pixels (premultiplied ARGB stored in unsigned longs) to un-premultiplied 32bpp pixels
+     * with the red and blue channels swapped.
+     * @param src Pointer to the cursor pixels.
+     * @param dst Pointer to the destination pixels (4 bytes per pixel).
+     * @param length The number of pixels.
+     */
+    typedef void (*ConvertCursorPixelsFunc)(const unsigned long * src, unsigned char * dst, size_t length);
+
+public:
+    /**
+     * @brief Gets the kernels of the best instruction set supported by the CPU.
+     * @return The selected kernels.
+     */
+    static const WebXPixelKernels & Get();
+
+    /**
+     * @brief Gets the kernels of all the instruction sets supported by the CPU, starting with the scalar reference.
+     * @return The available kernels.
+     */
+    static std::vector<const WebXPixelKernels *> GetAvailable();
+
+    const char * name;
+    CountTransparentPixelsFunc countTransparentPixels;
+    ConvertToAlphaFunc convertToAlpha;
+    MakeOpaqueFunc makeOpaque;
+    ConvertCursorPixelsFunc convertCursorPixels;
+};
+
+#endif /* WEBX_PIXEL_KERNELS_H */
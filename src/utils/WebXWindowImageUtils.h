@@ -76,12 +76,10 @@ inline bool makeOpaque(XImage * image, WebXRectangle * mainWindowRectangle, WebX
     int width = endX - startX;
     int height = endY - startY;
 
+    const WebXPixelKernels & kernels = WebXPixelKernels::Get();
     for (int j = startY; j < endY; j++) {
         u_int32_t * data = (u_int32_t *)image->data + (j * image->width) + startX;
-        for (int i = startX; i < endX; i++) {
-            *data = *data | 0xFF000000;
-            data++;
-        }
+        kernels.makeOpaque(data, width);
     }
 
     std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
@@ -1,7 +1,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <chrono>
+#include <string.h>
+#include <vector>
 #include <utils/WebXImageUtils.h>
+#include <utils/WebXPixelKernels.h>
 
 
 int calcTransparentPixels(u_int32_t * data, size_t length) {
@@ -118,6 +121,67 @@ int main() {
     printf("Transparent count = %d in %d iterations\n", hasAlpha / nIter, nIter);
     printf("ImageUtils test completed: %d iterations in %fms, %fus / iteration for %luKB\n", nIter, cummulativeTimeUs, (cummulativeTimeUs / nIter), byteSize / 1024);
 
+    // Benchmark and cross-verify every available kernel against the scalar reference
+    int errors = 0;
+    std::vector<const WebXPixelKernels *> kernels = WebXPixelKernels::GetAvailable();
+    const WebXPixelKernels * reference = kernels[0];
+    for (const WebXPixelKernels * kernel : kernels) {
+        start = std::chrono::high_resolution_clock::now();
+        hasAlpha = 0;
+        for (int it = 0; it < nIter; it++) {
+            hasAlpha += kernel->countTransparentPixels((const u_int32_t *)data, length, false);
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        duration = end - start;
+        cummulativeTimeUs = duration.count();
+
+        printf("Transparent count = %d in %d iterations\n", hasAlpha / nIter, nIter);
+        printf("Kernel %s test completed: %d iterations in %fms, %fus / iteration for %luKB\n", kernel->name, nIter, cummulativeTimeUs, (cummulativeTimeUs / nIter), byteSize / 1024);
+
+        // Verify with different lengths (remainders) and positions of transparent pixels
+        for (size_t testLength = 0; testLength < 100; testLength++) {
+            for (size_t transparentIndex = 0; transparentIndex <= testLength; transparentIndex++) {
+                u_int32_t * pixels = (u_int32_t *)data;
+                u_int32_t saved = transparentIndex < testLength ? pixels[transparentIndex] : 0;
+                if (transparentIndex < testLength) {
+                    pixels[transparentIndex] &= 0x7FFFFFFF;
+                }
+
+                int expected = reference->countTransparentPixels(pixels, testLength, false);
+                int count = kernel->countTransparentPixels(pixels, testLength, false);
+                int foundExpected = reference->countTransparentPixels(pixels, testLength, true);
+                int found = kernel->countTransparentPixels(pixels, testLength, true);
+                if (count != expected || (found > 0) != (foundExpected > 0)) {
+                    printf("Kernel %s error: length = %lu, transparent index = %lu, count = %d (expected %d), found = %d (expected %d)\n", kernel->name, testLength, transparentIndex, count, expected, found, foundExpected);
+                    errors++;
+                }
+
+                if (transparentIndex < testLength) {
+                    pixels[transparentIndex] = saved;
+                }
+            }
+        }
+
+        // Verify with random alpha values
+        u_int8_t * alphaData = (u_int8_t *)malloc(byteSize);
+        memcpy(alphaData, data, byteSize);
+        for (size_t i = 3; i < byteSize; i += 4) {
+            alphaData[i] = rand() % 4 == 0 ? (u_int8_t)rand() : 255;
+        }
+        int expected = reference->countTransparentPixels((const u_int32_t *)alphaData, length, false);
+        int count = kernel->countTransparentPixels((const u_int32_t *)alphaData, length, false);
+        if (count != expected) {
+            printf("Kernel %s error: random alpha count = %d (expected %d)\n", kernel->name, count, expected);
+            errors++;
+        }
+        free(alphaData);
+    }
+
+    printf("Kernel verification completed with %d errors\n", errors);
+
     free(data);
+
+    return errors == 0 ? 0 : 1;
 }
 
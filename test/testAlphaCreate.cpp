@@ -1,7 +1,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <chrono>
+#include <string.h>
+#include <vector>
 #include <utils/WebXImageUtils.h>
+#include <utils/WebXPixelKernels.h>
 
 
 
@@ -145,6 +148,127 @@ int main() {
 
     printf("WebX integrated test completed: %d iterations in %fms, %fus / iteration for %luKB\n", nIter, cummulativeTimeUs, (cummulativeTimeUs / nIter), byteSize / 1024);
 
+    // Benchmark and cross-verify every available kernel against the scalar reference
+    int errors = 0;
+    std::vector<const WebXPixelKernels *> kernels = WebXPixelKernels::GetAvailable();
+    const WebXPixelKernels * reference = kernels[0];
+
+    u_int8_t * sourceData = (u_int8_t *)malloc(byteSize);
+    u_int8_t * expectedData = (u_int8_t *)malloc(byteSize);
+    for (size_t i = 0; i < byteSize; i++) {
+        sourceData[i] = (u_int8_t)rand();
+    }
+
+    // Cursor pixels: mostly opaque or transparent with some translucent pixels
+    int cursorLength = 64 * 64;
+    unsigned long * cursorPixels = (unsigned long *)malloc(cursorLength * sizeof(unsigned long));
+    for (int i = 0; i < cursorLength; i++) {
+        int alphaType = rand() % 8;
+        unsigned long alpha = alphaType < 4 ? 0xFF : alphaType < 7 ? 0x00 : (rand() % 0xFF);
+        cursorPixels[i] = (alpha << 24) | ((unsigned long)rand() & 0x00FFFFFF);
+    }
+    unsigned char * cursorData = (unsigned char *)malloc(cursorLength * 4);
+    unsigned char * expectedCursorData = (unsigned char *)malloc(cursorLength * 4);
+
+    for (const WebXPixelKernels * kernel : kernels) {
+        start = std::chrono::high_resolution_clock::now();
+
+        for (int it = 0; it < nIter; it++) {
+            kernel->convertToAlpha((u_int32_t *)data, length);
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        duration = end - start;
+        cummulativeTimeUs = duration.count();
+
+        printf("Kernel %s convert to alpha test completed: %d iterations in %fms, %fus / iteration for %luKB\n", kernel->name, nIter, cummulativeTimeUs, (cummulativeTimeUs / nIter), byteSize / 1024);
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (int it = 0; it < nIter; it++) {
+            kernel->makeOpaque((u_int32_t *)data, length);
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        duration = end - start;
+        cummulativeTimeUs = duration.count();
+
+        printf("Kernel %s make opaque test completed: %d iterations in %fms, %fus / iteration for %luKB\n", kernel->name, nIter, cummulativeTimeUs, (cummulativeTimeUs / nIter), byteSize / 1024);
+
+        start = std::chrono::high_resolution_clock::now();
+
+        for (int it = 0; it < nIter; it++) {
+            kernel->convertCursorPixels(cursorPixels, cursorData, cursorLength);
+        }
+
+        end = std::chrono::high_resolution_clock::now();
+        duration = end - start;
+        cummulativeTimeUs = duration.count();
+
+        printf("Kernel %s cursor conversion test completed: %d iterations in %fms, %fus / iteration for %dKB\n", kernel->name, nIter, cummulativeTimeUs, (cummulativeTimeUs / nIter), cursorLength * 4 / 1024);
+
+        // Verify with different lengths and offsets (unaligned data)
+        for (size_t offset = 0; offset < 4; offset++) {
+            for (size_t testLength = 0; testLength < 100; testLength++) {
+                u_int32_t * pixels = (u_int32_t *)data + offset;
+                u_int32_t * expectedPixels = (u_int32_t *)expectedData + offset;
+
+                memcpy(expectedPixels, (u_int32_t *)sourceData + offset, testLength * 4);
+                memcpy(pixels, (u_int32_t *)sourceData + offset, testLength * 4);
+                reference->convertToAlpha(expectedPixels, testLength);
+                kernel->convertToAlpha(pixels, testLength);
+                if (memcmp(pixels, expectedPixels, testLength * 4) != 0) {
+                    printf("Kernel %s convert to alpha error: length = %lu, offset = %lu\n", kernel->name, testLength, offset);
+                    errors++;
+                }
+
+                memcpy(expectedPixels, (u_int32_t *)sourceData + offset, testLength * 4);
+                memcpy(pixels, (u_int32_t *)sourceData + offset, testLength * 4);
+                reference->makeOpaque(expectedPixels, testLength);
+                kernel->makeOpaque(pixels, testLength);
+                if (memcmp(pixels, expectedPixels, testLength * 4) != 0) {
+                    printf("Kernel %s make opaque error: length = %lu, offset = %lu\n", kernel->name, testLength, offset);
+                    errors++;
+                }
+
+                if (testLength + offset <= (size_t)cursorLength) {
+                    reference->convertCursorPixels(cursorPixels + offset, expectedCursorData, testLength);
+                    kernel->convertCursorPixels(cursorPixels + offset, cursorData, testLength);
+                    if (memcmp(cursorData, expectedCursorData, testLength * 4) != 0) {
+                        printf("Kernel %s cursor conversion error: length = %lu, offset = %lu\n", kernel->name, testLength, offset);
+                        errors++;
+                    }
+                }
+            }
+        }
+
+        // Verify full images
+        memcpy(expectedData, sourceData, byteSize);
+        memcpy(data, sourceData, byteSize);
+        reference->convertToAlpha((u_int32_t *)expectedData, length);
+        kernel->convertToAlpha((u_int32_t *)data, length);
+        if (memcmp(data, expectedData, byteSize) != 0) {
+            printf("Kernel %s convert to alpha error on full image\n", kernel->name);
+            errors++;
+        }
+
+        reference->convertCursorPixels(cursorPixels, expectedCursorData, cursorLength);
+        kernel->convertCursorPixels(cursorPixels, cursorData, cursorLength);
+        if (memcmp(cursorData, expectedCursorData, cursorLength * 4) != 0) {
+            printf("Kernel %s cursor conversion error on full image\n", kernel->name);
+            errors++;
+        }
+    }
+
+    printf("Kernel verification completed with %d errors\n", errors);
+
+    free(cursorPixels);
+    free(cursorData);
+    free(expectedCursorData);
+    free(sourceData);
+    free(expectedData);
     free(data);
+
+    return errors == 0 ? 0 : 1;
 }
 
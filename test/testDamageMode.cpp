@@ -0,0 +1,185 @@
+#include <X11/Xlib.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+/*
+ * Compares the XDamage raw rectangle and region (non-empty + subtract) modes under a scrolling workload.
+ *
+ * A workload thread (with its own X11 connection) scrolls the content of a window and draws a new line of "text"
+ * (many small rectangles) every frame. The observer (main thread) reads the damage events every tick, as the
+ * WebXController does, and in region mode fetches the damaged region of the window. The number of events, damaged
+ * rectangles, round trips and the CPU time of the observer are reported for each mode.
+ *
+ * Usage: testDamageMode [duration seconds]
+ */
+
+const int WINDOW_WIDTH = 800;
+const int WINDOW_HEIGHT = 600;
+const int LINE_HEIGHT = 16;
+const int GLYPHS_PER_LINE = 80;
+const int FRAME_DURATION_MS = 16;
+const int TICK_DURATION_MS = 10;
+
+struct DamageModeResult {
+    int frames;
+    long events;
+    long rectangles;
+    long roundTrips;
+    double cpuTimeMs;
+    double durationMs;
+};
+
+double threadCpuTimeMs() {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+void scrollWorkload(Window window, int durationMs, std::atomic<int> * frames) {
+    Display * display = XOpenDisplay(NULL);
+    GC gc = XCreateGC(display, window, 0, NULL);
+    int screen = DefaultScreen(display);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::chrono::high_resolution_clock::time_point now = start;
+    int line = 0;
+    while (std::chrono::duration<double, std::milli>(now - start).count() < durationMs) {
+        // Scroll the window content up by one line
+        XCopyArea(display, window, window, gc, 0, LINE_HEIGHT, WINDOW_WIDTH, WINDOW_HEIGHT - LINE_HEIGHT, 0, 0);
+
+        // Clear the last line and draw the glyphs of a new line
+        XSetForeground(display, gc, WhitePixel(display, screen));
+        XFillRectangle(display, window, gc, 0, WINDOW_HEIGHT - LINE_HEIGHT, WINDOW_WIDTH, LINE_HEIGHT);
+        XSetForeground(display, gc, BlackPixel(display, screen));
+        for (int i = 0; i < GLYPHS_PER_LINE; i++) {
+            int glyphWidth = 4 + (i * 7 + line) % 5;
+            XFillRectangle(display, window, gc, 4 + i * 9, WINDOW_HEIGHT - LINE_HEIGHT + 3, glyphWidth, LINE_HEIGHT - 6);
+        }
+        XFlush(display);
+
+        line++;
+        (*frames)++;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_DURATION_MS));
+        now = std::chrono::high_resolution_clock::now();
+    }
+
+    XFreeGC(display, gc);
+    XCloseDisplay(display);
+}
+
+DamageModeResult runDamageMode(Display * display, Window window, int damageEventBase, int damageReportLevel, int durationMs) {
+    DamageModeResult result = {0, 0, 0, 0, 0.0, 0.0};
+
+    Damage damage = XDamageCreate(display, window, damageReportLevel);
+    XserverRegion region = XFixesCreateRegion(display, NULL, 0);
+    XSync(display, False);
+
+    // Ignore the events generated by the creation of the damage
+    XEvent event;
+    while (XPending(display)) {
+        XNextEvent(display, &event);
+    }
+    XDamageSubtract(display, damage, None, None);
+    XSync(display, False);
+
+    std::atomic<int> frames(0);
+    std::thread workload(scrollWorkload, window, durationMs, &frames);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    double cpuTimeStartMs = threadCpuTimeMs();
+
+    bool workloadRunning = true;
+    while (workloadRunning) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(TICK_DURATION_MS));
+        workloadRunning = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() < durationMs + 2 * TICK_DURATION_MS;
+
+        // Read all the events of the tick
+        bool isDamaged = false;
+        int queueLength = XEventsQueued(display, QueuedAfterFlush);
+        for (int i = 0; i < queueLength; i++) {
+            XNextEvent(display, &event);
+            if (event.type == damageEventBase + XDamageNotify) {
+                result.events++;
+                isDamaged = true;
+                if (damageReportLevel == XDamageReportRawRectangles) {
+                    result.rectangles++;
+                }
+            }
+        }
+
+        // Fetch the damaged region once per tick
+        if (isDamaged && damageReportLevel == XDamageReportNonEmpty) {
+            XDamageSubtract(display, damage, None, region);
+            int numberOfRectangles = 0;
+            XRectangle * rectangles = XFixesFetchRegion(display, region, &numberOfRectangles);
+            if (rectangles) {
+                XFree(rectangles);
+            }
+            result.rectangles += numberOfRectangles;
+            result.roundTrips++;
+        }
+    }
+
+    result.cpuTimeMs = threadCpuTimeMs() - cpuTimeStartMs;
+    result.durationMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    workload.join();
+    result.frames = frames;
+
+    XFixesDestroyRegion(display, region);
+    XDamageDestroy(display, damage);
+    XSync(display, False);
+
+    return result;
+}
+
+void printResult(const char * mode, const DamageModeResult & result) {
+    printf("%-6s: %5d frames, %7ld events (%7.1f / frame), %7ld rectangles, %5ld round trips, cpu = %8.2fms (%5.2f%%)\n",
+        mode, result.frames, result.events, (double)result.events / (result.frames > 0 ? result.frames : 1), result.rectangles, result.roundTrips,
+        result.cpuTimeMs, 100.0 * result.cpuTimeMs / result.durationMs);
+}
+
+int main(int argc, char ** argv) {
+    int durationMs = argc > 1 ? atoi(argv[1]) * 1000 : 5000;
+
+    XInitThreads();
+    Display * display = XOpenDisplay(NULL);
+    if (display == NULL) {
+        printf("Could not open the display: verify the DISPLAY environment variable\n");
+        return 1;
+    }
+
+    int damageEventBase;
+    int damageErrorBase;
+    if (!XDamageQueryExtension(display, &damageEventBase, &damageErrorBase)) {
+        printf("No damage extension\n");
+        return 1;
+    }
+
+    int screen = DefaultScreen(display);
+    Window window = XCreateSimpleWindow(display, RootWindow(display, screen), 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 0, BlackPixel(display, screen), WhitePixel(display, screen));
+    XMapWindow(display, window);
+    XSync(display, False);
+
+    // Wait for the window to be mapped
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    printf("Scrolling workload: %d x %d window, %d glyphs per line, %d frames per second, %dms ticks\n", WINDOW_WIDTH, WINDOW_HEIGHT, GLYPHS_PER_LINE, 1000 / FRAME_DURATION_MS, TICK_DURATION_MS);
+
+    DamageModeResult rawResult = runDamageMode(display, window, damageEventBase, XDamageReportRawRectangles, durationMs);
+    printResult("raw", rawResult);
+
+    DamageModeResult regionResult = runDamageMode(display, window, damageEventBase, XDamageReportNonEmpty, durationMs);
+    printResult("region", regionResult);
+
+    XDestroyWindow(display, window);
+    XCloseDisplay(display);
+}
@@ -0,0 +1,159 @@
+#include <transport/serializer/WebXMessageEncoder.h>
+#include <models/message/WebXImageMessage.h>
+#include <models/message/WebXSubImagesMessage.h>
+#include <image/WebXImage.h>
+#include <utils/WebXBinaryBuffer.h>
+
+#include <zmq.hpp>
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include <memory>
+
+// The timestamp and the message id differ between two encodings of the same message
+const size_t HEADER_VARIABLE_START = 24;
+const size_t HEADER_VARIABLE_END = 40;
+
+typedef std::vector<unsigned char> Bytes;
+
+int errors = 0;
+
+void check(bool condition, const char * description, int iteration) {
+    if (!condition) {
+        printf("Iteration %d: %s failed\n", iteration, description);
+        errors++;
+    }
+}
+
+WebXDataBuffer * createDataBuffer(size_t size) {
+    // Data bytes are never 0 so that they can be distinguished from alignment padding
+    WebXDataBuffer * dataBuffer = new WebXDataBuffer(size);
+    Bytes data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = 1 + rand() % 255;
+    }
+    dataBuffer->appendData(data.data(), size);
+    return dataBuffer;
+}
+
+std::shared_ptr<WebXImage> createImage() {
+    size_t rawDataSize = 1 + rand() % 100;
+    if (rand() % 2) {
+        size_t alphaDataSize = 1 + rand() % 50;
+        return std::make_shared<WebXImage>(WebXImageTypePNG, 16, 16, createDataBuffer(rawDataSize), createDataBuffer(alphaDataSize), 32, 0.0);
+    }
+    return std::make_shared<WebXImage>(WebXImageTypeJPG, 16, 16, createDataBuffer(rawDataSize), 24, 0.0);
+}
+
+WebXClientIndexMask createClientIndexMask() {
+    WebXClientIndexMask clientIndexMask;
+    for (int i = 0; i < 4; i++) {
+        clientIndexMask |= WebXClientIndexMask::ForPosition(rand() % 256);
+    }
+    return clientIndexMask;
+}
+
+Bytes getBytes(zmq::message_t * message) {
+    const unsigned char * data = (const unsigned char *)message->data();
+    return Bytes(data, data + message->size());
+}
+
+Bytes concatenate(const std::vector<zmq::message_t *> & frames) {
+    Bytes bytes;
+    for (zmq::message_t * frame : frames) {
+        Bytes frameBytes = getBytes(frame);
+        bytes.insert(bytes.end(), frameBytes.begin(), frameBytes.end());
+    }
+    return bytes;
+}
+
+bool matchesMessage(const Bytes & frameBytes, const Bytes & messageBytes) {
+    if (frameBytes.size() < messageBytes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < messageBytes.size(); i++) {
+        if (i >= HEADER_VARIABLE_START && i < HEADER_VARIABLE_END) {
+            continue;
+        }
+        // The alignment padding of the single-frame message is not initialised (it is set to 0 in the frames)
+        if (frameBytes[i] != messageBytes[i] && frameBytes[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void checkFrames(const WebXMessageEncoder & encoder, std::shared_ptr<WebXMessage> message, int recipientMaskWords, int iteration) {
+    zmq::message_t * singleFrameMessage = encoder.encode(message);
+    Bytes messageBytes = getBytes(singleFrameMessage);
+    delete singleFrameMessage;
+
+    // The number of words of the recipient bitmap is only set in the header of the frames
+    WebXBinaryBuffer::getMessageHeader(messageBytes.data())->recipientMaskWords = recipientMaskWords;
+
+    std::vector<zmq::message_t *> frames = encoder.encodeFrames(message);
+    Bytes frameBytes = concatenate(frames);
+    const WebXBinaryBuffer::MessageHeader * header = WebXBinaryBuffer::getMessageHeader(frameBytes.data());
+
+    // The message occupies the first bufferLength bytes of the concatenated frames, the recipient bitmap follows
+    check(header->bufferLength == messageBytes.size(), "buffer length", iteration);
+    check(header->recipientMaskWords == recipientMaskWords, "recipient mask words", iteration);
+    check(frameBytes.size() == messageBytes.size() + recipientMaskWords * sizeof(uint64_t), "frames size", iteration);
+    check(matchesMessage(frameBytes, messageBytes), "concatenated frames", iteration);
+
+    if (recipientMaskWords > 0 && frameBytes.size() == header->bufferLength + recipientMaskWords * sizeof(uint64_t)) {
+        Bytes recipientMaskBytes = getBytes(frames.back());
+        check(recipientMaskBytes.size() == recipientMaskWords * sizeof(uint64_t), "recipient mask frame", iteration);
+        const uint64_t * recipientMask = (const uint64_t *)(frameBytes.data() + header->bufferLength);
+        for (int i = 0; i < recipientMaskWords; i++) {
+            check(recipientMask[i] == message->clientIndexMask.getWord(i), "recipient mask", iteration);
+        }
+        check(header->clientIndexMask == message->clientIndexMask.getWord(0), "header client index mask", iteration);
+    }
+
+    for (zmq::message_t * frame : frames) {
+        delete frame;
+    }
+}
+
+int main() {
+    srand(time(NULL));
+
+    std::array<unsigned char, 16> sessionId;
+    sessionId.fill(7);
+
+    const int maxClients = 256;
+    const int recipientMaskWords = maxClients / 64;
+
+    const int iterations = 500;
+    for (int i = 0; i < iterations; i++) {
+        bool multipartImageMessages = i % 2 == 0;
+        WebXMessageEncoder encoder(sessionId, multipartImageMessages);
+        WebXMessageEncoder extendedEncoder(sessionId, multipartImageMessages, maxClients);
+
+        WebXClientIndexMask clientIndexMask = createClientIndexMask();
+        std::shared_ptr<WebXImage> image = createImage();
+        bool alphaIncluded = rand() % 2;
+        auto imageMessage = std::make_shared<WebXImageMessage>(clientIndexMask, 1 + rand() % 1000, image, alphaIncluded);
+
+        std::vector<WebXSubImage> subImages;
+        int numberOfSubImages = 1 + rand() % 6;
+        for (int j = 0; j < numberOfSubImages; j++) {
+            subImages.push_back(WebXSubImage(WebXRectangle(rand() % 100, rand() % 100, 16, 16), createImage()));
+        }
+        auto subImagesMessage = std::make_shared<WebXSubImagesMessage>(clientIndexMask, 1 + rand() % 1000, subImages);
+
+        // Without extended client addressing only the first word of the mask is sent
+        auto legacyImageMessage = std::make_shared<WebXImageMessage>(WebXClientIndexMask(clientIndexMask.getWord(0)), 1 + rand() % 1000, image, alphaIncluded);
+        auto legacySubImagesMessage = std::make_shared<WebXSubImagesMessage>(WebXClientIndexMask(clientIndexMask.getWord(0)), 1 + rand() % 1000, subImages);
+
+        checkFrames(encoder, legacyImageMessage, 0, i);
+        checkFrames(encoder, legacySubImagesMessage, 0, i);
+        checkFrames(extendedEncoder, imageMessage, recipientMaskWords, i);
+        checkFrames(extendedEncoder, subImagesMessage, recipientMaskWords, i);
+    }
+
+    printf("%d iterations: %d errors\n", iterations, errors);
+
+    return errors == 0 ? 0 : 1;
+}
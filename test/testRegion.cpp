@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <models/WebXRegion.h>
+
+// Regions are compared with a bitmap of this size plus a margin on each side containing all the rectangles
+const int WIDTH = 96;
+const int HEIGHT = 96;
+const int MARGIN = 48;
+const int MAX_RECTANGLE_SIZE = 40;
+
+typedef std::vector<bool> Bitmap;
+
+int errors = 0;
+
+void check(bool condition, const char * description, int iteration) {
+    if (!condition) {
+        printf("Iteration %d: %s failed\n", iteration, description);
+        errors++;
+    }
+}
+
+WebXRectangle randomRectangle() {
+    int x = rand() % (WIDTH + MAX_RECTANGLE_SIZE) - MAX_RECTANGLE_SIZE;
+    int y = rand() % (HEIGHT + MAX_RECTANGLE_SIZE) - MAX_RECTANGLE_SIZE;
+    int width = rand() % MAX_RECTANGLE_SIZE;
+    int height = rand() % MAX_RECTANGLE_SIZE;
+    return WebXRectangle(x, y, width, height);
+}
+
+std::vector<WebXRectangle> randomRectangles() {
+    std::vector<WebXRectangle> rectangles;
+    int numberOfRectangles = rand() % 8;
+    for (int i = 0; i < numberOfRectangles; i++) {
+        rectangles.push_back(randomRectangle());
+    }
+    return rectangles;
+}
+
+int pixelIndex(int x, int y) {
+    return (y + MARGIN) * (WIDTH + 2 * MARGIN) + (x + MARGIN);
+}
+
+Bitmap emptyBitmap() {
+    return Bitmap((WIDTH + 2 * MARGIN) * (HEIGHT + 2 * MARGIN), false);
+}
+
+void fillRectangle(Bitmap & bitmap, const WebXRectangle & rectangle) {
+    for (int y = rectangle.y(); y < rectangle.y() + rectangle.size().height(); y++) {
+        for (int x = rectangle.x(); x < rectangle.x() + rectangle.size().width(); x++) {
+            bitmap[pixelIndex(x, y)] = true;
+        }
+    }
+}
+
+WebXRegion createRegion(const std::vector<WebXRectangle> & rectangles, Bitmap & bitmap) {
+    WebXRegion region;
+    bitmap = emptyBitmap();
+    for (const WebXRectangle & rectangle : rectangles) {
+        region += WebXRegion(rectangle);
+        fillRectangle(bitmap, rectangle);
+    }
+    return region;
+}
+
+bool matchesBitmap(const WebXRegion & region, const Bitmap & bitmap) {
+    int area = 0;
+    for (int y = -MARGIN; y < HEIGHT + MARGIN; y++) {
+        for (int x = -MARGIN; x < WIDTH + MARGIN; x++) {
+            bool covered = bitmap[pixelIndex(x, y)];
+            if (region.contains(x, y) != covered) {
+                return false;
+            }
+            area += covered ? 1 : 0;
+        }
+    }
+    return region.area() == area;
+}
+
+bool rectanglesMatchBitmap(const std::vector<WebXRectangle> & rectangles, const Bitmap & bitmap) {
+    // The banded rectangles must cover the region exactly without overlapping
+    Bitmap coverage = emptyBitmap();
+    for (const WebXRectangle & rectangle : rectangles) {
+        for (int y = rectangle.y(); y < rectangle.y() + rectangle.size().height(); y++) {
+            for (int x = rectangle.x(); x < rectangle.x() + rectangle.size().width(); x++) {
+                if (coverage[pixelIndex(x, y)]) {
+                    return false;
+                }
+                coverage[pixelIndex(x, y)] = true;
+            }
+        }
+    }
+    return coverage == bitmap;
+}
+
+bool rectanglesCoverBitmap(const std::vector<WebXRectangle> & rectangles, const Bitmap & bitmap) {
+    for (int y = -MARGIN; y < HEIGHT + MARGIN; y++) {
+        for (int x = -MARGIN; x < WIDTH + MARGIN; x++) {
+            if (bitmap[pixelIndex(x, y)]) {
+                bool covered = std::any_of(rectangles.begin(), rectangles.end(), [x, y](const WebXRectangle & rectangle) {
+                    return rectangle.contains(x, y);
+                });
+                if (!covered) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    srand(time(NULL));
+
+    const int iterations = 2000;
+    for (int i = 0; i < iterations; i++) {
+        Bitmap bitmap1;
+        Bitmap bitmap2;
+        std::vector<WebXRectangle> rectangles1 = randomRectangles();
+        WebXRegion region1 = createRegion(rectangles1, bitmap1);
+        WebXRegion region2 = createRegion(randomRectangles(), bitmap2);
+
+        check(matchesBitmap(region1, bitmap1), "union of rectangles", i);
+        check(rectanglesMatchBitmap(region1.getRectangles(), bitmap1), "banded rectangles", i);
+        check(region1.isEmpty() == (region1.area() == 0), "empty region", i);
+
+        // The representation is unique: the order of the rectangles does not matter
+        std::reverse(rectangles1.begin(), rectangles1.end());
+        Bitmap reversedBitmap;
+        check(createRegion(rectangles1, reversedBitmap) == region1, "unique representation", i);
+
+        Bitmap unionBitmap = emptyBitmap();
+        Bitmap intersectionBitmap = emptyBitmap();
+        Bitmap subtractionBitmap = emptyBitmap();
+        for (size_t p = 0; p < bitmap1.size(); p++) {
+            unionBitmap[p] = bitmap1[p] || bitmap2[p];
+            intersectionBitmap[p] = bitmap1[p] && bitmap2[p];
+            subtractionBitmap[p] = bitmap1[p] && !bitmap2[p];
+        }
+
+        WebXRegion unionRegion = region1;
+        unionRegion += region2;
+        check(matchesBitmap(unionRegion, unionBitmap), "union", i);
+        check(rectanglesMatchBitmap(unionRegion.getRectangles(), unionBitmap), "union rectangles", i);
+
+        WebXRegion intersectionRegion = region1;
+        intersectionRegion &= region2;
+        check(matchesBitmap(intersectionRegion, intersectionBitmap), "intersection", i);
+        check(rectanglesMatchBitmap(intersectionRegion.getRectangles(), intersectionBitmap), "intersection rectangles", i);
+
+        WebXRegion subtractionRegion = region1;
+        subtractionRegion -= region2;
+        check(matchesBitmap(subtractionRegion, subtractionBitmap), "subtraction", i);
+        check(rectanglesMatchBitmap(subtractionRegion.getRectangles(), subtractionBitmap), "subtraction rectangles", i);
+
+        // (A - B) + (A & B) == A
+        WebXRegion recombinedRegion = subtractionRegion;
+        recombinedRegion += intersectionRegion;
+        check(recombinedRegion == region1, "recombination", i);
+
+        // Extents contain all the rectangles
+        WebXRectangle extents = unionRegion.getExtents();
+        for (const WebXRectangle & rectangle : unionRegion.getRectangles()) {
+            check(extents.contains(rectangle), "extents", i);
+        }
+
+        // Translation
+        WebXRegion translatedRegion = region1;
+        translatedRegion.translate(7, -5);
+        translatedRegion.translate(-7, 5);
+        check(translatedRegion == region1, "translation", i);
+
+        // Simplified rectangles cover the original region
+        int imageOverheadPixels = rand() % 2000;
+        size_t maxRectangles = 1 + rand() % 16;
+        std::vector<WebXRectangle> simplifiedRectangles = unionRegion.simplify(imageOverheadPixels, maxRectangles);
+        check(rectanglesCoverBitmap(simplifiedRectangles, unionBitmap), "simplify coverage", i);
+        check(unionRegion.isEmpty() || !simplifiedRectangles.empty(), "simplify not empty", i);
+        check(simplifiedRectangles.size() <= std::max(unionRegion.getNumberOfRectangles(), (size_t)1), "simplify rectangle count", i);
+    }
+
+    printf("%d iterations: %d errors\n", iterations, errors);
+
+    return errors == 0 ? 0 : 1;
+}